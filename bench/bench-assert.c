@@ -0,0 +1,25 @@
+/*
+    Baseline: assert from assert.h
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <assert.h>
+
+#define BENCH_MODE(name)                     name##_assert
+#define BENCH_MODE_NAME                      "assert"
+#define BENCH_TEXT_SECTION                   "bench_text_assert"
+
+#define BENCH_CHECK_EQ(a, b)                 assert((a) == (b))
+#define BENCH_CHECK_NEQ(a, b)                assert((a) != (b))
+#define BENCH_CHECK_LT(a, b)                 assert((a) < (b))
+#define BENCH_CHECK_LEQ(a, b)                assert((a) <= (b))
+#define BENCH_CHECK_GT(a, b)                 assert((a) > (b))
+#define BENCH_CHECK_GEQ(a, b)                assert((a) >= (b))
+#define BENCH_CHECK(cond)                    assert(cond)
+#define BENCH_CHECK_PTR_NULL(ptr)            assert((ptr) == NULL)
+#define BENCH_CHECK_PTR_NOT_NULL(ptr)        assert((ptr) != NULL)
+
+#include "bench-template.h"
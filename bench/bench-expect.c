@@ -0,0 +1,30 @@
+/*
+    Baseline: the cheapest possible check, branch hint and abort
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stdlib.h>
+
+#define BENCH_MODE(name)                     name##_expect
+#define BENCH_MODE_NAME                      "expect"
+#define BENCH_TEXT_SECTION                   "bench_text_expect"
+
+#define BENCH_CHECK(cond) \
+    do { \
+        if (__builtin_expect(!(cond), 0)) \
+            abort(); \
+    } while (0)
+
+#define BENCH_CHECK_EQ(a, b)                 BENCH_CHECK((a) == (b))
+#define BENCH_CHECK_NEQ(a, b)                BENCH_CHECK((a) != (b))
+#define BENCH_CHECK_LT(a, b)                 BENCH_CHECK((a) < (b))
+#define BENCH_CHECK_LEQ(a, b)                BENCH_CHECK((a) <= (b))
+#define BENCH_CHECK_GT(a, b)                 BENCH_CHECK((a) > (b))
+#define BENCH_CHECK_GEQ(a, b)                BENCH_CHECK((a) >= (b))
+#define BENCH_CHECK_PTR_NULL(ptr)            BENCH_CHECK((ptr) == NULL)
+#define BENCH_CHECK_PTR_NOT_NULL(ptr)        BENCH_CHECK((ptr) != NULL)
+
+#include "bench-template.h"
@@ -0,0 +1,51 @@
+/*
+    Benchmarks of KASSERT_* macros
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <kassert/kassert.h>
+
+#define BENCH_MODE(name)                     name##_kassert
+#define BENCH_MODE_NAME                      "kassert"
+#define BENCH_TEXT_SECTION                   "bench_text_kassert"
+
+#define BENCH_CHECK_EQ(a, b)                 KASSERT_EQ(a, b)
+#define BENCH_CHECK_NEQ(a, b)                KASSERT_NEQ(a, b)
+#define BENCH_CHECK_LT(a, b)                 KASSERT_LT(a, b)
+#define BENCH_CHECK_LEQ(a, b)                KASSERT_LEQ(a, b)
+#define BENCH_CHECK_GT(a, b)                 KASSERT_GT(a, b)
+#define BENCH_CHECK_GEQ(a, b)                KASSERT_GEQ(a, b)
+#define BENCH_CHECK(cond)                    KASSERT(cond)
+#define BENCH_CHECK_PTR_NULL(ptr)            KASSERT_PTR_NULL(ptr)
+#define BENCH_CHECK_PTR_NOT_NULL(ptr)        KASSERT_PTR_NOT_NULL(ptr)
+
+#define BENCH_CHECK_LT_DISABLED(a, b)        KASSERT_LT_L(KASSERT_LEVEL_PARANOID, a, b)
+#define BENCH_CHECK_LT_SAMPLED(a, b)         KASSERT_LT_SAMPLED(100, a, b)
+#define BENCH_CHECK_LT_ONCE(a, b)            KASSERT_LT_ONCE(a, b)
+#define BENCH_CHECK_LT_ONCE_PER_THREAD(a, b) KASSERT_LT_ONCE_PER_THREAD(a, b)
+#define BENCH_CHECK_LT_SOFT(a, b)            KASSERT_SOFT_LT(a, b)
+#define BENCH_CHECK_ON_THREAD(a, b)          KASSERT_ON_THREAD(bench_owner)
+#define BENCH_CHECK_MUTEX_HELD(a, b)         KASSERT_MUTEX_HELD(&bench_mutex)
+
+/* Guard of the loop body, budget of 1 s is always met */
+#define BENCH_CHECK_DEADLINE(a, b)           do { KASSERT_DEADLINE(1000000000ULL); } while (0)
+
+/* Region around the loop body, nothing allocates */
+#define BENCH_CHECK_NO_ALLOC(a, b)           do { KASSERT_NO_ALLOC_SCOPED(); } while (0)
+
+/* Benchmarks run in the main thread, it owns the data and holds the mutex for the whole run */
+static pid_t           bench_owner;
+static kassert_mutex_t bench_mutex = KASSERT_MUTEX_INITIALIZER;
+
+static void __attribute__(( constructor )) bench_owner_init(void);
+
+static void __attribute__(( constructor )) bench_owner_init(void)
+{
+    bench_owner = kassert_gettid();
+    (void)kassert_mutex_lock(&bench_mutex);
+}
+
+#include "bench-template.h"
@@ -0,0 +1,32 @@
+/*
+    Baseline: KASSERT_* macros disabled by NDEBUG (no checks at all)
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#define NDEBUG
+#include <kassert/kassert.h>
+
+#define BENCH_MODE(name)                     name##_ndebug
+#define BENCH_MODE_NAME                      "ndebug"
+#define BENCH_TEXT_SECTION                   "bench_text_ndebug"
+
+#define BENCH_CHECK_EQ(a, b)                 KASSERT_EQ(a, b)
+#define BENCH_CHECK_NEQ(a, b)                KASSERT_NEQ(a, b)
+#define BENCH_CHECK_LT(a, b)                 KASSERT_LT(a, b)
+#define BENCH_CHECK_LEQ(a, b)                KASSERT_LEQ(a, b)
+#define BENCH_CHECK_GT(a, b)                 KASSERT_GT(a, b)
+#define BENCH_CHECK_GEQ(a, b)                KASSERT_GEQ(a, b)
+#define BENCH_CHECK(cond)                    KASSERT(cond)
+#define BENCH_CHECK_PTR_NULL(ptr)            KASSERT_PTR_NULL(ptr)
+#define BENCH_CHECK_PTR_NOT_NULL(ptr)        KASSERT_PTR_NOT_NULL(ptr)
+
+#define BENCH_CHECK_LT_DISABLED(a, b)        KASSERT_LT_L(KASSERT_LEVEL_PARANOID, a, b)
+#define BENCH_CHECK_LT_SAMPLED(a, b)         KASSERT_LT_SAMPLED(100, a, b)
+#define BENCH_CHECK_LT_ONCE(a, b)            KASSERT_LT_ONCE(a, b)
+#define BENCH_CHECK_LT_ONCE_PER_THREAD(a, b) KASSERT_LT_ONCE_PER_THREAD(a, b)
+#define BENCH_CHECK_LT_SOFT(a, b)            KASSERT_SOFT_LT(a, b)
+
+#include "bench-template.h"
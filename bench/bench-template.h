@@ -0,0 +1,249 @@
+#ifndef BENCH_TEMPLATE_H
+#define BENCH_TEMPLATE_H
+
+/*
+    This is the private header for the KAssert benchmarks.
+    Body of the benchmarks, included once by every mode file (bench-<mode>.c) which defines:
+
+    BENCH_MODE(name)       - name with mode suffix, i.e. name##_kassert
+    BENCH_MODE_NAME        - name of the mode as a string
+    BENCH_TEXT_SECTION     - name of the section for .text size measurement, "bench_text_<mode>"
+    BENCH_CHECK_EQ .. GEQ  - relation checks
+    BENCH_CHECK            - condition check
+    BENCH_CHECK_PTR_NULL / BENCH_CHECK_PTR_NOT_NULL
+
+    Optionally variants of KASSERT_LT (default BENCH_CHECK_LT):
+    BENCH_CHECK_LT_DISABLED, BENCH_CHECK_LT_SAMPLED, BENCH_CHECK_LT_ONCE,
+    BENCH_CHECK_LT_ONCE_PER_THREAD, BENCH_CHECK_LT_SOFT
+
+    Optionally concurrency checks (default BENCH_CHECK_LT, so baselines pay for a compare of operands):
+    BENCH_CHECK_ON_THREAD, BENCH_CHECK_MUTEX_HELD
+
+    Optionally latency budget check and no-allocation region (default BENCH_CHECK_LT):
+    BENCH_CHECK_DEADLINE, BENCH_CHECK_NO_ALLOC
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include "bench.h"
+
+#ifndef BENCH_CHECK_LT_DISABLED
+#define BENCH_CHECK_LT_DISABLED(a, b)        BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_LT_SAMPLED
+#define BENCH_CHECK_LT_SAMPLED(a, b)         BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_LT_ONCE
+#define BENCH_CHECK_LT_ONCE(a, b)            BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_LT_ONCE_PER_THREAD
+#define BENCH_CHECK_LT_ONCE_PER_THREAD(a, b) BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_LT_SOFT
+#define BENCH_CHECK_LT_SOFT(a, b)            BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_ON_THREAD
+#define BENCH_CHECK_ON_THREAD(a, b)          BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_MUTEX_HELD
+#define BENCH_CHECK_MUTEX_HELD(a, b)         BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_DEADLINE
+#define BENCH_CHECK_DEADLINE(a, b)           BENCH_CHECK_LT(a, b)
+#endif
+
+#ifndef BENCH_CHECK_NO_ALLOC
+#define BENCH_CHECK_NO_ALLOC(a, b)           BENCH_CHECK_LT(a, b)
+#endif
+
+#define BENCH_EXPAND(...) __VA_ARGS__
+
+/* Typedefs, so pointer types can be used like other types */
+#define BENCH_TYPEDEF(arg, name, type) typedef type bench_type_##name;
+BENCH_TYPES(BENCH_TYPEDEF, 0)
+
+/* Tight loop with relation check, sum keeps the loop alive */
+#define BENCH_DEFINE_OP_TYPE(arg, name, type) BENCH_DEFINE_OP_TYPE_I((BENCH_EXPAND arg, name))
+#define BENCH_DEFINE_OP_TYPE_I(args) BENCH_DEFINE_OP_TYPE_II args
+#define BENCH_DEFINE_OP_TYPE_II(op, first, second, name) \
+    static unsigned long long bench_op_##op##_##name(const bench_data_t* data, size_t n) \
+    { \
+        const bench_type_##name* a = data->first; \
+        const bench_type_##name* b = data->second; \
+        unsigned long long sum = 0; \
+        (void)b; \
+        for (size_t i = 0; i < n; ++i) \
+        { \
+            BENCH_CHECK_##op(a[i], b[i]); \
+            sum += (unsigned long long)a[i]; \
+        } \
+        return sum; \
+    }
+
+#define BENCH_DEFINE_OP(arg, op, first, second) BENCH_TYPES(BENCH_DEFINE_OP_TYPE, (op, first, second))
+BENCH_OPS(BENCH_DEFINE_OP, 0)
+
+/* Tight loop with int operands and the given check */
+#define BENCH_DEFINE_EXTRA_INT(name, check) \
+    static unsigned long long bench_extra_##name(const bench_data_t* data, size_t n) \
+    { \
+        const int* a = data->lo; \
+        const int* b = data->hi; \
+        unsigned long long sum = 0; \
+        (void)b; \
+        for (size_t i = 0; i < n; ++i) \
+        { \
+            check; \
+            sum += (unsigned long long)a[i]; \
+        } \
+        return sum; \
+    }
+
+BENCH_DEFINE_EXTRA_INT(cond,            BENCH_CHECK(a[i] < b[i]))
+BENCH_DEFINE_EXTRA_INT(call,            BENCH_CHECK_LT(bench_get_int(a, i), bench_get_int(b, i)))
+BENCH_DEFINE_EXTRA_INT(level_disabled,  BENCH_CHECK_LT_DISABLED(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(sampled,         BENCH_CHECK_LT_SAMPLED(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(once,            BENCH_CHECK_LT_ONCE(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(once_per_thread, BENCH_CHECK_LT_ONCE_PER_THREAD(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(soft,            BENCH_CHECK_LT_SOFT(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(on_thread,       BENCH_CHECK_ON_THREAD(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(mutex_held,      BENCH_CHECK_MUTEX_HELD(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(deadline,        BENCH_CHECK_DEADLINE(a[i], b[i]))
+BENCH_DEFINE_EXTRA_INT(no_alloc,        BENCH_CHECK_NO_ALLOC(a[i], b[i]))
+
+static unsigned long long bench_extra_ptr_not_null(const bench_data_t* data, size_t n)
+{
+    char* const* a = data->lo;
+    unsigned long long sum = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        BENCH_CHECK_PTR_NOT_NULL(a[i]);
+        sum += (unsigned long long)a[i];
+    }
+
+    return sum;
+}
+
+static unsigned long long bench_extra_ptr_null(const bench_data_t* data, size_t n)
+{
+    char* const* a = data->nul;
+    unsigned long long sum = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        BENCH_CHECK_PTR_NULL(a[i]);
+        sum += (unsigned long long)a[i];
+    }
+
+    return sum;
+}
+
+/* Without checks compiler vectorizes these loops, check in the loop adds an exit from every iteration */
+static unsigned long long bench_vec_int_checked(const bench_data_t* data, size_t n)
+{
+    const int* x = data->lo;
+    const int* y = data->hi;
+    int* out = data->out;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        BENCH_CHECK_LT(x[i], y[i]);
+        out[i] = 3 * x[i] + y[i];
+    }
+
+    return (unsigned long long)out[n - 1];
+}
+
+static unsigned long long bench_vec_float_checked(const bench_data_t* data, size_t n)
+{
+    const float* x = data->lo;
+    const float* y = data->hi;
+    float* out = data->out;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        BENCH_CHECK_LT(x[i], y[i]);
+        out[i] = 3.0f * x[i] + y[i];
+    }
+
+    return (unsigned long long)out[n - 1];
+}
+
+/* Checks hoisted into separate loop, so the computation is vectorized again */
+static unsigned long long bench_vec_float_hoisted(const bench_data_t* data, size_t n)
+{
+    const float* x = data->lo;
+    const float* y = data->hi;
+    float* out = data->out;
+
+    for (size_t i = 0; i < n; ++i)
+        BENCH_CHECK_LT(x[i], y[i]);
+
+    for (size_t i = 0; i < n; ++i)
+        out[i] = 3.0f * x[i] + y[i];
+
+    return (unsigned long long)out[n - 1];
+}
+
+/*
+    .text bytes per site = size of this function (minus size in ndebug mode) / BENCH_TEXT_SITES
+    Function has own section, so compiler does not split it into hot and cold part, both are counted
+*/
+#define BENCH_TEXT_SITE(i)  BENCH_CHECK_EQ(a[i], b[i]);
+#define BENCH_TEXT_SITES_4(i) \
+    BENCH_TEXT_SITE(i) BENCH_TEXT_SITE(i + 1) BENCH_TEXT_SITE(i + 2) BENCH_TEXT_SITE(i + 3)
+#define BENCH_TEXT_SITES_32 \
+    BENCH_TEXT_SITES_4(0)  BENCH_TEXT_SITES_4(4)  BENCH_TEXT_SITES_4(8)  BENCH_TEXT_SITES_4(12) \
+    BENCH_TEXT_SITES_4(16) BENCH_TEXT_SITES_4(20) BENCH_TEXT_SITES_4(24) BENCH_TEXT_SITES_4(28)
+
+_Static_assert(BENCH_TEXT_SITES == 32, "BENCH_TEXT_SITES_32 has to be updated");
+
+extern const char BENCH_MODE(__start_bench_text)[];
+extern const char BENCH_MODE(__stop_bench_text)[];
+
+static void __attribute__(( section(BENCH_TEXT_SECTION), noinline, used )) bench_text_sites(const int* a, const int* b)
+{
+    (void)a;
+    (void)b;
+
+    BENCH_TEXT_SITES_32
+}
+
+#ifndef NDEBUG
+static void bench_fail(int val)
+{
+    BENCH_CHECK_EQ(val, 0);
+}
+#endif
+
+#define BENCH_TABLE_OP_TYPE(op, name, type) [BENCH_TYPE_##name] = bench_op_##op##_##name,
+#define BENCH_TABLE_OP(arg, op, first, second) [BENCH_OP_##op] = { BENCH_TYPES(BENCH_TABLE_OP_TYPE, op) },
+#define BENCH_TABLE_EXTRA(arg, name, macro) [BENCH_EXTRA_##name] = bench_extra_##name,
+#define BENCH_TABLE_VEC(arg, name) [BENCH_VEC_##name] = bench_vec_##name,
+
+const bench_mode_t BENCH_MODE(bench_mode) =
+{
+    .name = BENCH_MODE_NAME,
+    .ops = { BENCH_OPS(BENCH_TABLE_OP, 0) },
+    .extras = { BENCH_EXTRAS(BENCH_TABLE_EXTRA, 0) },
+    .vecs = { BENCH_VECS(BENCH_TABLE_VEC, 0) },
+    .text_start = BENCH_MODE(__start_bench_text),
+    .text_stop = BENCH_MODE(__stop_bench_text),
+#ifdef NDEBUG
+    .fail = NULL
+#else
+    .fail = bench_fail
+#endif
+};
+
+#endif
@@ -0,0 +1,553 @@
+/*
+    KAssert benchmarks, results are written to stdout as JSON.
+
+    ops           - ns per checked element in tight loop, for every relation and type
+    extras        - ns per checked element for other macros (condition, pointers, function calls, levels, sampling, soft,
+                    thread and mutex ownership)
+    vectorization - ns per element of loops which are vectorized without checks
+    text          - .text bytes per site (minus bytes of the same code without checks)
+    failure       - us from failed check to exit of the process observed by parent
+    failure_policy - the same for KASSERT with every failure policy (see kassert-policy.h)
+    stack         - ns per stack capture (kassert_backtrace) for every unwinder, with captures per second
+    checksum      - GB/s of every CRC32C kernel and XXH64 for page, L2 sized and memory sized buffers
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <kassert/kassert.h>
+
+#include "bench.h"
+
+/* Calls of the benchmark per sample and samples per benchmark, median is reported */
+#define BENCH_REPEAT          256
+#define BENCH_SAMPLES         9
+#define BENCH_FAIL_SAMPLES    21
+
+#define BENCH_MODES_COUNT     4
+
+/* Stack capture is measured BENCH_STACK_DEPTH frames below bench_stack */
+#define BENCH_STACK_DEPTH     16
+#define BENCH_STACK_CAPTURES  4096
+#define BENCH_STACK_FRAMES    64
+
+/* Bytes hashed per sample, the biggest buffer does not fit in caches */
+#define BENCH_CHECKSUM_BYTES  (64U << 20)
+
+typedef struct bench_type_data
+{
+    const char*  name;
+    bench_data_t data;
+} bench_type_data_t;
+
+static const bench_mode_t* const modes[BENCH_MODES_COUNT] =
+{
+    &bench_mode_kassert,
+    &bench_mode_assert,
+    &bench_mode_expect,
+    &bench_mode_ndebug
+};
+
+/* Operands, lo[i] < hi[i], eq[i] == lo[i] */
+#define BENCH_ARRAYS(arg, name, type) \
+    static type lo_##name[BENCH_N]; \
+    static type hi_##name[BENCH_N]; \
+    static type eq_##name[BENCH_N]; \
+    static type nul_##name[BENCH_N];
+BENCH_TYPES(BENCH_ARRAYS, 0)
+
+static char pointer_pool[64];
+static long double out[BENCH_N];
+
+static bench_type_data_t types[BENCH_TYPES_COUNT];
+
+/* Benchmarks cannot be optimized out */
+static volatile unsigned long long sink;
+
+static unsigned long long now_ns(void);
+static void data_init(void);
+static int cmp_double(const void* a, const void* b);
+static double median(double* samples, size_t n);
+static double bench_run(bench_fn_t fn, const bench_data_t* data);
+static void json_row_begin(bool* first);
+static void json_results(const double* results);
+static void bench_ops(void);
+static void bench_extras(void);
+static void bench_vecs(void);
+static void bench_text(void);
+static double bench_fail_once(void (*fail)(int), KASSERT_FAILURE_POLICY policy);
+static void bench_failure(void);
+static void bench_policy_handler(void* arg);
+static void bench_failure_policy(void);
+static size_t bench_stack_capture(unsigned int depth);
+static void bench_stack(void);
+static unsigned long long bench_checksum_run(int kernel, const unsigned char* buf, size_t size);
+static void bench_checksum(void);
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void data_init(void)
+{
+    size_t t = 0;
+
+#define BENCH_INIT(arg, tname, type) \
+    for (size_t i = 0; i < BENCH_N; ++i) \
+    { \
+        /* Bool has only 2 values, for others values are small, so they fit into every type */ \
+        const uintptr_t val = _Generic((type)0, bool: 0, default: 1 + i % 50); \
+        lo_##tname[i] = (type)(BENCH_BASE(type) + val); \
+        hi_##tname[i] = (type)(BENCH_BASE(type) + val + 1); \
+        eq_##tname[i] = lo_##tname[i]; \
+        nul_##tname[i] = (type)0; \
+    } \
+    types[t++] = (bench_type_data_t){ .name = #type, .data = { lo_##tname, hi_##tname, eq_##tname, nul_##tname, out } };
+
+    /* Pointers point to the pool, numbers does not depend on the pool address */
+#define BENCH_BASE(type) _Generic((type)0, char*: (uintptr_t)pointer_pool, default: (uintptr_t)0)
+
+    BENCH_TYPES(BENCH_INIT, 0)
+
+#undef BENCH_BASE
+#undef BENCH_INIT
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    const double da = *(const double *)a;
+    const double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+static double median(double* samples, size_t n)
+{
+    qsort(samples, n, sizeof(samples[0]), cmp_double);
+
+    return samples[n / 2];
+}
+
+/* ns per element */
+static double bench_run(bench_fn_t fn, const bench_data_t* data)
+{
+    double samples[BENCH_SAMPLES];
+
+    sink += fn(data, BENCH_N);
+
+    for (size_t s = 0; s < BENCH_SAMPLES; ++s)
+    {
+        const unsigned long long start = now_ns();
+
+        for (size_t r = 0; r < BENCH_REPEAT; ++r)
+            sink += fn(data, BENCH_N);
+
+        samples[s] = (double)(now_ns() - start) / (BENCH_REPEAT * BENCH_N);
+    }
+
+    return median(samples, BENCH_SAMPLES);
+}
+
+static void json_row_begin(bool* first)
+{
+    printf(*first ? "\n    {" : ",\n    {");
+    *first = false;
+}
+
+static void json_results(const double* results)
+{
+    for (size_t m = 0; m < BENCH_MODES_COUNT; ++m)
+        printf(", \"%s\": %.3f", modes[m]->name, results[m]);
+
+    printf("}");
+}
+
+static void bench_ops(void)
+{
+    static const char* const ops_names[BENCH_OPS_COUNT] =
+    {
+#define BENCH_OP_NAME(arg, op, first, second) "KASSERT_" #op,
+        BENCH_OPS(BENCH_OP_NAME, 0)
+#undef BENCH_OP_NAME
+    };
+
+    bool first = true;
+
+    printf("  \"ops\": [");
+
+    for (size_t op = 0; op < BENCH_OPS_COUNT; ++op)
+        for (size_t t = 0; t < BENCH_TYPES_COUNT; ++t)
+        {
+            double results[BENCH_MODES_COUNT];
+            for (size_t m = 0; m < BENCH_MODES_COUNT; ++m)
+                results[m] = bench_run(modes[m]->ops[op][t], &types[t].data);
+
+            json_row_begin(&first);
+            printf("\"macro\": \"%s\", \"type\": \"%s\"", ops_names[op], types[t].name);
+            json_results(results);
+        }
+
+    printf("\n  ],\n");
+}
+
+static void bench_extras(void)
+{
+    static const char* const extras_names[BENCH_EXTRAS_COUNT] =
+    {
+#define BENCH_EXTRA_NAME(arg, name, macro) #macro,
+        BENCH_EXTRAS(BENCH_EXTRA_NAME, 0)
+#undef BENCH_EXTRA_NAME
+    };
+
+    static const char* const extras_ids[BENCH_EXTRAS_COUNT] =
+    {
+#define BENCH_EXTRA_ID(arg, name, macro) #name,
+        BENCH_EXTRAS(BENCH_EXTRA_ID, 0)
+#undef BENCH_EXTRA_ID
+    };
+
+    bool first = true;
+
+    printf("  \"extras\": [");
+
+    for (size_t e = 0; e < BENCH_EXTRAS_COUNT; ++e)
+    {
+        const bool ptr = e == BENCH_EXTRA_ptr_null || e == BENCH_EXTRA_ptr_not_null;
+        const bench_data_t* data = &types[ptr ? BENCH_TYPE_pointer : BENCH_TYPE_int].data;
+
+        double results[BENCH_MODES_COUNT];
+        for (size_t m = 0; m < BENCH_MODES_COUNT; ++m)
+            results[m] = bench_run(modes[m]->extras[e], data);
+
+        json_row_begin(&first);
+        printf("\"name\": \"%s\", \"macro\": \"%s\"", extras_ids[e], extras_names[e]);
+        json_results(results);
+    }
+
+    printf("\n  ],\n");
+}
+
+static void bench_vecs(void)
+{
+    static const char* const vecs_names[BENCH_VECS_COUNT] =
+    {
+#define BENCH_VEC_NAME(arg, name) #name,
+        BENCH_VECS(BENCH_VEC_NAME, 0)
+#undef BENCH_VEC_NAME
+    };
+
+    bool first = true;
+
+    printf("  \"vectorization\": [");
+
+    for (size_t v = 0; v < BENCH_VECS_COUNT; ++v)
+    {
+        const bench_data_t* data = &types[v == BENCH_VEC_int_checked ? BENCH_TYPE_int : BENCH_TYPE_float].data;
+
+        double results[BENCH_MODES_COUNT];
+        for (size_t m = 0; m < BENCH_MODES_COUNT; ++m)
+            results[m] = bench_run(modes[m]->vecs[v], data);
+
+        json_row_begin(&first);
+        printf("\"loop\": \"%s\"", vecs_names[v]);
+        json_results(results);
+    }
+
+    printf("\n  ],\n");
+}
+
+static void bench_text(void)
+{
+    const double base = (double)(bench_mode_ndebug.text_stop - bench_mode_ndebug.text_start);
+
+    printf("  \"text\": {\"sites\": %d", BENCH_TEXT_SITES);
+
+    for (size_t m = 0; m < BENCH_MODES_COUNT; ++m)
+    {
+        const double bytes = (double)(modes[m]->text_stop - modes[m]->text_start);
+        printf(", \"%s\": %.3f", modes[m]->name, (bytes - base) / BENCH_TEXT_SITES);
+    }
+
+    printf("},\n");
+}
+
+/* us from the failed check in child to the moment when parent sees its exit, -1 on error */
+static double bench_fail_once(void (*fail)(int), KASSERT_FAILURE_POLICY policy)
+{
+    volatile unsigned long long* start = mmap(NULL, sizeof(*start), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (start == MAP_FAILED)
+        return -1.0;
+
+    /* Child inherits stdio buffers, exit in child would flush them again */
+    fflush(stdout);
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        munmap((void *)start, sizeof(*start));
+        return -1.0;
+    }
+
+    if (pid == 0)
+    {
+        const int fd = open("/dev/null", O_WRONLY);
+        if (fd >= 0)
+            dup2(fd, STDERR_FILENO);
+
+        /* Core dump of abort would be measured instead of the assertion */
+        const struct rlimit no_core = { 0, 0 };
+        setrlimit(RLIMIT_CORE, &no_core);
+
+        (void)kassert_failure_policy_set(policy, bench_policy_handler, NULL);
+
+        *start = now_ns();
+        fail(1);
+
+        _exit(0);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    const unsigned long long stop = now_ns();
+    const double us = (double)(stop - *start) / 1000.0;
+
+    munmap((void *)start, sizeof(*start));
+
+    /* Check has to terminate the child */
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        return -1.0;
+
+    return us;
+}
+
+static void bench_failure(void)
+{
+    bool first = true;
+
+    printf("  \"failure\": [");
+
+    for (size_t m = 0; m < BENCH_MODES_COUNT; ++m)
+    {
+        if (modes[m]->fail == NULL)
+            continue;
+
+        double samples[BENCH_FAIL_SAMPLES];
+        for (size_t s = 0; s < BENCH_FAIL_SAMPLES; ++s)
+            samples[s] = bench_fail_once(modes[m]->fail, KASSERT_FAILURE_POLICY_EXIT);
+
+        json_row_begin(&first);
+        printf("\"mode\": \"%s\", \"median_us\": %.3f}", modes[m]->name, median(samples, BENCH_FAIL_SAMPLES));
+    }
+
+    printf("\n  ],\n");
+}
+
+/* Handler of CALLBACK policy, process ends by _exit when it returns */
+static void bench_policy_handler(void* arg)
+{
+    (void)arg;
+}
+
+/* Parent of FORK_ABORT exits before the child finishes the report, so only the parent is measured */
+static void bench_failure_policy(void)
+{
+    static const char* const names[KASSERT_FAILURE_POLICY_COUNT] =
+    {
+        [KASSERT_FAILURE_POLICY_EXIT]       = "exit",
+        [KASSERT_FAILURE_POLICY_FAST_EXIT]  = "fast-exit",
+        [KASSERT_FAILURE_POLICY_ABORT]      = "abort",
+        [KASSERT_FAILURE_POLICY_CALLBACK]   = "callback",
+        [KASSERT_FAILURE_POLICY_FORK_ABORT] = "fork-abort"
+    };
+
+    bool first = true;
+
+    printf("  \"failure_policy\": [");
+
+    for (size_t p = 0; p < KASSERT_FAILURE_POLICY_COUNT; ++p)
+    {
+        double samples[BENCH_FAIL_SAMPLES];
+        for (size_t s = 0; s < BENCH_FAIL_SAMPLES; ++s)
+            samples[s] = bench_fail_once(bench_mode_kassert.fail, (KASSERT_FAILURE_POLICY)p);
+
+        json_row_begin(&first);
+        printf("\"policy\": \"%s\", \"median_us\": %.3f}", names[p], median(samples, BENCH_FAIL_SAMPLES));
+    }
+
+    printf("\n  ]\n");
+}
+
+/* Recursion builds the stack, captures are done in the deepest frame. Returns frames of the last capture */
+static size_t __attribute__(( noinline )) bench_stack_capture(unsigned int depth)
+{
+    if (depth > 0)
+    {
+        const size_t ret = bench_stack_capture(depth - 1);
+
+        /* Not a tail call, so every level keeps its frame */
+        __asm__ volatile("" ::: "memory");
+
+        return ret;
+    }
+
+    void* frames[BENCH_STACK_FRAMES];
+    size_t count = 0;
+
+    for (size_t i = 0; i < BENCH_STACK_CAPTURES; ++i)
+        count = kassert_backtrace(frames, BENCH_STACK_FRAMES);
+
+    sink += (uintptr_t)frames[0];
+
+    return count;
+}
+
+static void bench_stack(void)
+{
+    static const char* const names[KASSERT_UNWINDER_COUNT] =
+    {
+        [KASSERT_UNWINDER_BACKTRACE]     = "backtrace",
+        [KASSERT_UNWINDER_FRAME_POINTER] = "fp"
+    };
+
+    const KASSERT_UNWINDER saved = kassert_unwinder_get();
+    bool first = true;
+
+    printf("  \"stack\": [");
+
+    for (size_t u = 0; u < KASSERT_UNWINDER_COUNT; ++u)
+    {
+        if (!kassert_unwinder_set((KASSERT_UNWINDER)u))
+            continue;
+
+        size_t frames = bench_stack_capture(BENCH_STACK_DEPTH);
+
+        double samples[BENCH_SAMPLES];
+        for (size_t s = 0; s < BENCH_SAMPLES; ++s)
+        {
+            const unsigned long long start = now_ns();
+            frames = bench_stack_capture(BENCH_STACK_DEPTH);
+            const unsigned long long stop = now_ns();
+
+            samples[s] = (double)(stop - start) / BENCH_STACK_CAPTURES;
+        }
+
+        const double ns = median(samples, BENCH_SAMPLES);
+
+        json_row_begin(&first);
+        printf("\"unwinder\": \"%s\", \"frames\": %zu, \"ns\": %.3f, \"captures_per_s\": %.0f}", names[u], frames, ns, 1e9 / ns);
+    }
+
+    printf("\n  ],\n");
+
+    (void)kassert_unwinder_set(saved);
+}
+
+/* Kernel is KASSERT_CRC32C_KERNEL or KASSERT_CRC32C_KERNEL_COUNT for XXH64 */
+static unsigned long long bench_checksum_run(int kernel, const unsigned char* buf, size_t size)
+{
+    unsigned long long sum = 0;
+
+    for (size_t done = 0; done < BENCH_CHECKSUM_BYTES; done += size)
+        sum += kernel == KASSERT_CRC32C_KERNEL_COUNT ? kassert_xxh64(buf, size, 0) : kassert_crc32c(buf, size);
+
+    return sum;
+}
+
+static void bench_checksum(void)
+{
+    static const char* const names[KASSERT_CRC32C_KERNEL_COUNT + 1] =
+    {
+        [KASSERT_CRC32C_KERNEL_SLICE8] = "crc32c_slice8",
+        [KASSERT_CRC32C_KERNEL_SSE42]  = "crc32c_sse42",
+        [KASSERT_CRC32C_KERNEL_PCLMUL] = "crc32c_pclmul",
+        [KASSERT_CRC32C_KERNEL_COUNT]  = "xxh64"
+    };
+    static const size_t sizes[] = { 4096, 256 << 10, BENCH_CHECKSUM_BYTES };
+
+    unsigned char* buf = malloc(BENCH_CHECKSUM_BYTES);
+    if (buf == NULL)
+        return;
+
+    for (size_t i = 0; i < BENCH_CHECKSUM_BYTES; ++i)
+        buf[i] = (unsigned char)(i * 131 + (i >> 11));
+
+    const KASSERT_CRC32C_KERNEL saved = kassert_crc32c_kernel_get();
+    bool first = true;
+
+    printf("  \"checksum\": [");
+
+    for (int k = 0; k <= KASSERT_CRC32C_KERNEL_COUNT; ++k)
+    {
+        if (k != KASSERT_CRC32C_KERNEL_COUNT && !kassert_crc32c_kernel_set((KASSERT_CRC32C_KERNEL)k))
+            continue;
+
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        {
+            sink += bench_checksum_run(k, buf, sizes[s]);
+
+            double samples[BENCH_SAMPLES];
+            for (size_t i = 0; i < BENCH_SAMPLES; ++i)
+            {
+                const unsigned long long start = now_ns();
+                sink += bench_checksum_run(k, buf, sizes[s]);
+                const unsigned long long stop = now_ns();
+
+                samples[i] = (double)BENCH_CHECKSUM_BYTES / (double)(stop - start);
+            }
+
+            json_row_begin(&first);
+            printf("\"kernel\": \"%s\", \"bytes\": %zu, \"gb_per_s\": %.3f}", names[k], sizes[s], median(samples, BENCH_SAMPLES));
+        }
+    }
+
+    printf("\n  ],\n");
+
+    (void)kassert_crc32c_kernel_set(saved);
+    free(buf);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+int __attribute__(( noinline )) bench_get_int(const int* array, size_t i)
+{
+    return array[i];
+}
+
+int main(void)
+{
+    data_init();
+
+    printf("{\n");
+    printf("  \"schema\": 1,\n");
+    printf("  \"units\": {\"ops\": \"ns\", \"extras\": \"ns\", \"vectorization\": \"ns\", \"text\": \"bytes\", \"failure\": \"us\", \"failure_policy\": \"us\", \"stack\": \"ns\", \"checksum\": \"GB/s\"},\n");
+    printf("  \"elements\": %d,\n", BENCH_N);
+
+    bench_ops();
+    bench_extras();
+    bench_vecs();
+    bench_text();
+    bench_stack();
+    bench_checksum();
+    bench_failure();
+    bench_failure_policy();
+
+    printf("}\n");
+
+    return 0;
+}
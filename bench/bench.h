@@ -0,0 +1,125 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+    This is the private header for the KAssert benchmarks.
+
+    Every benchmark is compiled once per mode (see bench-template.h):
+    kassert - KASSERT_* macros
+    assert  - assert() from assert.h
+    expect  - if (__builtin_expect(!(cond), 0)) abort()
+    ndebug  - KASSERT_* macros with NDEBUG, so no checks at all
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Number of elements processed by one call of the benchmark */
+#define BENCH_N          4096
+
+/* Number of checks in the function used to measure .text bytes per site */
+#define BENCH_TEXT_SITES 32
+
+/*
+    Operands of every benchmark are taken from arrays, so compiler cannot fold checks:
+    lo[i] < hi[i], eq[i] == lo[i], nul[i] == NULL (only pointers)
+*/
+typedef struct bench_data
+{
+    const void* lo;
+    const void* hi;
+    const void* eq;
+    const void* nul;
+    void*       out;
+} bench_data_t;
+
+typedef unsigned long long (*bench_fn_t)(const bench_data_t* data, size_t n);
+
+/* X(arg, name, type), all KASSERT_PRIMITIVES and pointer */
+#define BENCH_TYPES(X, arg) \
+    X(arg, boolean,            bool) \
+    X(arg, char,               char) \
+    X(arg, signed_char,        signed char) \
+    X(arg, unsigned_char,      unsigned char) \
+    X(arg, short,              short) \
+    X(arg, unsigned_short,     unsigned short) \
+    X(arg, int,                int) \
+    X(arg, unsigned_int,       unsigned int) \
+    X(arg, long,               long) \
+    X(arg, unsigned_long,      unsigned long) \
+    X(arg, long_long,          long long) \
+    X(arg, unsigned_long_long, unsigned long long) \
+    X(arg, float,              float) \
+    X(arg, double,             double) \
+    X(arg, long_double,        long double) \
+    X(arg, pointer,            char*)
+
+/* X(arg, op, first operand, second operand), relation always holds */
+#define BENCH_OPS(X, arg) \
+    X(arg, EQ,  lo, eq) \
+    X(arg, NEQ, lo, hi) \
+    X(arg, LT,  lo, hi) \
+    X(arg, LEQ, lo, hi) \
+    X(arg, GT,  hi, lo) \
+    X(arg, GEQ, hi, lo)
+
+/* X(arg, name, macro) benchmarks of other macros, operands are int (or char* for pointer macros) */
+#define BENCH_EXTRAS(X, arg) \
+    X(arg, cond,            KASSERT) \
+    X(arg, ptr_not_null,    KASSERT_PTR_NOT_NULL) \
+    X(arg, ptr_null,        KASSERT_PTR_NULL) \
+    X(arg, call,            KASSERT_LT) \
+    X(arg, level_disabled,  KASSERT_LT_L) \
+    X(arg, sampled,         KASSERT_LT_SAMPLED) \
+    X(arg, once,            KASSERT_LT_ONCE) \
+    X(arg, once_per_thread, KASSERT_LT_ONCE_PER_THREAD) \
+    X(arg, soft,            KASSERT_SOFT_LT) \
+    X(arg, on_thread,       KASSERT_ON_THREAD) \
+    X(arg, mutex_held,      KASSERT_MUTEX_HELD) \
+    X(arg, deadline,        KASSERT_DEADLINE) \
+    X(arg, no_alloc,        KASSERT_NO_ALLOC_SCOPED)
+
+/* X(arg, name) loops which compiler can vectorize without checks */
+#define BENCH_VECS(X, arg) \
+    X(arg, int_checked) \
+    X(arg, float_checked) \
+    X(arg, float_hoisted)
+
+#define BENCH_ENUM_TYPE(arg, name, type)   BENCH_TYPE_##name,
+#define BENCH_ENUM_OP(arg, op, a, b)       BENCH_OP_##op,
+#define BENCH_ENUM_EXTRA(arg, name, macro) BENCH_EXTRA_##name,
+#define BENCH_ENUM_VEC(arg, name)          BENCH_VEC_##name,
+
+enum { BENCH_TYPES(BENCH_ENUM_TYPE, 0) BENCH_TYPES_COUNT };
+enum { BENCH_OPS(BENCH_ENUM_OP, 0) BENCH_OPS_COUNT };
+enum { BENCH_EXTRAS(BENCH_ENUM_EXTRA, 0) BENCH_EXTRAS_COUNT };
+enum { BENCH_VECS(BENCH_ENUM_VEC, 0) BENCH_VECS_COUNT };
+
+typedef struct bench_mode
+{
+    const char* name;
+    bench_fn_t  ops[BENCH_OPS_COUNT][BENCH_TYPES_COUNT];
+    bench_fn_t  extras[BENCH_EXTRAS_COUNT];
+    bench_fn_t  vecs[BENCH_VECS_COUNT];
+
+    /* Function with BENCH_TEXT_SITES checks, placed alone in the named section */
+    const char* text_start;
+    const char* text_stop;
+
+    /* Fails the check when val != 0, NULL when mode has no checks */
+    void (*fail)(int val);
+} bench_mode_t;
+
+extern const bench_mode_t bench_mode_kassert;
+extern const bench_mode_t bench_mode_assert;
+extern const bench_mode_t bench_mode_expect;
+extern const bench_mode_t bench_mode_ndebug;
+
+/* Not inlined getter, used to benchmark function calls as operands */
+int bench_get_int(const int* array, size_t i);
+
+#endif
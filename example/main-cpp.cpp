@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <string>
+
+/* The same header like in C, C++ front-end is selected by the compiler */
+#include <kassert/kassert.h>
+
+enum class State : uint8_t
+{
+    IDLE,
+    RUNNING
+};
+
+static int get41();
+
+template <typename T>
+static T clamp_add(T a, T b, T max);
+
+static void example1();
+static void example2();
+
+static int get41()
+{
+    return 41;
+}
+
+/* Every instance of the template has own site, report shows it, i.e. [with T = double] */
+template <typename T>
+static T clamp_add(T a, T b, T max)
+{
+    KASSERT_LEQ(a, max);
+    KASSERT_LEQ(b, max);
+
+    return a + b > max ? max : a + b;
+}
+
+/* Please note, that KASSERT terminates program, so comment assert to see another */
+static void example1()
+{
+    /* The same rules like in C: types have to be the same */
+    const int a = 100;
+    int b = get41();
+    KASSERT_EQ(a, b);
+
+    /* long l = 41; KASSERT_EQ(b, l); does not compile (Uncompatible types) */
+
+    /* bool can be compared with constant 0 / 1 only, KASSERT_EQ(running, 2) does not compile */
+    bool running = false;
+    KASSERT_EQ(running, true);
+
+    /* Enums are printed as the underlying type */
+    State state = State::IDLE;
+    KASSERT_EQ(state, State::RUNNING);
+
+    (void)clamp_add(1.5, 2.5, 2.0);
+}
+
+/* Please note, that KASSERT terminates program, so comment assert to see another */
+static void example2()
+{
+    /* nullptr is a pointer, NULL in C++ is an integer */
+    const std::string str = "KAssert";
+    const char* ptr = str.c_str();
+    KASSERT_EQ(ptr, nullptr);
+    KASSERT_PTR_NULL(ptr);
+
+    /* Only primitives and pointers can be printed, compare class types by KASSERT(cond) */
+    KASSERT(str == "KASSERT");
+
+    const int arr[] = { 1, 2, 3, 4, 5 };
+    KASSERT_ALL_IN_RANGE(arr, 5, 2, 5);
+}
+
+int main()
+{
+    example1();
+    example2();
+
+    return 0;
+}
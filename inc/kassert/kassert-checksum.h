@@ -0,0 +1,59 @@
+#ifndef KASSERT_CHECKSUM_H
+#define KASSERT_CHECKSUM_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Checksums of KASSERT_CRC32C_EQ and KASSERT_XXH64_EQ.
+
+    CRC32C (Castagnoli, iSCSI / ext4 / SCTP) kernels:
+    SLICE8 - slice-by-8 tables, 8 bytes per step, every architecture
+    SSE42  - crc32 instruction, 8 bytes per instruction, x86_64 with SSE4.2
+    PCLMUL - crc32 instruction on 3 interleaved streams (latency of crc32 is hidden),
+             streams are folded together by carry-less multiply, x86_64 with SSE4.2 and PCLMULQDQ.
+             Used for buffers of at least 768 bytes, shorter ones are done like by SSE42.
+
+    The best kernel supported by the CPU is selected on the first call.
+    XXH64 is portable C, 4 lanes of 64-bit multiplies, results are the same like by the reference xxHash.
+
+    Environment variables (read on the first call):
+    KASSERT_CRC32C_KERNEL - slice8, sse42 or pclmul, can only lower the kernel
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-checksum.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum KASSERT_CRC32C_KERNEL
+{
+    KASSERT_CRC32C_KERNEL_SLICE8,
+    KASSERT_CRC32C_KERNEL_SSE42,
+    KASSERT_CRC32C_KERNEL_PCLMUL,
+    KASSERT_CRC32C_KERNEL_COUNT
+} KASSERT_CRC32C_KERNEL;
+
+/* Returns false when the kernel is not supported by the CPU */
+bool kassert_crc32c_kernel_set(KASSERT_CRC32C_KERNEL kernel);
+
+KASSERT_CRC32C_KERNEL kassert_crc32c_kernel_get(void);
+
+/* CRC32C of the buffer (initial value and final xor are 0xffffffff), crc32c("123456789") == 0xe3069283 */
+uint32_t kassert_crc32c(const void* buf, size_t len);
+
+/* Continues CRC32C returned for the previous part of the data, kassert_crc32c(buf, len) == kassert_crc32c_update(0, buf, len) */
+uint32_t kassert_crc32c_update(uint32_t crc, const void* buf, size_t len);
+
+/* XXH64 of the buffer with the seed */
+uint64_t kassert_xxh64(const void* buf, size_t len, uint64_t seed);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef KASSERT_CONTEXT_H
+#define KASSERT_CONTEXT_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Context breadcrumbs. Every thread has a small ring of (tag, value) entries,
+    KASSERT_CONTEXT_PUSH writes tag pointer, type tag and raw value into the next entry
+    and bumps the depth, so it is a handful of stores into thread-local memory, no formatting and no calls.
+    Fatal failure renders the ring of the failing thread, newest entry first:
+
+    Context (newest first):
+        key = 42
+        shard = 7
+        request = 0x7f3a1c000b70
+
+    When more than KASSERT_CONTEXT_DEPTH entries are pushed, the oldest are overwritten.
+    Entry is stamped with its depth, so entries overwritten by pushes which are popped already are not printed.
+    Ring is thread-local with initial-exec TLS model, so push is one %fs relative access also in PIC code
+    (library with KAssert sites cannot be loaded by dlopen when static TLS of the process is exhausted).
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-context.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include "kassert-primitive-fmt.h"
+
+/* Entries of the ring, power of 2 */
+#define KASSERT_CONTEXT_DEPTH 16
+
+/* Raw value of the entry, long double is stored as double */
+typedef union kassert_context_value
+{
+    long long          s;
+    unsigned long long u;
+    double             d;
+    const void*        ptr;
+} kassert_context_value_t;
+
+typedef struct kassert_context_entry
+{
+    const char*             tag;    /* string literal */
+    KASSERT_PRIMITIVES      type;
+    unsigned int            depth;  /* depth of the push, entry is stale (overwritten by deeper push) when it differs */
+    kassert_context_value_t value;
+} kassert_context_entry_t;
+
+typedef struct kassert_context
+{
+    unsigned int            depth;  /* pushes - pops, entry depth % KASSERT_CONTEXT_DEPTH is the next one */
+    kassert_context_entry_t entries[KASSERT_CONTEXT_DEPTH];
+} kassert_context_t;
+
+extern __thread kassert_context_t __kassert_context __attribute__(( tls_model("initial-exec") ));
+
+/* Next entry with tag, type and depth, value is stored by caller */
+static inline kassert_context_entry_t* __kassert_context_entry(const char* tag, KASSERT_PRIMITIVES type)
+{
+    const unsigned int depth = __kassert_context.depth;
+    kassert_context_entry_t* const entry = &__kassert_context.entries[depth % KASSERT_CONTEXT_DEPTH];
+    entry->tag = tag;
+    entry->type = type;
+    entry->depth = depth;
+
+    return entry;
+}
+
+/* Makes the entry visible, returns depth before push */
+static inline unsigned int __kassert_context_commit(void)
+{
+    const unsigned int depth = __kassert_context.depth;
+
+    /* Failure in signal handler sees only complete entries */
+    __atomic_signal_fence(__ATOMIC_RELEASE);
+    __kassert_context.depth = depth + 1;
+
+    return depth;
+}
+
+static inline unsigned int __kassert_context_push_s(const char* tag, KASSERT_PRIMITIVES type, long long val)
+{
+    __kassert_context_entry(tag, type)->value.s = val;
+    return __kassert_context_commit();
+}
+
+static inline unsigned int __kassert_context_push_u(const char* tag, KASSERT_PRIMITIVES type, unsigned long long val)
+{
+    __kassert_context_entry(tag, type)->value.u = val;
+    return __kassert_context_commit();
+}
+
+static inline unsigned int __kassert_context_push_d(const char* tag, KASSERT_PRIMITIVES type, double val)
+{
+    __kassert_context_entry(tag, type)->value.d = val;
+    return __kassert_context_commit();
+}
+
+/* Rare, out of line, so the conversion is not in headers compiled as C++ */
+unsigned int __kassert_context_push_ld(const char* tag, KASSERT_PRIMITIVES type, long double val);
+
+static inline unsigned int __kassert_context_push_p(const char* tag, KASSERT_PRIMITIVES type, const void* val)
+{
+    __kassert_context_entry(tag, type)->value.ptr = val;
+    return __kassert_context_commit();
+}
+
+static inline void __kassert_context_pop(void)
+{
+    if (__kassert_context.depth != 0)
+        --__kassert_context.depth;
+}
+
+/* Cleanup of KASSERT_CONTEXT_SCOPED, drops entries pushed since the scoped push (also not popped ones) */
+static inline void __kassert_context_restore(const unsigned int* depth)
+{
+    __kassert_context.depth = *depth;
+}
+
+#endif
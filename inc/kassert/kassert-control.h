@@ -0,0 +1,83 @@
+#ifndef KASSERT_CONTROL_H
+#define KASSERT_CONTROL_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Runtime control of assertion sites. Every site has its own enabled flag,
+    which can be changed by level, file glob or site id.
+
+    Sources of changes:
+    1. Environment variable KASSERT_CONTROL, parsed during startup.
+    2. API from this header.
+    3. Control file (KASSERT_CONTROL_FILE environment variable or kassert_control_file_watch).
+       File is mmaped and polled by KAssert thread, so operator can change rules when process is alive.
+       File contains the same rules like KASSERT_CONTROL, each change resets sites to
+       startup state (compile time default + KASSERT_CONTROL) and applies rules from file.
+       Please note that file has fixed size (created by KAssert when does not exist),
+       so overwrite it in place, rules end on the first NUL, i.e. printf 'level=paranoid\0' | dd of=file conv=notrunc
+
+    Rules are separated by ',' ';' or white chars:
+    level=<none|cheap|normal|expensive|paranoid> - enable sites with level <= given level, disable others
+    +file=<glob>                                  - enable all sites from matched files (full path or basename)
+    -file=<glob>                                  - disable all sites from matched files
+    +site=<id>                                    - enable site with id
+    -site=<id>                                    - disable site with id
+    rate=<N>:file=<glob>                          - set sampling rate of sampled sites from matched files
+    rate=<N>:site=<id>                            - set sampling rate of sampled site with id
+
+    Rules are applied in order, so later rule wins, i.e. "level=cheap,+file=src/tree*.c"
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-control.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include "kassert-site.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Special level for kassert_set_level, disables all sites */
+#define KASSERT_LEVEL_NONE (-1)
+
+/* Enables sites with level <= level, disables others. Use KASSERT_LEVEL_NONE to disable all */
+void kassert_set_level(int level);
+
+/* Enables or disables all sites from files matched by glob. Returns number of matched sites */
+size_t kassert_enable_file(const char* glob, bool enable);
+
+/* Enables or disables site by id. Returns false when there is no such site */
+bool kassert_enable_site(size_t id, bool enable);
+
+/* Sets sampling rate of KASSERT_*_SAMPLED site. Returns false when there is no such site or site is not sampled */
+bool kassert_site_set_rate(size_t id, unsigned int rate);
+
+/* Sets sampling rate of all KASSERT_*_SAMPLED sites from files matched by glob. Returns number of matched sites */
+size_t kassert_file_set_rate(const char* glob, unsigned int rate);
+
+/* Applies rules (syntax like KASSERT_CONTROL). Returns false when some rule is invalid (valid rules are applied) */
+bool kassert_control(const char* rules);
+
+/*
+    Maps control file (creates it when does not exist) and starts thread which polls it
+    every poll_ms milliseconds. Returns false on error.
+*/
+bool kassert_control_file_watch(const char* path, unsigned poll_ms);
+
+/* Number of sites in the program, ids are in range [0, count). C++ sites are counted after their first evaluation */
+size_t kassert_sites_count(void);
+
+/* Returns descriptor of the site with id or NULL */
+const kassert_site_t* kassert_site_get(size_t id);
+
+/* Writes list of all sites (id, level, enabled, location, expression) to fd */
+void kassert_sites_dump(int fd);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef KASSERT_CRASH_H
+#define KASSERT_CRASH_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Crash-record sink. Text report on stderr can be lost or truncated by log shippers,
+    so failure can be also stored as compact binary record in preallocated mmaped file.
+    Record is written before the text report and has no formatting: site descriptor, raw operand bytes
+    with their KASSERT_PRIMITIVES tags, ThreadID, timestamp and raw return addresses.
+    File header keeps loaded objects (path, load bias, build-id) from the time of opening.
+
+    Records are rendered offline by kassert-decode (built by make), which symbolizes them
+    against the matching binary: kassert-decode <crash file> [binary]
+
+    Environment variables (read during startup):
+    KASSERT_CRASH_FILE    - path of the file, sink is enabled when it is set. %p is replaced by PID
+    KASSERT_CRASH_RECORDS - number of slots (default 16), the newest records are kept
+
+    Please note that objects loaded by dlopen after opening the file are not in the header,
+    their frames are decoded as raw addresses.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-crash.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+
+/*
+    Creates (or truncates) file with records slots (0 means default) and mmaps it.
+    Returns false on error or when file is already opened.
+*/
+bool kassert_crash_file_open(const char* path, unsigned int records);
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef KASSERT_DEADLINE_H
+#define KASSERT_DEADLINE_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Clock of latency-budget assertions (KASSERT_ELAPSED_LT, KASSERT_DEADLINE).
+
+    TSC       - rdtsc, used on x86 when CPU reports invariant TSC (constant rate, does not stop in sleep states).
+                Ticks are converted to ns by multiply and shift. The rate is calibrated against CLOCK_MONOTONIC:
+                startup stores a pair of readings, the first reading of the clock 10ms later (or more) takes
+                the second pair and publishes the conversion. Until then MONOTONIC is used,
+                there is no calibration thread and nothing spins.
+                TSC timestamps have the top bit set, so start taken before the switch is still measured by MONOTONIC.
+    MONOTONIC - clock_gettime(CLOCK_MONOTONIC) (vDSO), ticks are ns.
+
+    rdtsc is not serializing, so a few instructions around the reading can be reordered.
+    Budgets are supposed to be in us / ms, there it does not matter.
+
+    Environment variables (read during startup):
+    KASSERT_CLOCK - tsc or monotonic
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-deadline.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+
+#include "kassert-site.h"
+
+typedef enum KASSERT_CLOCK
+{
+    KASSERT_CLOCK_TSC,
+    KASSERT_CLOCK_MONOTONIC,
+    KASSERT_CLOCK_COUNT
+} KASSERT_CLOCK;
+
+/* Marks timestamps of TSC, ticks do not reach it (~100 years at 3 GHz) */
+#define KASSERT_CLOCK_TSC_BIT (1ULL << 63)
+
+/* Clock used by kassert_now, TSC after the calibration is finished */
+KASSERT_CLOCK kassert_clock_get(void);
+
+/* Set by the calibrating reading after __kassert_clock_conv, then only read */
+extern bool __kassert_clock_tsc;
+
+/* Conversion of TSC ticks, multiplier in low 32 bits and shift in high bits */
+extern unsigned long long __kassert_clock_conv;
+
+/* Monotonic time in ns, used by KASSERT_PROFILE when there is no cycle counter */
+unsigned long long __kassert_profile_now(void);
+
+/* Monotonic time in ns, calibrates TSC when it is selected and the startup was at least 10ms ago */
+unsigned long long __kassert_clock_now(void);
+
+/* Reports failure of KASSERT_DEADLINE / KASSERT_ELAPSED_LT site (fatal or soft like the site) */
+void __attribute__ ((cold)) __kassert_deadline_fail(const kassert_site_t* site,
+                                                    unsigned long long elapsed_ns,
+                                                    unsigned long long budget_ns);
+
+/* Timestamp in ticks of the clock, pass it to KASSERT_ELAPSED_LT or kassert_elapsed_ns */
+static inline unsigned long long kassert_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_expect(__atomic_load_n(&__kassert_clock_tsc, __ATOMIC_ACQUIRE), 1))
+        return __builtin_ia32_rdtsc() | KASSERT_CLOCK_TSC_BIT;
+#endif
+
+    return __kassert_clock_now();
+}
+
+/* Difference of two timestamps of the same clock in ns */
+static inline unsigned long long kassert_ticks_to_ns(unsigned long long ticks)
+{
+    if (!__atomic_load_n(&__kassert_clock_tsc, __ATOMIC_ACQUIRE))
+        return ticks;
+
+    const unsigned long long conv = __atomic_load_n(&__kassert_clock_conv, __ATOMIC_RELAXED);
+
+    /* 64 x 32 bit multiplication in two halves, so long intervals do not overflow */
+    const unsigned long long mult = conv & 0xffffffffULL;
+    const unsigned int shift = (unsigned int)(conv >> 32);
+
+    return (((ticks >> 32) * mult) << (32 - shift)) + (((ticks & 0xffffffffULL) * mult) >> shift);
+}
+
+/* ns since start (from kassert_now), end is read from the clock of start */
+static inline unsigned long long kassert_elapsed_ns(unsigned long long start)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_expect((start & KASSERT_CLOCK_TSC_BIT) != 0, 1))
+        return kassert_ticks_to_ns((__builtin_ia32_rdtsc() | KASSERT_CLOCK_TSC_BIT) - start);
+#endif
+
+    return __kassert_clock_now() - start;
+}
+
+/* Guard of KASSERT_DEADLINE, site is NULL when the site is disabled */
+typedef struct kassert_deadline
+{
+    const kassert_site_t* site;
+    unsigned long long    start;
+    unsigned long long    budget_ns;
+} kassert_deadline_t;
+
+static inline kassert_deadline_t __kassert_deadline_start(const kassert_site_t* site, unsigned long long budget_ns)
+{
+    const kassert_deadline_t deadline = { site, site != NULL ? kassert_now() : 0, budget_ns };
+
+    return deadline;
+}
+
+/* Cleanup of KASSERT_DEADLINE */
+static inline void __kassert_deadline_check(const kassert_deadline_t* deadline)
+{
+    if (deadline->site == NULL)
+        return;
+
+    const unsigned long long elapsed_ns = kassert_elapsed_ns(deadline->start);
+    if (__builtin_expect(elapsed_ns >= deadline->budget_ns, 0))
+        __kassert_deadline_fail(deadline->site, elapsed_ns, deadline->budget_ns);
+}
+
+#endif
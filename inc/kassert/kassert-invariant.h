@@ -0,0 +1,80 @@
+#ifndef KASSERT_INVARIANT_H
+#define KASSERT_INVARIANT_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Registered invariant checkers. Checks of whole structures (free list is acyclic, index matches table)
+    are too expensive for the hot path, so they are registered once by KASSERT_INVARIANT_REGISTER
+    and KAssert thread runs them round-robin, one call of every checker per round.
+
+    Checker can be resumable: it gets context with cursor (0 at the beginning of the pass) and deadline
+    of this call (registered budget). It checks part of the object, stores position in cursor
+    and returns KASSERT_INVARIANT_MORE, next call continues from the cursor.
+
+    Optional hooks:
+    lock   - called before every call of the checker, false means object is busy and call is skipped
+             (so it can be trylock and writers never wait for the checker)
+    unlock - called after every call of the checker
+    epoch  - version of the object, when it changed between calls of one pass the pass starts again from cursor 0
+
+    Failed checker is reported like failed assertion of the site which registered it (with ThreadID of the KAssert thread).
+    Checkers run only when the registering site is enabled (see kassert-control.h).
+
+    Environment variables (read when thread starts):
+    KASSERT_INVARIANT_INTERVAL_MS - pause between rounds (default 10)
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-invariant.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+
+typedef enum KASSERT_INVARIANT_RESULT
+{
+    KASSERT_INVARIANT_OK,       /* pass is finished, invariant holds */
+    KASSERT_INVARIANT_MORE,     /* part of the object is checked, call again with the same context */
+    KASSERT_INVARIANT_FAILED    /* invariant does not hold */
+} KASSERT_INVARIANT_RESULT;
+
+typedef struct kassert_invariant_ctx
+{
+    unsigned long long cursor;       /* owned by checker, 0 at the beginning of the pass */
+    unsigned long long deadline_ns;  /* CLOCK_MONOTONIC, 0 when there is no budget */
+} kassert_invariant_ctx_t;
+
+typedef KASSERT_INVARIANT_RESULT (*kassert_invariant_fn_t)(void* obj, kassert_invariant_ctx_t* ctx);
+
+typedef struct kassert_invariant_hooks
+{
+    bool               (*lock)(void* obj);
+    void               (*unlock)(void* obj);
+    unsigned long long (*epoch)(void* obj);
+} kassert_invariant_hooks_t;
+
+/* Handle of the registered checker */
+typedef struct kassert_invariant kassert_invariant_t;
+
+/* True when the budget of this call is spent, checker should store cursor and return KASSERT_INVARIANT_MORE */
+bool kassert_invariant_expired(const kassert_invariant_ctx_t* ctx);
+
+/* Removes checker, waits when checker is running. Do not call it from the checker or hooks. NULL and unknown handles are ignored */
+void kassert_invariant_unregister(kassert_invariant_t* inv);
+
+/*
+    Runs full passes of all registered checkers of enabled sites in the calling thread (i.e. at checkpoints and in tests).
+    Checker whose lock hook keeps refusing is skipped, its passes are not incremented.
+*/
+void kassert_invariant_check_all(void);
+
+/* Number of finished passes of the checker (0 for NULL) */
+unsigned long long kassert_invariant_passes(const kassert_invariant_t* inv);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef KASSERT_NOALLOC_H
+#define KASSERT_NOALLOC_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    No-allocation regions. KASSERT_NO_ALLOC_BEGIN bumps thread-local depth of the region,
+    KASSERT_NO_ALLOC_END drops it, so region costs a TLS increment and decrement.
+
+    Allocations are seen only with the interposer of the allocator, libkassert-noalloc.a.
+    It defines malloc, calloc, realloc, free, posix_memalign, aligned_alloc and memalign,
+    counts calls and bytes in thread-local counters and forwards to glibc (__libc_malloc, ...).
+    When nothing allocates in the region, nothing else is done. Call in the region (except free(NULL))
+    fails at once with stacktrace of the offending call. Function and size (or pointer for free)
+    are printed as the newest context entry, the location is the one of KASSERT_NO_ALLOC_BEGIN:
+
+    main.c:12: handle: Assertion 'no allocation in region' failed.
+    ThreadID: 739210
+    Context (newest first):
+        malloc = 64
+    Stacktrace:
+
+    Failure ends the region, so allocations done by the report, atexit handlers or the failure policy pass.
+    Link the interposer as the whole archive, so malloc is taken also when objects do not call it directly:
+    -Wl,--whole-archive -lkassert-noalloc -Wl,--no-whole-archive -lkassert -lpthread
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-noalloc.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "kassert-site.h"
+
+/* Counters of the calling thread, updated by the interposer */
+typedef struct kassert_alloc_counters
+{
+    unsigned long long allocs;  /* malloc, calloc, realloc, posix_memalign, aligned_alloc, memalign */
+    unsigned long long frees;   /* free of non NULL pointer */
+    unsigned long long bytes;   /* requested bytes */
+} kassert_alloc_counters_t;
+
+extern __thread unsigned int             __kassert_noalloc_depth  __attribute__(( tls_model("initial-exec") ));
+extern __thread const kassert_site_t*    __kassert_noalloc_site   __attribute__(( tls_model("initial-exec") ));
+extern __thread kassert_alloc_counters_t __kassert_alloc_counters __attribute__(( tls_model("initial-exec") ));
+
+/* True when libkassert-noalloc.a is linked */
+bool kassert_alloc_interposed(void);
+
+/* Counters of the calling thread, all zero without the interposer */
+kassert_alloc_counters_t kassert_alloc_counters_get(void);
+
+/* Called by the interposer for allocation / free in the region, returns when the site is disabled */
+void __attribute__ ((cold)) __kassert_noalloc_fail(const char* fn, size_t size);
+void __attribute__ ((cold)) __kassert_noalloc_fail_free(const void* ptr);
+
+/* Outer region keeps its site, returns depth before the begin */
+static inline unsigned int __kassert_noalloc_begin(const kassert_site_t* site)
+{
+    const unsigned int depth = __kassert_noalloc_depth;
+    if (depth == 0)
+        __kassert_noalloc_site = site;
+
+    __kassert_noalloc_depth = depth + 1;
+
+    return depth;
+}
+
+static inline void __kassert_noalloc_end(void)
+{
+    if (__kassert_noalloc_depth != 0)
+        --__kassert_noalloc_depth;
+}
+
+/* Cleanup of KASSERT_NO_ALLOC_SCOPED, also ends regions begun and not ended in the scope */
+static inline void __kassert_noalloc_restore(const unsigned int* depth)
+{
+    __kassert_noalloc_depth = *depth;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef KASSERT_OWNER_H
+#define KASSERT_OWNER_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Thread identity and ownership. ThreadID (gettid) of the calling thread is cached in thread-local variable,
+    so kassert_gettid is one %fs relative load after the first call (the first call makes the syscall).
+    Cache is cleared in the child after fork by pthread_atfork handler, so child does not see ThreadID of the parent.
+    Please note that raw clone / vfork children (without pthread_atfork) keep the cache of the parent.
+
+    KASSERT_ON_THREAD / KASSERT_NOT_ON_THREAD compare cached ThreadID with the owner of a data structure,
+    i.e. pid_t owner set by kassert_gettid() when the structure is created.
+
+    kassert_mutex_t is optional wrapper of pthread_mutex_t which tracks ThreadID of the owner,
+    KASSERT_MUTEX_HELD / KASSERT_MUTEX_NOT_HELD work only with it. Lock and unlock add one store of the owner
+    next to the atomic operation of the mutex. Recursive mutexes are supported, owner is cleared by the last unlock.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-owner.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+extern __thread pid_t __kassert_tid __attribute__(( tls_model("initial-exec") ));
+
+/* Reads ThreadID by syscall and caches it */
+pid_t __kassert_tid_refresh(void);
+
+/* ThreadID of the calling thread. Async-signal-safe */
+static inline pid_t kassert_gettid(void)
+{
+    const pid_t tid = __kassert_tid;
+    if (__builtin_expect(tid != 0, 1))
+        return tid;
+
+    return __kassert_tid_refresh();
+}
+
+typedef struct kassert_mutex
+{
+    pthread_mutex_t mutex;
+    pid_t           owner;  /* ThreadID of the owner, 0 when unlocked. Read by other threads */
+    unsigned int    count;  /* locks of the owner (recursive mutex), changed only by the owner */
+} kassert_mutex_t;
+
+#define KASSERT_MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER, 0, 0 }
+
+/* Lock is taken, the first lock of the owner sets the owner */
+static inline void __kassert_mutex_acquired(kassert_mutex_t* m)
+{
+    if (m->count++ == 0)
+        __atomic_store_n(&m->owner, kassert_gettid(), __ATOMIC_RELAXED);
+}
+
+static inline int kassert_mutex_init(kassert_mutex_t* m, const pthread_mutexattr_t* attr)
+{
+    m->owner = 0;
+    m->count = 0;
+
+    return pthread_mutex_init(&m->mutex, attr);
+}
+
+static inline int kassert_mutex_destroy(kassert_mutex_t* m)
+{
+    return pthread_mutex_destroy(&m->mutex);
+}
+
+/* ThreadID of the owner, 0 when mutex is not locked */
+static inline pid_t kassert_mutex_owner(const kassert_mutex_t* m)
+{
+    return __atomic_load_n(&m->owner, __ATOMIC_RELAXED);
+}
+
+static inline int kassert_mutex_lock(kassert_mutex_t* m)
+{
+    const int ret = pthread_mutex_lock(&m->mutex);
+
+    /* Robust mutex of dead owner is locked too, counter of the dead owner is dropped */
+    if (ret == EOWNERDEAD)
+        m->count = 0;
+
+    if (ret == 0 || ret == EOWNERDEAD)
+        __kassert_mutex_acquired(m);
+
+    return ret;
+}
+
+static inline int kassert_mutex_trylock(kassert_mutex_t* m)
+{
+    const int ret = pthread_mutex_trylock(&m->mutex);
+
+    if (ret == EOWNERDEAD)
+        m->count = 0;
+
+    if (ret == 0 || ret == EOWNERDEAD)
+        __kassert_mutex_acquired(m);
+
+    return ret;
+}
+
+/* Owner is cleared before the unlock, unlock by other thread (error for error-checking mutex) does not change it */
+static inline int kassert_mutex_unlock(kassert_mutex_t* m)
+{
+    if (kassert_mutex_owner(m) == kassert_gettid() && --m->count == 0)
+        __atomic_store_n(&m->owner, 0, __ATOMIC_RELAXED);
+
+    return pthread_mutex_unlock(&m->mutex);
+}
+
+/* Mutex is released during the wait, so owner is cleared and restored (also counter of recursive mutex) */
+static inline int kassert_mutex_cond_wait(pthread_cond_t* cond, kassert_mutex_t* m)
+{
+    const unsigned int count = m->count;
+
+    m->count = 0;
+    __atomic_store_n(&m->owner, 0, __ATOMIC_RELAXED);
+
+    const int ret = pthread_cond_wait(cond, &m->mutex);
+
+    m->count = count;
+    __atomic_store_n(&m->owner, kassert_gettid(), __ATOMIC_RELAXED);
+
+    return ret;
+}
+
+#endif
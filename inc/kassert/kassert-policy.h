@@ -0,0 +1,63 @@
+#ifndef KASSERT_POLICY_H
+#define KASSERT_POLICY_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Failure policy. It says how the process ends after the report of fatal failure.
+    Report is written by write(2) before the policy is applied, so it is not lost by any of them.
+
+    EXIT       - exit(1), atexit handlers and stdio flush run (default)
+    FAST_EXIT  - _exit(1) after the report, atexit handlers, stdio buffers and pending soft records are dropped
+    ABORT      - abort(), core dump (when RLIMIT_CORE allows it)
+    CALLBACK   - handler set by kassert_failure_policy_set is called after the report,
+                 when it returns, process ends by _exit(1)
+    FORK_ABORT - after the failure line, ThreadID and context the process forks. Parent ends by _exit(1) immediately,
+                 child (copy of the failing thread) prints stacktrace and aborts, so core and full report are produced
+                 while the supervisor already sees the death. Stacks of other threads are not in the child,
+                 so all-threads capture is skipped.
+
+    Time from the failed check to the exit seen by parent is measured by make bench ("failure_policy"), see README for ranges.
+    EXIT, FAST_EXIT, ABORT and CALLBACK spend most of it on symbolization of the stacktrace, FAST_EXIT and CALLBACK do not
+    depend on the application, EXIT grows with atexit handlers and stdio buffers of the application, ABORT grows with the size of the core.
+    FORK_ABORT parent does not symbolize (child does it as SCHED_IDLE after the parent is gone), it pays clone of the address space,
+    which grows with the mapped memory of the application.
+
+    Environment variables (read during startup):
+    KASSERT_FAILURE_POLICY - exit, fast-exit, abort or fork-abort
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-policy.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+
+typedef enum KASSERT_FAILURE_POLICY
+{
+    KASSERT_FAILURE_POLICY_EXIT,
+    KASSERT_FAILURE_POLICY_FAST_EXIT,
+    KASSERT_FAILURE_POLICY_ABORT,
+    KASSERT_FAILURE_POLICY_CALLBACK,
+    KASSERT_FAILURE_POLICY_FORK_ABORT,
+    KASSERT_FAILURE_POLICY_COUNT
+} KASSERT_FAILURE_POLICY;
+
+/* Called in the failing thread (also in signal handler when check fails there), so it should be async-signal-safe */
+typedef void (*kassert_failure_handler_t)(void* arg);
+
+/*
+    Sets policy applied after the report. Handler and arg are used only by KASSERT_FAILURE_POLICY_CALLBACK.
+    Returns false for unknown policy or CALLBACK without handler.
+*/
+bool kassert_failure_policy_set(KASSERT_FAILURE_POLICY policy, kassert_failure_handler_t handler, void* arg);
+
+KASSERT_FAILURE_POLICY kassert_failure_policy_get(void);
+
+#endif
@@ -0,0 +1,503 @@
+#ifndef KASSERT_PRIV_COMMON_H
+#define KASSERT_PRIV_COMMON_H
+
+/*
+    This is the private header for the KAssert.
+    Do not include it directly
+
+    Runtime entry points and parts of the sites which are the same for C (kassert-priv.h)
+    and C++ (kassert-priv.hpp): gates, profiling, actions, KASSERT(cond), memory and invariant sites.
+    Front-end defines KASSERT_PRIV_STATE_DEFINE, KASSERT_PRIV_SITE_DEFINE and KASSERT_PRIV_ENABLED used by those macros,
+    descriptor is defined before the enabled check (C++ site is registered by its first check).
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-priv-common.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "kassert-primitive-fmt.h"
+#include "kassert-diag.h"
+#include "kassert-site.h"
+#include "kassert-control.h"
+#include "kassert-soft.h"
+#include "kassert-profile.h"
+#include "kassert-invariant.h"
+#include "kassert-crash.h"
+#include "kassert-threads.h"
+#include "kassert-context.h"
+#include "kassert-policy.h"
+#include "kassert-owner.h"
+#include "kassert-stack.h"
+#include "kassert-deadline.h"
+#include "kassert-noalloc.h"
+#include "kassert-checksum.h"
+
+#ifndef TOSTRING
+#define KASSERT_TOSTRING(x) #x
+#define TOSTRING(x) KASSERT_TOSTRING(x)
+#endif
+
+/*
+    Main assert function: prints all stats like location, values, threadID, stacktrace and calls exit(1)
+    For relations (site->op_str != NULL) caller passes both values (after default promotions) as variadic arguments.
+*/
+void __attribute__ ((cold, noreturn)) __kassert_print_and_exit(const kassert_site_t* site, ...);
+
+/* Records failure of KASSERT_SOFT_* site in the ring of the calling thread and returns */
+void __attribute__ ((cold)) __kassert_soft_record(const kassert_site_t* site, ...);
+
+/* Adds one evaluation of the site to the counters of calling thread (KASSERT_PROFILE builds) */
+void __kassert_profile_record(const kassert_site_t* site, unsigned long long time, bool failed);
+
+/*
+    Prints failed element of KASSERT_ALL_* / KASSERT_SORTED / KASSERT_ALL_FINITE site and calls exit(1).
+    Bounds point to values with type of the array element (or NULL when check has no bound).
+*/
+void __attribute__ ((cold, noreturn)) __kassert_array_fail(const kassert_site_t* site,
+                                                           size_t index,
+                                                           const void* array,
+                                                           const void* bound1,
+                                                           const void* bound2);
+
+/*
+    Returns index of the first element which does not pass the check or count when all elements pass.
+    Kernel for the element type is selected on the first call (SSE2 / AVX2 / AVX-512 on x86).
+*/
+size_t __kassert_array_find(KASSERT_ARRAY_OP op,
+                            KASSERT_PRIMITIVES type,
+                            const void* array,
+                            size_t count,
+                            const void* bound1,
+                            const void* bound2);
+
+/*
+    Prints the first differing byte of KASSERT_MEM_* site with hexdump of both buffers around it and calls exit(1).
+    ptr2 is NULL when memory is compared with byte.
+*/
+void __attribute__ ((cold, noreturn)) __kassert_mem_fail(const kassert_site_t* site,
+                                                         size_t offset,
+                                                         const void* ptr1,
+                                                         const void* ptr2,
+                                                         size_t len,
+                                                         unsigned char byte);
+
+/*
+    Returns offset of the first byte of ptr1 which differs from ptr2 (or from byte when ptr2 is NULL) or len when all bytes are equal.
+    Kernel is selected on the first call (SSE2 / AVX2 / AVX-512 on x86).
+*/
+size_t __kassert_mem_find(const void* ptr1, const void* ptr2, size_t len, unsigned char byte);
+
+/*
+    Registers checker of the site (KASSERT_INVARIANT_REGISTER) and starts KAssert thread if needed.
+    hooks can be NULL, budget_us == 0 means no budget. Returns NULL on error.
+*/
+kassert_invariant_t* __kassert_invariant_register(const kassert_site_t* site,
+                                                  kassert_invariant_fn_t fn,
+                                                  void* obj,
+                                                  const kassert_invariant_hooks_t* hooks,
+                                                  unsigned int budget_us);
+
+/*
+    Adds site which is out of KASSERT_SITE_SECTION (C++ site) to the table of sites and sets its startup state
+    (default, KASSERT_CONTROL and control file rules). Called by the first evaluation, returns true when site is enabled.
+*/
+bool __attribute__ ((cold)) __kassert_site_register(const kassert_site_t* site);
+
+/* Draws next countdown of the sampled site (for thread which calls it), returns true */
+bool __kassert_sample_reset(unsigned int* countdown, const unsigned int* rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Casts used by the sites, C++ code with -Wold-style-cast and -Wzero-as-null-pointer-constant sees only static_cast */
+#ifdef __cplusplus
+#define KASSERT_PRIV_CAST(type, val)    static_cast<type>(val)
+#define KASSERT_PRIV_NULL(type)         static_cast<type>(nullptr)
+#else
+#define KASSERT_PRIV_CAST(type, val)    ((type)(val))
+#define KASSERT_PRIV_NULL(type)         ((type)0)
+#endif
+
+/*
+    Static check of the condition (opt-in by KASSERT_STATIC_CHECK).
+    Condition folded by the front-end (sizeof, enums, literals) is checked during compilation,
+    other conditions are not constant and pass. Front-end defines KASSERT_PRIV_STATIC_ASSERT, KASSERT_PRIV_CONSTANT_OR_TRUE
+    and KASSERT_PRIV_IF_CONSTANT (then when the value is constant, else otherwise, both integer constant expressions).
+*/
+#ifdef KASSERT_STATIC_CHECK
+#define KASSERT_PRIV_STATIC_CHECK(cond) \
+    KASSERT_PRIV_STATIC_ASSERT(KASSERT_PRIV_CONSTANT_OR_TRUE(cond), "Assertion '" TOSTRING(cond) "' is false in compile time")
+#else
+#define KASSERT_PRIV_STATIC_CHECK(cond)     do { } while (0)
+#endif
+
+/*
+    Hint for the optimizer that condition is true, used by KASSERT_ASSUME_IN_RELEASE.
+    __builtin_assume (clang) and assume attribute (gcc >= 13) do not evaluate the condition,
+    otherwise the failure branch is unreachable, so condition must not have side effects.
+*/
+#if defined(__has_builtin) && !defined(KASSERT_PRIV_HINT)
+#if __has_builtin(__builtin_assume)
+#define KASSERT_PRIV_HINT(cond)             __builtin_assume(!!(cond))
+#endif
+#endif
+
+#if defined(__has_attribute) && !defined(KASSERT_PRIV_HINT)
+#if __has_attribute(assume)
+#define KASSERT_PRIV_HINT(cond)             __attribute__(( assume(!!(cond)) ))
+#endif
+#endif
+
+#ifndef KASSERT_PRIV_HINT
+#define KASSERT_PRIV_HINT(cond)             do { if (!(cond)) __builtin_unreachable(); } while (0)
+#endif
+
+/*
+    Condition becomes a hint only when it has no side effects (calls of not pure functions, volatile, assignments).
+    Comma expression is folded to constant 1 only in this case, so there is nothing to evaluate in release.
+    Without optimizations nothing is folded and there are no hints.
+*/
+#ifdef KASSERT_ASSUME_IN_RELEASE
+#define KASSERT_PRIV_ASSUME(cond) \
+    do { \
+        if (__builtin_constant_p(((void)(cond), 1))) \
+        { \
+            KASSERT_PRIV_HINT(cond); \
+        } \
+    } while (0)
+#define KASSERT_PRIV_ASSUME_FORCED(cond)    KASSERT_PRIV_HINT(cond)
+#else
+#define KASSERT_PRIV_ASSUME(cond)           do { } while (0)
+#define KASSERT_PRIV_ASSUME_FORCED(cond)    do { } while (0)
+#endif
+
+/* Sites compiled with NDEBUG, condition is never checked in runtime */
+#define KASSERT_PRIV_RELEASE(cond) \
+    do { \
+        KASSERT_PRIV_STATIC_CHECK(cond); \
+        KASSERT_PRIV_ASSUME(cond); \
+    } while (0)
+
+#define KASSERT_PRIV_RELEASE_FORCED(cond) \
+    do { \
+        KASSERT_PRIV_STATIC_CHECK(cond); \
+        KASSERT_PRIV_ASSUME_FORCED(cond); \
+    } while (0)
+
+#define KASSERT_PRIV_RELEASE_OP(val1, val2, op) \
+    do { \
+        KASSERT_DIAG_PUSH() \
+        KASSERT_DIAG_IGNORE("-Wfloat-equal") \
+        KASSERT_PRIV_RELEASE((val1) op (val2)); \
+        KASSERT_DIAG_POP() \
+    } while (0)
+
+#define KASSERT_PRIV_CONCAT_(a, b) a##b
+#define KASSERT_PRIV_CONCAT(a, b)  KASSERT_PRIV_CONCAT_(a, b)
+
+/*
+    Tag has to be a string literal (concatenation with "" does not compile otherwise), ring keeps only the pointer.
+    Front-end defines KASSERT_PRIV_CONTEXT_PUSH(tag, val), which returns depth before the push.
+*/
+#define KASSERT_PRIV_CONTEXT_SCOPED(tag, val) \
+    const unsigned int KASSERT_PRIV_CONCAT(_kassert_context_scope, __COUNTER__) \
+        __attribute__(( cleanup(__kassert_context_restore), unused )) = KASSERT_PRIV_CONTEXT_PUSH("" tag, val)
+
+/*
+    Gates decide if enabled site should be evaluated this time.
+    Every gate has:
+    _DEFINE(rate)  - defines static objects of the gate
+    ()             - expression, true when site should be evaluated
+    _RATE          - pointer to runtime sampling rate (or NULL)
+*/
+
+/* Evaluate always */
+#define KASSERT_PRIV_GATE_ALWAYS_DEFINE(rate)
+#define KASSERT_PRIV_GATE_ALWAYS()                  1
+#define KASSERT_PRIV_GATE_ALWAYS_RATE               KASSERT_PRIV_NULL(unsigned int *)
+
+/*
+    Evaluate ~1/rate executions. Thread-local countdown, so no atomics and no shared cache lines.
+    Next countdown is drawn from xorshift out of line, so we do not synchronize with loops of the program.
+*/
+#define KASSERT_PRIV_GATE_RATE_DEFINE(rate) \
+    static unsigned int _kassert_rate = (rate); \
+    static __thread unsigned int _kassert_countdown
+#define KASSERT_PRIV_GATE_RATE() \
+    (__builtin_expect(_kassert_countdown-- == 0, 0) && __kassert_sample_reset(&_kassert_countdown, &_kassert_rate))
+#define KASSERT_PRIV_GATE_RATE_RATE                 (&_kassert_rate)
+
+/* Evaluate only first execution of the site */
+#define KASSERT_PRIV_GATE_ONCE_DEFINE(rate) \
+    static bool _kassert_done
+#define KASSERT_PRIV_GATE_ONCE() \
+    (__builtin_expect(!__atomic_load_n(&_kassert_done, __ATOMIC_RELAXED), 0) && !__atomic_exchange_n(&_kassert_done, true, __ATOMIC_RELAXED))
+#define KASSERT_PRIV_GATE_ONCE_RATE                 KASSERT_PRIV_NULL(unsigned int *)
+
+/* Evaluate only first execution of the site in each thread */
+#define KASSERT_PRIV_GATE_ONCE_PER_THREAD_DEFINE(rate) \
+    static __thread bool _kassert_done
+#define KASSERT_PRIV_GATE_ONCE_PER_THREAD() \
+    (__builtin_expect(!_kassert_done, 0) && (_kassert_done = true))
+#define KASSERT_PRIV_GATE_ONCE_PER_THREAD_RATE          KASSERT_PRIV_NULL(unsigned int *)
+
+/*
+    Profiling (-DKASSERT_PROFILE): time spent in the condition of every evaluated site
+    is added to the per-thread counters. Without KASSERT_PROFILE macros expand to nothing.
+*/
+#ifdef KASSERT_PROFILE
+
+#define KASSERT_PRIV_PROFILED                       1
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KASSERT_PRIV_PROFILE_NOW()                  __builtin_ia32_rdtsc()
+#else
+#define KASSERT_PRIV_PROFILE_NOW()                  __kassert_profile_now()
+#endif
+
+#define KASSERT_PRIV_PROFILE_START() \
+    const unsigned long long _kassert_prof_start = KASSERT_PRIV_PROFILE_NOW()
+#define KASSERT_PRIV_PROFILE_STOP(failed) \
+    __kassert_profile_record(&_kassert_site, KASSERT_PRIV_PROFILE_NOW() - _kassert_prof_start, failed)
+
+#else
+
+#define KASSERT_PRIV_PROFILED                       0
+#define KASSERT_PRIV_PROFILE_START()                do { } while (0)
+#define KASSERT_PRIV_PROFILE_STOP(failed)           do { } while (0)
+
+#endif
+
+/*
+    Actions decide what to do when site fails
+    ()     - function called with descriptor and values
+    _SOFT  - 1 when program continues after failure
+*/
+#define KASSERT_PRIV_ACTION_FATAL                   __kassert_print_and_exit
+#define KASSERT_PRIV_ACTION_FATAL_SOFT              0
+
+#define KASSERT_PRIV_ACTION_SOFT                    __kassert_soft_record
+#define KASSERT_PRIV_ACTION_SOFT_SOFT               1
+
+#define KASSERT_PRIV_COND_BODY(level, gate, rate, action, cond) \
+    do { \
+        KASSERT_PRIV_STATIC_CHECK(cond); \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_GATE_##gate##_DEFINE(rate); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 gate, \
+                                 rate, \
+                                 action, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 TOSTRING(cond), \
+                                 KASSERT_PRIV_NULL(const char *), \
+                                 KASSERT_PRIMITIVES_NON_PRIMITIVE, \
+                                 KASSERT_PRIMITIVES_NON_PRIMITIVE); \
+        if (!(KASSERT_PRIV_ENABLED() && KASSERT_PRIV_GATE_##gate())) \
+            break; \
+        KASSERT_PRIV_PROFILE_START(); \
+        const bool _kassert_failed = !(cond); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_failed); \
+        if (__builtin_expect(_kassert_failed, 0)) \
+            KASSERT_PRIV_ACTION_##action(&_kassert_site); \
+    } while (0)
+
+#define KASSERT_PRIV_CREATE_LABEL(val1, val2, op) \
+    TOSTRING(val1) " " TOSTRING(op) " " TOSTRING(val2)
+
+/* Memory is compared by one call of the vectorized kernel, like array sites */
+#define KASSERT_PRIV_MEM(level, ptr1, ptr2, len, byte, expr) \
+    do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 ALWAYS, \
+                                 1U, \
+                                 FATAL, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 expr, \
+                                 KASSERT_PRIV_NULL(const char *), \
+                                 KASSERT_PRIMITIVES_UNSIGNED_CHAR, \
+                                 KASSERT_PRIMITIVES_UNSIGNED_CHAR); \
+        if (!KASSERT_PRIV_ENABLED()) \
+            break; \
+        const void* const _kassert_ptr1 = (ptr1); \
+        const void* const _kassert_ptr2 = (ptr2); \
+        const size_t _kassert_len = (len); \
+        const unsigned char _kassert_byte = KASSERT_PRIV_CAST(unsigned char, byte); \
+        KASSERT_PRIV_PROFILE_START(); \
+        const size_t _kassert_offset = __kassert_mem_find(_kassert_ptr1, _kassert_ptr2, _kassert_len, _kassert_byte); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_offset != _kassert_len); \
+        if (__builtin_expect(_kassert_offset != _kassert_len, 0)) \
+            __kassert_mem_fail(&_kassert_site, _kassert_offset, _kassert_ptr1, _kassert_ptr2, _kassert_len, _kassert_byte); \
+    } while (0)
+
+#define KASSERT_PRIV_MEM_EQ(level, ptr1, ptr2, len) \
+    KASSERT_PRIV_MEM(level, \
+                     ptr1, \
+                     ptr2, \
+                     len, \
+                     0, \
+                     "memcmp(" TOSTRING(ptr1) ", " TOSTRING(ptr2) ", " TOSTRING(len) ") == 0")
+
+#define KASSERT_PRIV_MEM_ZERO(level, ptr, len) \
+    KASSERT_PRIV_MEM(level, \
+                     ptr, \
+                     KASSERT_PRIV_NULL(const void *), \
+                     len, \
+                     0, \
+                     TOSTRING(ptr) "[0 .. " TOSTRING(len) ") == 0")
+
+#define KASSERT_PRIV_MEM_PATTERN(level, ptr, len, byte) \
+    KASSERT_PRIV_MEM(level, \
+                     ptr, \
+                     KASSERT_PRIV_NULL(const void *), \
+                     len, \
+                     byte, \
+                     TOSTRING(ptr) "[0 .. " TOSTRING(len) ") == " TOSTRING(byte))
+
+/* Site describes the registration, checker runs in KAssert thread */
+#define KASSERT_PRIV_INVARIANT_REGISTER(level, fn, obj, hooks, budget_us) \
+    __extension__ ({ \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 ALWAYS, \
+                                 1U, \
+                                 FATAL, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 TOSTRING(fn) "(" TOSTRING(obj) ")", \
+                                 KASSERT_PRIV_NULL(const char *), \
+                                 KASSERT_PRIMITIVES_NON_PRIMITIVE, \
+                                 KASSERT_PRIMITIVES_NON_PRIMITIVE); \
+        __kassert_invariant_register(&_kassert_site, fn, obj, hooks, budget_us); \
+    })
+
+/* Both values are ns, so the report shows measured time and the budget */
+#define KASSERT_PRIV_DEADLINE_SITE_DEFINE(level, action, expr) \
+    KASSERT_PRIV_SITE_DEFINE(level, \
+                             ALWAYS, \
+                             1U, \
+                             action, \
+                             KASSERT_ARRAY_OP_NONE, \
+                             expr, \
+                             "<", \
+                             KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG, \
+                             KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG)
+
+#define KASSERT_PRIV_ELAPSED_LT(level, action, start, budget_ns) \
+    do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_DEADLINE_SITE_DEFINE(level, action, "elapsed_ns(" TOSTRING(start) ") < " TOSTRING(budget_ns)); \
+        if (!KASSERT_PRIV_ENABLED()) \
+            break; \
+        const unsigned long long _kassert_elapsed_ns = kassert_elapsed_ns(start); \
+        const unsigned long long _kassert_budget_ns = (budget_ns); \
+        if (__builtin_expect(_kassert_elapsed_ns >= _kassert_budget_ns, 0)) \
+            __kassert_deadline_fail(&_kassert_site, _kassert_elapsed_ns, _kassert_budget_ns); \
+    } while (0)
+
+/* Guard is checked by its cleanup, when the scope is left (also by return / break / goto) */
+#define KASSERT_PRIV_DEADLINE(level, action, budget_ns) \
+    const kassert_deadline_t KASSERT_PRIV_CONCAT(_kassert_deadline, __COUNTER__) \
+        __attribute__(( cleanup(__kassert_deadline_check), unused )) = \
+    __extension__ ({ \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_DEADLINE_SITE_DEFINE(level, action, "elapsed_ns(scope) < " TOSTRING(budget_ns)); \
+        __kassert_deadline_start(KASSERT_PRIV_ENABLED() ? &_kassert_site : KASSERT_PRIV_NULL(const kassert_site_t *), \
+                                 (budget_ns)); \
+    })
+
+/* Site of the region, NULL when it is disabled */
+#define KASSERT_PRIV_NO_ALLOC_SITE(level) \
+    __extension__ ({ \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 ALWAYS, \
+                                 1U, \
+                                 FATAL, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 "no allocation in region", \
+                                 KASSERT_PRIV_NULL(const char *), \
+                                 KASSERT_PRIMITIVES_NON_PRIMITIVE, \
+                                 KASSERT_PRIMITIVES_NON_PRIMITIVE); \
+        KASSERT_PRIV_ENABLED() ? &_kassert_site : KASSERT_PRIV_NULL(const kassert_site_t *); \
+    })
+
+#define KASSERT_PRIV_NO_ALLOC_BEGIN(level) \
+    ((void)__kassert_noalloc_begin(KASSERT_PRIV_NO_ALLOC_SITE(level)))
+
+#define KASSERT_PRIV_NO_ALLOC_SCOPED(level) \
+    const unsigned int KASSERT_PRIV_CONCAT(_kassert_noalloc_scope, __COUNTER__) \
+        __attribute__(( cleanup(__kassert_noalloc_restore), unused )) = __kassert_noalloc_begin(KASSERT_PRIV_NO_ALLOC_SITE(level))
+
+/*
+    Checksum is computed only by enabled site (profiled like other checks), computed and expected value go to the report.
+    Expected checksum is not converted silently: it has to be unsigned integer of the width of the checksum
+    (uint32_t for CRC32C, uint64_t for XXH64) or integer constant which fits (0xe3069283).
+    Signed variables, wider types, floats, bool and pointers are rejected in compile time.
+*/
+#define KASSERT_PRIV_CHECKSUM_TYPE_CHECK(sum_type, expected) \
+    KASSERT_DIAG_PUSH() \
+    KASSERT_DIAG_IGNORE("-Wtype-limits") \
+    KASSERT_PRIV_STATIC_ASSERT(__builtin_classify_type((__typeof__(expected))0) == __builtin_classify_type((sum_type)0) && \
+                               KASSERT_PRIV_IF_CONSTANT(expected, \
+                                                        (expected) >= 0 && (expected) <= (sum_type)-1, \
+                                                        sizeof(expected) == sizeof(sum_type) && (__typeof__(expected))-1 > 0), \
+                               "Expected checksum has to be " TOSTRING(sum_type) " or constant which fits"); \
+    KASSERT_DIAG_POP()
+
+#define KASSERT_PRIV_CHECKSUM_EQ(level, name, sum_type, sum_primitive, sum, buf, len, expected) \
+    do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 ALWAYS, \
+                                 1U, \
+                                 FATAL, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 name "(" TOSTRING(buf) ", " TOSTRING(len) ") == " TOSTRING(expected), \
+                                 "==", \
+                                 sum_primitive, \
+                                 sum_primitive); \
+        if (!KASSERT_PRIV_ENABLED()) \
+            break; \
+        KASSERT_PRIV_CHECKSUM_TYPE_CHECK(sum_type, expected); \
+        const sum_type _kassert_expected = (expected); \
+        KASSERT_PRIV_PROFILE_START(); \
+        const sum_type _kassert_sum = (sum); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_sum != _kassert_expected); \
+        if (__builtin_expect(_kassert_sum != _kassert_expected, 0)) \
+            __kassert_print_and_exit(&_kassert_site, _kassert_sum, _kassert_expected); \
+    } while (0)
+
+#define KASSERT_PRIV_CRC32C_EQ(level, buf, len, expected) \
+    KASSERT_PRIV_CHECKSUM_EQ(level, \
+                             "crc32c", \
+                             unsigned int, \
+                             KASSERT_PRIMITIVES_UNSIGNED_INT, \
+                             kassert_crc32c(buf, len), \
+                             buf, \
+                             len, \
+                             expected)
+
+#define KASSERT_PRIV_XXH64_EQ(level, buf, len, expected) \
+    KASSERT_PRIV_CHECKSUM_EQ(level, \
+                             "xxh64", \
+                             unsigned long long, \
+                             KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG, \
+                             kassert_xxh64(buf, len, 0), \
+                             buf, \
+                             len, \
+                             expected)
+
+#endif
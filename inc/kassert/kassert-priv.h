@@ -23,41 +23,53 @@
 #error "At least C11 is required to compile code with KAssert!"
 #endif
 
-#include "kassert-primitive-fmt.h"
-#include "kassert-diag.h"
+#include "kassert-priv-common.h"
 
-#include <stdbool.h>
+/* Defines _kassert_state, mutable state of the site (enabled flag) */
+#define KASSERT_PRIV_STATE_DEFINE(site_level) \
+    static kassert_site_state_t _kassert_state KASSERT_SITE_STATE_ATTR = \
+    { \
+        (site_level) <= KASSERT_LEVEL_DEFAULT \
+    }
 
-#ifndef TOSTRING
-#define KASSERT_TOSTRING(x) #x
-#define TOSTRING(x) KASSERT_TOSTRING(x)
-#endif
-
-/* Main assert function: prints all stats like format, threadID, stacktrace and calls exit(1) */
-void __attribute__ ((noreturn)) __kassert_print_and_exit(bool need_free, const char* fmt, ...);
+/* Disabled site costs only this load and branch */
+#define KASSERT_PRIV_ENABLED() \
+    __builtin_expect(__atomic_load_n(&_kassert_state.enabled, __ATOMIC_RELAXED), 1)
 
-/* Returns pointer to char[] with printf format, buffer must be freed */
-const char* __kassert_create_print_fmt(const char* label,
-                                       const char* val1_fmt,
-                                       const char* op,
-                                       const char* val2_fmt);
+/* Non constant condition is replaced by 1, so _Static_assert gets integer constant expression */
+#define KASSERT_PRIV_STATIC_ASSERT(cond, msg)   _Static_assert(cond, msg)
+#define KASSERT_PRIV_CONSTANT_OR_TRUE(cond)     __builtin_choose_expr(__builtin_constant_p(cond), !!(cond), 1)
+#define KASSERT_PRIV_IF_CONSTANT(val, then, other) __builtin_choose_expr(__builtin_constant_p(val), !!(then), !!(other))
 
-#define KASSERT_PRIV_COND_BODY(cond) \
-    do { \
-        if (!(cond)) \
-        { \
-            __kassert_print_and_exit(false, \
-                                     "%s:%d: %s: Assertion \'%s\' failed.\n", \
-                                     __FILE__, \
-                                     __LINE__, \
-                                     __func__, \
-                                     TOSTRING(cond)); \
-        } \
-    } while (0)
-
-#define KASSERT_PRIV_CREATE_LABEL(val1, val2, op) \
-    TOSTRING(val1) " " TOSTRING(op) " " TOSTRING(val2)
+/*
+    Defines _kassert_site, static descriptor of the site.
+    Has to be used in the scope of _kassert_state and objects defined by gate.
+*/
+#define KASSERT_PRIV_SITE_DEFINE(site_level, site_gate, site_rate, site_action, site_array, site_expr, site_op, site_type1, site_type2) \
+    static const kassert_site_t _kassert_site KASSERT_SITE_ATTR = \
+    { \
+        .file = __FILE__, \
+        .func = __func__, \
+        .expr = site_expr, \
+        .op_str = site_op, \
+        .state = &_kassert_state, \
+        .sample_rate = KASSERT_PRIV_GATE_##site_gate##_RATE, \
+        .line = __LINE__, \
+        .level = site_level, \
+        .enabled_default = (site_level) <= KASSERT_LEVEL_DEFAULT, \
+        .sample = KASSERT_SAMPLE_##site_gate, \
+        .sample_rate_default = (site_rate), \
+        .soft = KASSERT_PRIV_ACTION_##site_action##_SOFT, \
+        .profiled = KASSERT_PRIV_PROFILED, \
+        .registered = 0, \
+        .array_op = site_array, \
+        .val1_type = site_type1, \
+        .val2_type = site_type2 \
+    }
 
+/* Pointers are compared and passed as void*, other primitives as they are */
+#define KASSERT_PRIV_PASS_VAL(val, is_pointer) \
+    __builtin_choose_expr(is_pointer, (void *)(long)(val), (val))
 
 /*
     Macro is using strict type checking with some exceptions:
@@ -67,57 +79,202 @@ const char* __kassert_create_print_fmt(const char* label,
         2.2 Second val is a const value, then check if can be converted to bool (is equal 0 or 1)
         2.3 First value is a const value and second value is a const value, they cannot by bool, because of promotion to int
 
-    Plese note that _Static_assert need all of branches be compile expressions.
-    That's why I use val1 / val2 instead of _ktest_val. But no worries. __typeof__ / sizeof are safe
-    ++i, i++ will be ignored under those compiler "operators"
+    Site has thousands of copies in big projects, so operands are expanded a bounded number of times:
+    once for the local copy, once for the label and only for the check of bool constants (which needs val1 / val2,
+    _kassert_val is never a constant). Types are dispatched by _Generic once per operand into enum constants,
+    all checks and the descriptor use those constants.
+    __builtin_choose_expr evaluates only the chosen branch, so ++i, i++ are still evaluated only once.
 */
-#define KASSERT_PRIV_OP(val1, val2, op) \
+#define KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, op) \
     do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_GATE_##gate##_DEFINE(rate); \
+        if (!(KASSERT_PRIV_ENABLED() && KASSERT_PRIV_GATE_##gate())) \
+            break; \
         KASSERT_DIAG_PUSH() \
         KASSERT_DIAG_IGNORE("-Wfloat-equal") \
         KASSERT_DIAG_IGNORE("-Wint-to-pointer-cast") \
-        const __typeof__(val1) _kassert_val1 = (val1); \
-        const __typeof__(val2) _kassert_val2 = (val2); \
-        _Static_assert(__builtin_choose_expr(KASSERT_PRIMITIVES_PROBABLY_POINTER(_kassert_val1) && KASSERT_PRIMITIVES_PROBABLY_POINTER(_kassert_val2), \
-                                             1, \
-                                             __builtin_choose_expr(KASSERT_PRIMITIVE_GET_TYPE(_kassert_val1) == KASSERT_PRIMITIVES_BOOL || KASSERT_PRIMITIVE_GET_TYPE(_kassert_val2) == KASSERT_PRIMITIVES_BOOL, \
-                                                                   1, \
-                                                                   __builtin_types_compatible_p(__typeof__(val1), __typeof__(val2)))), \
+        KASSERT_PRIV_STATIC_CHECK((val1) op (val2)); \
+        KASSERT_PRIV_PROFILE_START(); \
+        const __auto_type _kassert_val1 = (val1); \
+        const __auto_type _kassert_val2 = (val2); \
+        enum \
+        { \
+            _kassert_type1 = KASSERT_PRIMITIVE_GET_TYPE(_kassert_val1), \
+            _kassert_type2 = KASSERT_PRIMITIVE_GET_TYPE(_kassert_val2), \
+            _kassert_pointer1 = _kassert_type1 == KASSERT_PRIMITIVES_NON_PRIMITIVE && sizeof(_kassert_val1) == sizeof(void *), \
+            _kassert_pointer2 = _kassert_type2 == KASSERT_PRIMITIVES_NON_PRIMITIVE && sizeof(_kassert_val2) == sizeof(void *), \
+            _kassert_bool = _kassert_type1 == KASSERT_PRIMITIVES_BOOL || _kassert_type2 == KASSERT_PRIMITIVES_BOOL \
+        }; \
+        _Static_assert((_kassert_pointer1 && _kassert_pointer2) || _kassert_bool || \
+                       __builtin_types_compatible_p(__typeof__(_kassert_val1), __typeof__(_kassert_val2)), \
                        "Uncompatible types"); \
-        _Static_assert(__builtin_choose_expr(KASSERT_PRIMITIVE_GET_TYPE(_kassert_val1) == KASSERT_PRIMITIVES_BOOL || KASSERT_PRIMITIVE_GET_TYPE(_kassert_val2) == KASSERT_PRIMITIVES_BOOL, \
-                                             __builtin_choose_expr(__builtin_constant_p(val1), \
-                                                                   val1 == (__typeof__(val1))false || val1 == (__typeof__(val1))true, \
-                                                                   __builtin_choose_expr(__builtin_constant_p(val2), \
-                                                                                         val2 == (__typeof__(val2))false || val2 == (__typeof__(val2))true, \
-                                                                                         1) \
-                                                                  ), \
+        _Static_assert(__builtin_choose_expr(_kassert_bool, \
+                                             KASSERT_PRIV_BOOL_CONST(val1, _kassert_val1) && KASSERT_PRIV_BOOL_CONST(val2, _kassert_val2), \
                                              1), \
-                           "Implicit convertion to bool"); \
-        if (!((__builtin_choose_expr(KASSERT_PRIMITIVES_PROBABLY_POINTER(_kassert_val1), (void *)(long)_kassert_val1, _kassert_val1)) op (__builtin_choose_expr(KASSERT_PRIMITIVES_PROBABLY_POINTER(_kassert_val2), (void *)(long)_kassert_val2, _kassert_val2)))) \
-        { \
-            const char* const fmt = \
-                __kassert_create_print_fmt(KASSERT_PRIV_CREATE_LABEL(val1, val2, op), \
-                                           KASSERT_PRIMTIVE_GET_FMT(_kassert_val1), \
-                                           TOSTRING(op), \
-                                           KASSERT_PRIMTIVE_GET_FMT(_kassert_val2)); \
-            __kassert_print_and_exit(true, \
-                                     fmt, \
-                                     __FILE__, \
-                                     __LINE__, \
-                                     __func__, \
-                                     _kassert_val1, \
-                                     _kassert_val2); \
-        } \
+                       "Implicit convertion to bool"); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 gate, \
+                                 rate, \
+                                 action, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 KASSERT_PRIV_CREATE_LABEL(val1, val2, op), \
+                                 TOSTRING(op), \
+                                 (KASSERT_PRIMITIVES)_kassert_type1, \
+                                 (KASSERT_PRIMITIVES)_kassert_type2); \
+        const bool _kassert_failed = !((KASSERT_PRIV_PASS_VAL(_kassert_val1, _kassert_pointer1)) op \
+                                       (KASSERT_PRIV_PASS_VAL(_kassert_val2, _kassert_pointer2))); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_failed); \
+        if (__builtin_expect(_kassert_failed, 0)) \
+            KASSERT_PRIV_ACTION_##action(&_kassert_site, \
+                                         KASSERT_PRIV_PASS_VAL(_kassert_val1, _kassert_pointer1), \
+                                         KASSERT_PRIV_PASS_VAL(_kassert_val2, _kassert_pointer2)); \
         KASSERT_DIAG_POP() \
     } while (0)
 
-#define KASSERT_PRIV_EQ(val1, val2)  KASSERT_PRIV_OP(val1, val2, ==)
-#define KASSERT_PRIV_NEQ(val1, val2) KASSERT_PRIV_OP(val1, val2, !=)
-#define KASSERT_PRIV_LT(val1, val2)  KASSERT_PRIV_OP(val1, val2, <)
-#define KASSERT_PRIV_LEQ(val1, val2) KASSERT_PRIV_OP(val1, val2, <=)
-#define KASSERT_PRIV_GT(val1, val2)  KASSERT_PRIV_OP(val1, val2, >)
-#define KASSERT_PRIV_GEQ(val1, val2) KASSERT_PRIV_OP(val1, val2, >=)
+/* Constant compared with bool has to be 0 or 1, for variables __builtin_constant_p is false and value is not evaluated */
+#define KASSERT_PRIV_BOOL_CONST(val, copy) \
+    __builtin_choose_expr(__builtin_constant_p(val), \
+                          (val) == (__typeof__(copy))0 || (val) == (__typeof__(copy))1, \
+                          1)
+
+#define KASSERT_PRIV_EQ(level, gate, rate, action, val1, val2)  KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, ==)
+#define KASSERT_PRIV_NEQ(level, gate, rate, action, val1, val2) KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, !=)
+#define KASSERT_PRIV_LT(level, gate, rate, action, val1, val2)  KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, <)
+#define KASSERT_PRIV_LEQ(level, gate, rate, action, val1, val2) KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, <=)
+#define KASSERT_PRIV_GT(level, gate, rate, action, val1, val2)  KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, >)
+#define KASSERT_PRIV_GEQ(level, gate, rate, action, val1, val2) KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, >=)
+
+#define KASSERT_PRIV_COND(level, gate, rate, action, cond)      KASSERT_PRIV_COND_BODY(level, gate, rate, action, cond)
+
+/* Value is converted to the widest type of its class, type tag keeps the original type */
+#define KASSERT_PRIV_CONTEXT_PUSH(tag, val) \
+    _Generic((val), \
+             _Bool: __kassert_context_push_u, \
+             char: __kassert_context_push_s, \
+             signed char: __kassert_context_push_s, \
+             unsigned char: __kassert_context_push_u, \
+             short: __kassert_context_push_s, \
+             unsigned short: __kassert_context_push_u, \
+             int: __kassert_context_push_s, \
+             unsigned int: __kassert_context_push_u, \
+             long: __kassert_context_push_s, \
+             unsigned long: __kassert_context_push_u, \
+             long long: __kassert_context_push_s, \
+             unsigned long long: __kassert_context_push_u, \
+             float: __kassert_context_push_d, \
+             double: __kassert_context_push_d, \
+             long double: __kassert_context_push_ld, \
+             default: __kassert_context_push_p \
+    )(tag, KASSERT_PRIMITIVE_GET_TYPE(val), (val))
+
+/*
+    Array sites check all elements by one call of the vectorized kernel, compiler does not see the loop.
+    Bounds are copied into compound literals with type of the element, so kernel gets them by pointer.
+    Type of the element is dispatched once, bounds and check are expanded in the scope of _kassert_array.
+*/
+#define KASSERT_PRIV_ARRAY(level, array_op, array, count, bound1, bound2, check, msg, expr, op) \
+    do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        if (!KASSERT_PRIV_ENABLED()) \
+            break; \
+        const __typeof__(*(array))* const _kassert_array = (array); \
+        enum \
+        { \
+            _kassert_elem_type = KASSERT_PRIMITIVE_GET_TYPE(*_kassert_array), \
+            _kassert_elem_primitive = _kassert_elem_type != KASSERT_PRIMITIVES_NON_PRIMITIVE, \
+            _kassert_elem_floating = _kassert_elem_type == KASSERT_PRIMITIVES_FLOAT || \
+                                     _kassert_elem_type == KASSERT_PRIMITIVES_DOUBLE || \
+                                     _kassert_elem_type == KASSERT_PRIMITIVES_LONG_DOUBLE \
+        }; \
+        _Static_assert(_kassert_elem_primitive, "Array of primitives is required"); \
+        _Static_assert(check, msg); \
+        const size_t _kassert_count = (count); \
+        const void* const _kassert_bound1 = (bound1); \
+        const void* const _kassert_bound2 = (bound2); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 ALWAYS, \
+                                 1U, \
+                                 FATAL, \
+                                 array_op, \
+                                 expr, \
+                                 op, \
+                                 (KASSERT_PRIMITIVES)_kassert_elem_type, \
+                                 (KASSERT_PRIMITIVES)_kassert_elem_type); \
+        KASSERT_PRIV_PROFILE_START(); \
+        const size_t _kassert_index = __kassert_array_find(array_op, \
+                                                           (KASSERT_PRIMITIVES)_kassert_elem_type, \
+                                                           _kassert_array, \
+                                                           _kassert_count, \
+                                                           _kassert_bound1, \
+                                                           _kassert_bound2); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_index != _kassert_count); \
+        if (__builtin_expect(_kassert_index != _kassert_count, 0)) \
+            __kassert_array_fail(&_kassert_site, _kassert_index, _kassert_array, _kassert_bound1, _kassert_bound2); \
+    } while (0)
+
+#define KASSERT_PRIV_ARRAY_BOUND(bound) \
+    (&(const __typeof__(*_kassert_array)){ (bound) })
+
+/* The same rules like in KASSERT_PRIV_OP, bool is compatible with everything, but constant has to be 0 or 1 */
+#define KASSERT_PRIV_ARRAY_COMPATIBLE(bound) \
+    (__builtin_types_compatible_p(__typeof__(*_kassert_array), __typeof__(bound)) || \
+     (((KASSERT_PRIMITIVES)_kassert_elem_type == KASSERT_PRIMITIVES_BOOL || KASSERT_PRIMITIVE_GET_TYPE(bound) == KASSERT_PRIMITIVES_BOOL) && \
+      KASSERT_PRIV_BOOL_CONST(bound, *_kassert_array)))
+
+#define KASSERT_PRIV_ALL_OP(level, array_op, array, count, bound, op) \
+    KASSERT_PRIV_ARRAY(level, \
+                       array_op, \
+                       array, \
+                       count, \
+                       KASSERT_PRIV_ARRAY_BOUND(bound), \
+                       (const void *)0, \
+                       KASSERT_PRIV_ARRAY_COMPATIBLE(bound), \
+                       "Uncompatible types", \
+                       TOSTRING(array) "[i] " TOSTRING(op) " " TOSTRING(bound), \
+                       TOSTRING(op))
+
+#define KASSERT_PRIV_ALL_EQ(level, array, count, bound)  KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_EQ, array, count, bound, ==)
+#define KASSERT_PRIV_ALL_NEQ(level, array, count, bound) KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_NEQ, array, count, bound, !=)
+#define KASSERT_PRIV_ALL_LT(level, array, count, bound)  KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_LT, array, count, bound, <)
+#define KASSERT_PRIV_ALL_LEQ(level, array, count, bound) KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_LEQ, array, count, bound, <=)
+#define KASSERT_PRIV_ALL_GT(level, array, count, bound)  KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_GT, array, count, bound, >)
+#define KASSERT_PRIV_ALL_GEQ(level, array, count, bound) KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_GEQ, array, count, bound, >=)
+
+#define KASSERT_PRIV_ALL_IN_RANGE(level, array, count, min, max) \
+    KASSERT_PRIV_ARRAY(level, \
+                       KASSERT_ARRAY_OP_IN_RANGE, \
+                       array, \
+                       count, \
+                       KASSERT_PRIV_ARRAY_BOUND(min), \
+                       KASSERT_PRIV_ARRAY_BOUND(max), \
+                       KASSERT_PRIV_ARRAY_COMPATIBLE(min) && KASSERT_PRIV_ARRAY_COMPATIBLE(max), \
+                       "Uncompatible types", \
+                       TOSTRING(min) " <= " TOSTRING(array) "[i] <= " TOSTRING(max), \
+                       "<=")
+
+#define KASSERT_PRIV_SORTED(level, array, count) \
+    KASSERT_PRIV_ARRAY(level, \
+                       KASSERT_ARRAY_OP_SORTED, \
+                       array, \
+                       count, \
+                       (const void *)0, \
+                       (const void *)0, \
+                       1, \
+                       "", \
+                       TOSTRING(array) "[i] <= " TOSTRING(array) "[i + 1]", \
+                       "<=")
 
-#define KASSERT_PRIV_COND(cond)      KASSERT_PRIV_COND_BODY(cond)
+#define KASSERT_PRIV_ALL_FINITE(level, array, count) \
+    KASSERT_PRIV_ARRAY(level, \
+                       KASSERT_ARRAY_OP_FINITE, \
+                       array, \
+                       count, \
+                       (const void *)0, \
+                       (const void *)0, \
+                       _kassert_elem_floating, \
+                       "Array of floating point numbers is required", \
+                       "isfinite(" TOSTRING(array) "[i])", \
+                       (const char *)0)
 
 #endif
@@ -0,0 +1,422 @@
+#ifndef KASSERT_PRIV_HPP
+#define KASSERT_PRIV_HPP
+
+/*
+    This is the private header for the KAssert (C++ front-end).
+    Do not include it directly, <kassert/kassert.h> includes it when compiled as C++.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+
+    C front-end needs _Generic, __builtin_types_compatible_p and __builtin_choose_expr,
+    there is no such things in C++. Here the same work is done by templates:
+    type tags and formats come from constexpr traits, type rules are static_asserts.
+    Sites are the same static descriptors (registered by the first evaluation instead of the section, see KASSERT_PRIV_STATE_DEFINE),
+    failure is a call of the C runtime, so nothing is instantiated per call site except the descriptor and the comparison.
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-priv.hpp> directly, use <kassert/kassert.h> instead."
+#endif
+
+#ifndef __GNUC__
+#error "Gnu extension is required to compile code with KAssert!"
+#endif
+
+/* C++17 has value 201703L */
+#if __cplusplus < 201703L
+#error "At least C++17 is required to compile code with KAssert!"
+#endif
+
+#include "kassert-priv-common.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<source_location>)
+#include <source_location>
+#endif
+
+namespace kassert
+{
+namespace priv
+{
+
+/* Type tag and printf format of the primitive, like KASSERT_PRIMITIVE_GET_TYPE / KASSERT_PRIMTIVE_GET_FMT */
+template <typename T>
+struct primitive
+{
+    static constexpr KASSERT_PRIMITIVES type = KASSERT_PRIMITIVES_NON_PRIMITIVE;
+    static constexpr const char* fmt = "%p";
+};
+
+#define KASSERT_PRIV_PRIMITIVE(prim_type, prim_tag, prim_fmt) \
+    template <> \
+    struct primitive<prim_type> \
+    { \
+        static constexpr KASSERT_PRIMITIVES type = prim_tag; \
+        static constexpr const char* fmt = prim_fmt; \
+    }
+
+KASSERT_PRIV_PRIMITIVE(bool, KASSERT_PRIMITIVES_BOOL, "%u");
+KASSERT_PRIV_PRIMITIVE(char, KASSERT_PRIMITIVES_CHAR, "%c");
+KASSERT_PRIV_PRIMITIVE(signed char, KASSERT_PRIMITIVES_SIGNED_CHAR, "%c");
+KASSERT_PRIV_PRIMITIVE(unsigned char, KASSERT_PRIMITIVES_UNSIGNED_CHAR, "%c");
+KASSERT_PRIV_PRIMITIVE(short, KASSERT_PRIMITIVES_SHORT, "%hd");
+KASSERT_PRIV_PRIMITIVE(unsigned short, KASSERT_PRIMITIVES_UNSIGNED_SHORT, "%hu");
+KASSERT_PRIV_PRIMITIVE(int, KASSERT_PRIMITIVES_INT, "%d");
+KASSERT_PRIV_PRIMITIVE(unsigned int, KASSERT_PRIMITIVES_UNSIGNED_INT, "%u");
+KASSERT_PRIV_PRIMITIVE(long, KASSERT_PRIMITIVES_LONG, "%ld");
+KASSERT_PRIV_PRIMITIVE(unsigned long, KASSERT_PRIMITIVES_UNSIGNED_LONG, "%lu");
+KASSERT_PRIV_PRIMITIVE(long long, KASSERT_PRIMITIVES_LONG_LONG, "%lld");
+KASSERT_PRIV_PRIMITIVE(unsigned long long, KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG, "%llu");
+KASSERT_PRIV_PRIMITIVE(float, KASSERT_PRIMITIVES_FLOAT, "%f");
+KASSERT_PRIV_PRIMITIVE(double, KASSERT_PRIMITIVES_DOUBLE, "%lf");
+KASSERT_PRIV_PRIMITIVE(long double, KASSERT_PRIMITIVES_LONG_DOUBLE, "%Lf");
+
+#undef KASSERT_PRIV_PRIMITIVE
+
+/*
+    Enabled flag of the site, the first evaluation registers the site (flag is KASSERT_SITE_STATE_UNREGISTERED).
+    Disabled and registered enabled sites cost the same load and branch like in C.
+*/
+inline bool site_enabled(unsigned char enabled, const kassert_site_t* site)
+{
+    return __builtin_expect(enabled != 0, 1) &&
+           (__builtin_expect(enabled != KASSERT_SITE_STATE_UNREGISTERED, 1) || __kassert_site_register(site));
+}
+
+/* Enum is rendered as its promoted underlying type, so it is a number even with uint8_t (in C enum is compatible with int) */
+template <typename T, bool = std::is_enum_v<T>>
+struct value_type
+{
+    using type = T;
+};
+
+template <typename T>
+struct value_type<T, true>
+{
+    using type = decltype(+std::declval<std::underlying_type_t<T>>());
+};
+
+/* Type of the operand after decay, so arrays are pointers and qualifiers are dropped like in __typeof__ + compatible_p */
+template <typename T>
+using operand_t = std::decay_t<T>;
+
+template <typename T>
+inline constexpr bool is_pointer_v = std::is_pointer_v<T> || std::is_null_pointer_v<T>;
+
+template <typename T>
+inline constexpr KASSERT_PRIMITIVES type_v = is_pointer_v<T> ? KASSERT_PRIMITIVES_NON_PRIMITIVE : primitive<typename value_type<T>::type>::type;
+
+template <typename T>
+inline constexpr const char* fmt_v = primitive<typename value_type<T>::type>::fmt;
+
+/* Runtime reads primitives and void* only */
+template <typename T>
+inline constexpr bool is_supported_v = is_pointer_v<T> || type_v<T> != KASSERT_PRIMITIVES_NON_PRIMITIVE;
+
+template <typename T>
+inline constexpr bool is_bool_v = std::is_same_v<T, bool>;
+
+/* The same rules like KASSERT_PRIV_OP from kassert-priv.h, constants with bool are checked by the macro */
+template <typename T1, typename T2>
+inline constexpr bool is_compatible_v = (is_pointer_v<T1> && is_pointer_v<T2>) ||
+                                        is_bool_v<T1> || is_bool_v<T2> ||
+                                        std::is_same_v<T1, T2>;
+
+/* Constant which can be converted to bool without loss, instantiated also for floats */
+KASSERT_DIAG_PUSH()
+KASSERT_DIAG_IGNORE("-Wfloat-equal")
+template <typename T>
+constexpr bool is_bool_value(const T& val) noexcept
+{
+    if constexpr (std::is_arithmetic_v<T>)
+        return val == static_cast<T>(0) || val == static_cast<T>(1);
+    else
+        return true;
+}
+KASSERT_DIAG_POP()
+
+/* Level can be given as int like in C */
+constexpr KASSERT_LEVEL level(int val) noexcept
+{
+    return static_cast<KASSERT_LEVEL>(val);
+}
+
+/* Value compared and passed to the runtime: pointers as void*, enums as number, primitives as they are */
+template <typename T>
+constexpr auto pass(const T& val) noexcept
+{
+    if constexpr (std::is_null_pointer_v<T>)
+        return static_cast<const void *>(nullptr);
+    else if constexpr (std::is_pointer_v<T> && std::is_function_v<std::remove_pointer_t<T>>)
+        return reinterpret_cast<const void *>(val);
+    else if constexpr (std::is_pointer_v<T>)
+        return static_cast<const void *>(val);
+    else if constexpr (std::is_enum_v<T>)
+        return static_cast<typename value_type<T>::type>(val);
+    else
+        return val;
+}
+
+/* Entry of the context ring, value is converted to the widest type of its class like by _Generic in kassert-priv.h */
+template <typename T>
+inline unsigned int context_push(const char* tag, const T& val) noexcept
+{
+    using type = operand_t<T>;
+    static_assert(is_supported_v<type>, "Primitive or pointer types are required");
+
+    const auto passed = pass(val);
+    using passed_t = std::remove_const_t<decltype(passed)>;
+
+    if constexpr (std::is_same_v<passed_t, long double>)
+        return __kassert_context_push_ld(tag, type_v<type>, passed);
+    else if constexpr (std::is_floating_point_v<passed_t>)
+        return __kassert_context_push_d(tag, type_v<type>, passed);
+    else if constexpr (std::is_pointer_v<passed_t>)
+        return __kassert_context_push_p(tag, type_v<type>, passed);
+    else if constexpr (std::is_signed_v<passed_t>)
+        return __kassert_context_push_s(tag, type_v<type>, passed);
+    else
+        return __kassert_context_push_u(tag, type_v<type>, passed);
+}
+
+} /* namespace priv */
+} /* namespace kassert */
+
+/*
+    Location of the site. std::source_location gives the full signature of the function,
+    so overloads and instances of templates are distinguished. C++17 has __PRETTY_FUNCTION__ for it.
+*/
+#if defined(__cpp_lib_source_location)
+#define KASSERT_PRIV_LOCATION_FILE  std::source_location::current().file_name()
+#define KASSERT_PRIV_LOCATION_FUNC  std::source_location::current().function_name()
+#define KASSERT_PRIV_LOCATION_LINE  static_cast<int>(std::source_location::current().line())
+#else
+#define KASSERT_PRIV_LOCATION_FILE  __FILE__
+#define KASSERT_PRIV_LOCATION_FUNC  __PRETTY_FUNCTION__
+#define KASSERT_PRIV_LOCATION_LINE  __LINE__
+#endif
+
+/*
+    C++ sites are not placed in KASSERT_SITE_SECTION / KASSERT_SITE_STATE_SECTION:
+    g++ ignores section attribute of statics in templates and refuses to put statics of inline functions (comdat)
+    and of other functions into one section (and reference to static of a function which is not emitted is an undefined symbol,
+    so sites cannot be registered by static initializers). So C++ site starts as KASSERT_SITE_STATE_UNREGISTERED,
+    its first evaluation adds it to the list of registered sites (id after C sites) and sets the startup state.
+*/
+#define KASSERT_PRIV_STATE_DEFINE(site_level) \
+    static kassert_site_registered_t _kassert_registered = \
+    { \
+        { KASSERT_SITE_STATE_UNREGISTERED }, \
+        0 \
+    }; \
+    static kassert_site_state_t& _kassert_state = _kassert_registered.state
+
+/* Has to be used in the scope of _kassert_site */
+#define KASSERT_PRIV_ENABLED() \
+    ::kassert::priv::site_enabled(__atomic_load_n(&_kassert_state.enabled, __ATOMIC_RELAXED), &_kassert_site)
+
+/* Only the taken branch is evaluated, so non constant condition is fine for static_assert */
+#define KASSERT_PRIV_STATIC_ASSERT(cond, msg)   static_assert(cond, msg)
+#define KASSERT_PRIV_CONSTANT_OR_TRUE(cond)     (__builtin_constant_p(cond) ? !!(cond) : true)
+#define KASSERT_PRIV_IF_CONSTANT(val, then, other) (__builtin_constant_p(val) ? !!(then) : !!(other))
+
+/*
+    Defines _kassert_site, static descriptor of the site.
+    Has to be used in the scope of _kassert_state and objects defined by gate.
+    Designated initializers are C++20, so fields are initialized in order of kassert_site_t.
+*/
+#define KASSERT_PRIV_SITE_DEFINE(site_level, site_gate, site_rate, site_action, site_array, site_expr, site_op, site_type1, site_type2) \
+    static const kassert_site_t _kassert_site = \
+    { \
+        KASSERT_PRIV_LOCATION_FILE, \
+        KASSERT_PRIV_LOCATION_FUNC, \
+        site_expr, \
+        site_op, \
+        &_kassert_state, \
+        KASSERT_PRIV_GATE_##site_gate##_RATE, \
+        KASSERT_PRIV_LOCATION_LINE, \
+        ::kassert::priv::level(site_level), \
+        (site_level) <= KASSERT_LEVEL_DEFAULT, \
+        KASSERT_SAMPLE_##site_gate, \
+        (site_rate), \
+        KASSERT_PRIV_ACTION_##site_action##_SOFT, \
+        KASSERT_PRIV_PROFILED, \
+        1, \
+        site_array, \
+        site_type1, \
+        site_type2 \
+    }
+
+/* Constant compared with bool has to be 0 or 1, for variables __builtin_constant_p is false and value is not evaluated */
+#define KASSERT_PRIV_BOOL_CONST(val) \
+    (!__builtin_constant_p(val) || ::kassert::priv::is_bool_value(val))
+
+/*
+    The same type checking like in C (see kassert-priv.h):
+    1. Pointers (and nullptr) are compatible with pointers
+    2. bool is compatible with everything, but constant has to be 0 or 1
+    3. Other types have to be the same (without qualifiers)
+    Operands are bound to references, so they are evaluated once and nothing is copied.
+    Types come from unevaluated operands, so the descriptor is defined before the enabled check (which registers it).
+*/
+#define KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, op) \
+    do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        KASSERT_PRIV_GATE_##gate##_DEFINE(rate); \
+        KASSERT_DIAG_PUSH() \
+        KASSERT_DIAG_IGNORE("-Wfloat-equal") \
+        using _kassert_type1 = ::kassert::priv::operand_t<decltype((val1))>; \
+        using _kassert_type2 = ::kassert::priv::operand_t<decltype((val2))>; \
+        static_assert(::kassert::priv::is_supported_v<_kassert_type1> && ::kassert::priv::is_supported_v<_kassert_type2>, \
+                      "Primitive or pointer types are required"); \
+        static_assert(::kassert::priv::is_compatible_v<_kassert_type1, _kassert_type2>, \
+                      "Uncompatible types"); \
+        static_assert(!(::kassert::priv::is_bool_v<_kassert_type1> || ::kassert::priv::is_bool_v<_kassert_type2>) || \
+                      (KASSERT_PRIV_BOOL_CONST(val1) && KASSERT_PRIV_BOOL_CONST(val2)), \
+                      "Implicit convertion to bool"); \
+        KASSERT_PRIV_STATIC_CHECK((val1) op (val2)); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 gate, \
+                                 rate, \
+                                 action, \
+                                 KASSERT_ARRAY_OP_NONE, \
+                                 KASSERT_PRIV_CREATE_LABEL(val1, val2, op), \
+                                 TOSTRING(op), \
+                                 ::kassert::priv::type_v<_kassert_type1>, \
+                                 ::kassert::priv::type_v<_kassert_type2>); \
+        if (!(KASSERT_PRIV_ENABLED() && KASSERT_PRIV_GATE_##gate())) \
+            break; \
+        KASSERT_PRIV_PROFILE_START(); \
+        const auto& _kassert_val1 = (val1); \
+        const auto& _kassert_val2 = (val2); \
+        const bool _kassert_failed = !(::kassert::priv::pass(_kassert_val1) op ::kassert::priv::pass(_kassert_val2)); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_failed); \
+        if (__builtin_expect(_kassert_failed, 0)) \
+            KASSERT_PRIV_ACTION_##action(&_kassert_site, \
+                                         ::kassert::priv::pass(_kassert_val1), \
+                                         ::kassert::priv::pass(_kassert_val2)); \
+        KASSERT_DIAG_POP() \
+    } while (0)
+
+#define KASSERT_PRIV_EQ(level, gate, rate, action, val1, val2)  KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, ==)
+#define KASSERT_PRIV_NEQ(level, gate, rate, action, val1, val2) KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, !=)
+#define KASSERT_PRIV_LT(level, gate, rate, action, val1, val2)  KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, <)
+#define KASSERT_PRIV_LEQ(level, gate, rate, action, val1, val2) KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, <=)
+#define KASSERT_PRIV_GT(level, gate, rate, action, val1, val2)  KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, >)
+#define KASSERT_PRIV_GEQ(level, gate, rate, action, val1, val2) KASSERT_PRIV_OP(level, gate, rate, action, val1, val2, >=)
+
+#define KASSERT_PRIV_COND(level, gate, rate, action, cond)      KASSERT_PRIV_COND_BODY(level, gate, rate, action, cond)
+
+#define KASSERT_PRIV_CONTEXT_PUSH(tag, val)     ::kassert::priv::context_push(tag, val)
+
+/*
+    Array sites like in C: one call of the vectorized kernel.
+    Bounds are copied into local array with type of the element (_kassert_elem_t), bounds_count of them are passed.
+*/
+#define KASSERT_PRIV_ARRAY(level, array_op, array, count, bounds_count, bound1, bound2, check, msg, expr, op) \
+    do { \
+        KASSERT_PRIV_STATE_DEFINE(level); \
+        using _kassert_elem_t = std::remove_cv_t<std::remove_pointer_t<std::decay_t<decltype((array))>>>; \
+        static_assert(std::is_arithmetic_v<_kassert_elem_t> && \
+                      ::kassert::priv::type_v<_kassert_elem_t> != KASSERT_PRIMITIVES_NON_PRIMITIVE, \
+                      "Array of primitives is required"); \
+        static_assert(check, msg); \
+        KASSERT_PRIV_SITE_DEFINE(level, \
+                                 ALWAYS, \
+                                 1U, \
+                                 FATAL, \
+                                 array_op, \
+                                 expr, \
+                                 op, \
+                                 ::kassert::priv::type_v<_kassert_elem_t>, \
+                                 ::kassert::priv::type_v<_kassert_elem_t>); \
+        if (!KASSERT_PRIV_ENABLED()) \
+            break; \
+        const _kassert_elem_t* const _kassert_array = (array); \
+        const size_t _kassert_count = (count); \
+        const _kassert_elem_t _kassert_bounds[2] = { bound1, bound2 }; \
+        const void* const _kassert_bound1 = (bounds_count) > 0 ? &_kassert_bounds[0] : nullptr; \
+        const void* const _kassert_bound2 = (bounds_count) > 1 ? &_kassert_bounds[1] : nullptr; \
+        KASSERT_PRIV_PROFILE_START(); \
+        const size_t _kassert_index = __kassert_array_find(array_op, \
+                                                           ::kassert::priv::type_v<_kassert_elem_t>, \
+                                                           _kassert_array, \
+                                                           _kassert_count, \
+                                                           _kassert_bound1, \
+                                                           _kassert_bound2); \
+        KASSERT_PRIV_PROFILE_STOP(_kassert_index != _kassert_count); \
+        if (__builtin_expect(_kassert_index != _kassert_count, 0)) \
+            __kassert_array_fail(&_kassert_site, _kassert_index, _kassert_array, _kassert_bound1, _kassert_bound2); \
+    } while (0)
+
+/* The same rules like in KASSERT_PRIV_OP, bool is compatible with everything, but constant has to be 0 or 1 */
+#define KASSERT_PRIV_ARRAY_COMPATIBLE(bound) \
+    (std::is_same_v<_kassert_elem_t, ::kassert::priv::operand_t<decltype(bound)>> || \
+     ((std::is_same_v<_kassert_elem_t, bool> || std::is_same_v<::kassert::priv::operand_t<decltype(bound)>, bool>) && \
+      KASSERT_PRIV_BOOL_CONST(bound)))
+
+#define KASSERT_PRIV_ALL_OP(level, array_op, array, count, bound, op) \
+    KASSERT_PRIV_ARRAY(level, \
+                       array_op, \
+                       array, \
+                       count, \
+                       1, \
+                       bound, \
+                       _kassert_elem_t(), \
+                       KASSERT_PRIV_ARRAY_COMPATIBLE(bound), \
+                       "Uncompatible types", \
+                       TOSTRING(array) "[i] " TOSTRING(op) " " TOSTRING(bound), \
+                       TOSTRING(op))
+
+#define KASSERT_PRIV_ALL_EQ(level, array, count, bound)  KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_EQ, array, count, bound, ==)
+#define KASSERT_PRIV_ALL_NEQ(level, array, count, bound) KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_NEQ, array, count, bound, !=)
+#define KASSERT_PRIV_ALL_LT(level, array, count, bound)  KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_LT, array, count, bound, <)
+#define KASSERT_PRIV_ALL_LEQ(level, array, count, bound) KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_LEQ, array, count, bound, <=)
+#define KASSERT_PRIV_ALL_GT(level, array, count, bound)  KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_GT, array, count, bound, >)
+#define KASSERT_PRIV_ALL_GEQ(level, array, count, bound) KASSERT_PRIV_ALL_OP(level, KASSERT_ARRAY_OP_GEQ, array, count, bound, >=)
+
+#define KASSERT_PRIV_ALL_IN_RANGE(level, array, count, min, max) \
+    KASSERT_PRIV_ARRAY(level, \
+                       KASSERT_ARRAY_OP_IN_RANGE, \
+                       array, \
+                       count, \
+                       2, \
+                       min, \
+                       max, \
+                       KASSERT_PRIV_ARRAY_COMPATIBLE(min) && KASSERT_PRIV_ARRAY_COMPATIBLE(max), \
+                       "Uncompatible types", \
+                       TOSTRING(min) " <= " TOSTRING(array) "[i] <= " TOSTRING(max), \
+                       "<=")
+
+#define KASSERT_PRIV_SORTED(level, array, count) \
+    KASSERT_PRIV_ARRAY(level, \
+                       KASSERT_ARRAY_OP_SORTED, \
+                       array, \
+                       count, \
+                       0, \
+                       _kassert_elem_t(), \
+                       _kassert_elem_t(), \
+                       true, \
+                       "", \
+                       TOSTRING(array) "[i] <= " TOSTRING(array) "[i + 1]", \
+                       "<=")
+
+#define KASSERT_PRIV_ALL_FINITE(level, array, count) \
+    KASSERT_PRIV_ARRAY(level, \
+                       KASSERT_ARRAY_OP_FINITE, \
+                       array, \
+                       count, \
+                       0, \
+                       _kassert_elem_t(), \
+                       _kassert_elem_t(), \
+                       std::is_floating_point_v<_kassert_elem_t>, \
+                       "Array of floating point numbers is required", \
+                       "isfinite(" TOSTRING(array) "[i])", \
+                       nullptr)
+
+#endif
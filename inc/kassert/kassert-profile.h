@@ -0,0 +1,44 @@
+#ifndef KASSERT_PROFILE_H
+#define KASSERT_PROFILE_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Profiler of assertion sites. Code compiled with -DKASSERT_PROFILE measures every evaluation
+    of the site (cycles on x86 by rdtsc, ns by clock_gettime elsewhere) and counts evaluations and failures.
+    Counters are per thread (no shared cache lines), they are merged only by dump.
+
+    Report is sorted by total time (share of all sites) and contains also profiled sites which never ran,
+    so you can see which checks should be demoted to a lower level.
+
+    Environment variables (read during startup, when the program has a profiled site):
+    KASSERT_PROFILE_OUT    - text report path (default stderr), written at exit
+    KASSERT_PROFILE_CSV    - CSV report path, written at exit
+    KASSERT_PROFILE_JSON   - JSON report path, written at exit
+    KASSERT_PROFILE_SIGNAL - signal number which dumps reports (i.e. 12 for SIGUSR2)
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-profile.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+typedef enum KASSERT_PROFILE_FORMAT
+{
+    KASSERT_PROFILE_FORMAT_TEXT,
+    KASSERT_PROFILE_FORMAT_CSV,
+    KASSERT_PROFILE_FORMAT_JSON
+} KASSERT_PROFILE_FORMAT;
+
+/* Writes report of all profiled sites to fd. Async-signal-safe, no heap and stdio */
+void kassert_profile_dump(int fd, KASSERT_PROFILE_FORMAT format);
+
+/* Clears counters of all threads */
+void kassert_profile_reset(void);
+
+#endif
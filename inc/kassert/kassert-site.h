@@ -0,0 +1,130 @@
+#ifndef KASSERT_SITE_H
+#define KASSERT_SITE_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-site.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stddef.h>
+
+#include "kassert-primitive-fmt.h"
+
+/*
+    Levels of assertions. Site is enabled when its level <= current level.
+    Level can be changed in runtime (see kassert-control.h)
+*/
+typedef enum KASSERT_LEVEL
+{
+    KASSERT_LEVEL_CHEAP,
+    KASSERT_LEVEL_NORMAL,
+    KASSERT_LEVEL_EXPENSIVE,
+    KASSERT_LEVEL_PARANOID
+} KASSERT_LEVEL;
+
+/* Level used to initialize sites, before any runtime change. You can change it by -D option */
+#ifndef KASSERT_LEVEL_DEFAULT
+#define KASSERT_LEVEL_DEFAULT KASSERT_LEVEL_NORMAL
+#endif
+
+/* How often enabled site is evaluated */
+typedef enum KASSERT_SAMPLE
+{
+    KASSERT_SAMPLE_ALWAYS,
+    KASSERT_SAMPLE_RATE,           /* ~1 / rate executions (per thread) */
+    KASSERT_SAMPLE_ONCE,           /* first execution of the site */
+    KASSERT_SAMPLE_ONCE_PER_THREAD /* first execution of the site in each thread */
+} KASSERT_SAMPLE;
+
+/* Check done by KASSERT_ALL_* / KASSERT_SORTED / KASSERT_ALL_FINITE site on every element */
+typedef enum KASSERT_ARRAY_OP
+{
+    KASSERT_ARRAY_OP_NONE,      /* not an array site */
+    KASSERT_ARRAY_OP_EQ,
+    KASSERT_ARRAY_OP_NEQ,
+    KASSERT_ARRAY_OP_LT,
+    KASSERT_ARRAY_OP_LEQ,
+    KASSERT_ARRAY_OP_GT,
+    KASSERT_ARRAY_OP_GEQ,
+    KASSERT_ARRAY_OP_IN_RANGE,  /* min <= a[i] <= max */
+    KASSERT_ARRAY_OP_SORTED,    /* a[i] <= a[i + 1] */
+    KASSERT_ARRAY_OP_FINITE     /* a[i] is not inf / nan */
+} KASSERT_ARRAY_OP;
+
+/*
+    Mutable state of the assertion site. States of C sites are packed in KASSERT_SITE_STATE_SECTION,
+    so checking if site is enabled is a single load from hot, cache-resident memory.
+*/
+typedef struct kassert_site_state
+{
+    unsigned char enabled;
+} kassert_site_state_t;
+
+/* Initial enabled flag of the site out of KASSERT_SITE_SECTION, nonzero so the first check takes the slow path */
+#define KASSERT_SITE_STATE_UNREGISTERED 2
+
+/*
+    State of the site which is out of KASSERT_SITE_SECTION (C++ sites, see kassert-priv.hpp).
+    Such site is registered by its first evaluation (__kassert_site_register)
+    and gets id after sites of the section, in order of registration.
+*/
+typedef struct kassert_site_registered
+{
+    kassert_site_state_t state;   /* site->state points here */
+    size_t               index;   /* position in the list of registered sites */
+} kassert_site_registered_t;
+
+/*
+    Static descriptor of the assertion site. Each C site emits exactly one descriptor into
+    the KASSERT_SITE_SECTION section (C++ site registers its descriptor), so everything we know at compile time (location,
+    stringified expression, operator, types of operands) lives in rodata instead of
+    being passed by the inlined code. Values are rendered by the library using type tags.
+*/
+typedef struct kassert_site
+{
+    const char*           file;
+    const char*           func;
+    const char*           expr;     /* stringified condition / relation */
+    const char*           op_str;   /* NULL for KASSERT(cond) */
+    kassert_site_state_t* state;
+    unsigned int*         sample_rate;     /* runtime rate for KASSERT_SAMPLE_RATE, NULL otherwise */
+    int                   line;
+    KASSERT_LEVEL         level;
+    unsigned char         enabled_default; /* initial value of state->enabled */
+    KASSERT_SAMPLE        sample;
+    unsigned int          sample_rate_default;
+    unsigned char         soft;            /* KASSERT_SOFT_*, failure is recorded and program continues */
+    unsigned char         profiled;        /* site compiled with KASSERT_PROFILE */
+    unsigned char         registered;      /* site is out of the section, state is kassert_site_registered_t */
+    KASSERT_ARRAY_OP      array_op;        /* val1_type is type of the array element */
+    KASSERT_PRIMITIVES    val1_type;
+    KASSERT_PRIMITIVES    val2_type;
+} kassert_site_t;
+
+/*
+    Names of the sections must be valid C identifiers, then linker provides
+    __start_kassert_sites and __stop_kassert_sites symbols for free.
+*/
+#define KASSERT_SITE_SECTION       "kassert_sites"
+#define KASSERT_SITE_STATE_SECTION "kassert_state"
+
+/*
+    aligned is needed to keep descriptors packed like an array (compiler can overalign big objects),
+    used is needed to keep descriptor even if compiler proved that assertion never fails
+*/
+#define KASSERT_SITE_ATTR \
+    __attribute__(( section(KASSERT_SITE_SECTION), aligned(__alignof__(kassert_site_t)), used ))
+
+#define KASSERT_SITE_STATE_ATTR \
+    __attribute__(( section(KASSERT_SITE_STATE_SECTION), aligned(__alignof__(kassert_site_state_t)), used ))
+
+#endif
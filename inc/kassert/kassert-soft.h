@@ -0,0 +1,57 @@
+#ifndef KASSERT_SOFT_H
+#define KASSERT_SOFT_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Non-fatal ("soft") assertions. Failure of KASSERT_SOFT_* site is recorded and program continues.
+    Record (site, raw values, tid, timestamp and optionally raw stack addresses) goes into
+    lock-free ring buffer of the thread, there is no formatting in the hot path.
+    When ring is full new records are dropped (and counted).
+    Ring is taken without allocation (mmap, lock-free list, no TSD), rings of dead threads are reused.
+    Soft failure in signal handler which interrupted the record of the same thread is dropped (and counted).
+
+    Records are formatted and written to stderr by kassert_drain() or by drainer thread.
+    Drain deduplicates records (the same site and values as previous one) and limits
+    number of records printed per site in the time window, the rest is summarized.
+
+    Environment variables (read during startup):
+    KASSERT_SOFT_DRAIN_MS  - start drainer thread with given interval
+    KASSERT_SOFT_STACK     - number of stack frames captured with every record (default 0)
+    KASSERT_SOFT_BURST     - number of records printed per site in the window (default 5)
+    KASSERT_SOFT_WINDOW_MS - rate limiting window (default 1000)
+
+    Pending records are drained at exit.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-soft.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+
+/* Maximal number of stack frames captured with the soft failure record */
+#define KASSERT_SOFT_STACK_MAX 16
+
+/* Formats and writes all pending records. Can be called from any thread */
+void kassert_drain(void);
+
+/* Starts thread which calls kassert_drain every interval_ms. Returns false on error or when already started */
+bool kassert_soft_start_drainer(unsigned int interval_ms);
+
+/* Number of stack frames captured with every record (0 disables, max KASSERT_SOFT_STACK_MAX) */
+void kassert_soft_set_stack_depth(unsigned int depth);
+
+/* Prints at most burst records per site in window_ms window, the rest is summarized */
+void kassert_soft_set_rate_limit(unsigned int burst, unsigned int window_ms);
+
+/* Number of soft failures recorded so far (including dropped ones) */
+unsigned long long kassert_soft_failures(void);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef KASSERT_STACK_H
+#define KASSERT_STACK_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Stack capture used by failure report, crash records, soft records and all-threads mode.
+
+    BACKTRACE     - glibc backtrace, DWARF CFI unwinding by libgcc_s (default).
+                    Works without frame pointers, it is pre-warmed during startup,
+                    so dlopen of libgcc_s is not done by the first failure.
+    FRAME_POINTER - walker of frame records (saved frame pointer, return address), x86_64 and aarch64 only.
+                    Use it when the code is compiled with -fno-omit-frame-pointer (libkassert.a is).
+                    Every frame is validated against bounds of the stack of the thread (mapping from /proc/self/maps
+                    cached in thread-local variable), records have to be aligned and strictly increasing,
+                    so broken chain stops the walk instead of reading wild memory.
+                    Return address has to point into r-x mapping (table read with the stack bounds,
+                    re-read at most every 100ms for dlopen), so stale frame pointer left by code
+                    without frame pointers ends the walk instead of producing made-up frames.
+                    Walk started on alternate signal stack ends at the signal frame.
+
+    Environment variables (read during startup):
+    KASSERT_UNWINDER - backtrace or fp
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-stack.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum KASSERT_UNWINDER
+{
+    KASSERT_UNWINDER_BACKTRACE,
+    KASSERT_UNWINDER_FRAME_POINTER,
+    KASSERT_UNWINDER_COUNT
+} KASSERT_UNWINDER;
+
+/* Returns false for unknown unwinder or FRAME_POINTER on unsupported architecture */
+bool kassert_unwinder_set(KASSERT_UNWINDER unwinder);
+
+KASSERT_UNWINDER kassert_unwinder_get(void);
+
+/*
+    Stores return addresses of the calling thread, the first one is in the caller. Returns number of frames.
+    Async-signal-safe (after the startup).
+*/
+size_t kassert_backtrace(void** frames, size_t max);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef KASSERT_THREADS_H
+#define KASSERT_THREADS_H
+
+/*
+    This is a private header for kassert.
+    Do not include it directly
+
+    Failure coordination. The first failing thread wins atomic election and reports,
+    other threads which fail at the same time block quietly until the process exits,
+    so reports of concurrent failures never interleave.
+
+    All-threads mode. Winner sends signal (tgkill) to every thread from /proc/self/task,
+    signal handler stores return addresses of the thread into preallocated slot.
+    Winner waits for slots with timeout and prints stacks of all threads after its own,
+    so lock contention and deadlock-like bugs can be seen without attaching debugger.
+    Threads which block the signal (i.e. threads of KAssert) or do not answer in time are reported without stack.
+    Please note that the signal interrupts blocking calls which are not restarted (pause, nanosleep, ...)
+    with EINTR, so other threads can run a bit before the process exits.
+
+    Environment variables (read during startup):
+    KASSERT_ALL_THREADS            - 1 enables all-threads mode
+    KASSERT_ALL_THREADS_SIGNAL     - signal number used to capture stacks (default SIGRTMIN + 4)
+    KASSERT_ALL_THREADS_TIMEOUT_MS - how long winner waits for stacks (default 100)
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL3
+*/
+
+#ifndef KASSERT_H
+#error "Never include <kassert/kassert-threads.h> directly, use <kassert/kassert.h> instead."
+#endif
+
+#include <stdbool.h>
+
+/*
+    Enables or disables all-threads mode. Handler is installed for signo (0 means default signal).
+    Returns false when handler cannot be installed.
+*/
+bool kassert_all_threads_enable(bool enable, int signo);
+
+#endif
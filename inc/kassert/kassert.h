@@ -31,14 +31,23 @@
     Both libraries evaluate only condition and do nothing more.
     When condition fails we are going to close program, so performance is no critical here.
 
-    Please note that KAssert uses exit(1) instead of abort. So this library lets program to clean itself
-    before closing.
+    With NDEBUG and KASSERT_ASSUME_IN_RELEASE assertions become hints for the optimizer (see KASSERT_ASSUME),
+    so facts checked in debug builds (non-null pointers, bounded indices) are used in release builds.
+    With KASSERT_STATIC_CHECK assertions which are constant in compile time (sizeof, enums) are _Static_assert.
 
-    Remember. To get full info from StackTrace linker need to add some special debug symbols.
-    To see not only address of functions but names also you need to add to compiler -rdynamic (gcc)
+    Please note that KAssert uses exit(1) instead of abort by default. So this library lets program to clean itself
+    before closing. Failure policy (see kassert-policy.h) can choose _exit, abort, own handler or fork-then-abort instead.
+
+    Stacktrace is symbolized in process from .symtab and DWARF .debug_line, -rdynamic is not needed.
+    Compile with -g to see file:line of the frames, stripped binaries show only addresses.
+    Set KASSERT_SYMBOLIZE=0 to get raw frames (module+address, for addr2line -e module).
 */
 
+#ifdef __cplusplus
+#include "kassert-priv.hpp"
+#else
 #include "kassert-priv.h"
+#endif
 
 /**
  * Like normal assert from assert.h. When NDEBUG is defined then assertions are empty
@@ -62,25 +71,25 @@
  * If condition (relation) is evaluated to false then library will produce
  * and error message on stderr and will terminate program using exit(1) command.
  *
- * The example of output can be like this (with -rdynamic):
+ * The example of output can be like this (with -g):
  * main.c:9: h: Assertion 'n == 10' failed. (100 == 10)
  * ThreadID: 739210
  * Stacktrace:
- * ./main(+0x13c0) [0x55f99f4573c0]
- * ./main(__kassert_print_and_exit+0xe0) [0x55f99f457540]
- * ./main(h+0x91) [0x55f99f45731a]
- * ./main(g+0x19) [0x55f99f45734a]
- * ./main(f+0x19) [0x55f99f457366]
- * ./main(main+0x12) [0x55f99f45737b]
- * /lib/x86_64-linux-gnu/libc.so.6(__libc_start_main+0xf3) [0x7f9ca0f7d0b3]
- * ./main(_start+0x2e) [0x55f99f4571ce
- */
-#define KASSERT_EQ(val1, val2)    KASSERT_PRIV_EQ(val1, val2)
-#define KASSERT_NEQ(val1, val2)   KASSERT_PRIV_NEQ(val1, val2)
-#define KASSERT_GT(val1, val2)    KASSERT_PRIV_GT(val1, val2)
-#define KASSERT_GEQ(val1, val2)   KASSERT_PRIV_GEQ(val1, val2)
-#define KASSERT_LT(val1, val2)    KASSERT_PRIV_LT(val1, val2)
-#define KASSERT_LEQ(val1, val2)   KASSERT_PRIV_LEQ(val1, val2)
+ * #0 0x55f99f4573c0 in __kassert_print_backtrace+0x20 (/home/user/main)
+ * #1 0x55f99f457540 in __kassert_print_and_exit+0xe0 (/home/user/main)
+ * #2 0x55f99f45731a in h+0x91 at /home/user/main.c:9 (/home/user/main)
+ * #3 0x55f99f45734a in g+0x19 at /home/user/main.c:14 (/home/user/main)
+ * #4 0x55f99f457366 in f+0x19 at /home/user/main.c:19 (/home/user/main)
+ * #5 0x55f99f45737b in main+0x12 at /home/user/main.c:24 (/home/user/main)
+ * #6 0x7f9ca0f7d0b3 in __libc_start_main+0xf3 (/usr/lib/x86_64-linux-gnu/libc.so.6)
+ * #7 0x55f99f4571ce in _start+0x2e (/home/user/main)
+ */
+#define KASSERT_EQ(val1, val2)    KASSERT_EQ_L(KASSERT_LEVEL_NORMAL, val1, val2)
+#define KASSERT_NEQ(val1, val2)   KASSERT_NEQ_L(KASSERT_LEVEL_NORMAL, val1, val2)
+#define KASSERT_GT(val1, val2)    KASSERT_GT_L(KASSERT_LEVEL_NORMAL, val1, val2)
+#define KASSERT_GEQ(val1, val2)   KASSERT_GEQ_L(KASSERT_LEVEL_NORMAL, val1, val2)
+#define KASSERT_LT(val1, val2)    KASSERT_LT_L(KASSERT_LEVEL_NORMAL, val1, val2)
+#define KASSERT_LEQ(val1, val2)   KASSERT_LEQ_L(KASSERT_LEVEL_NORMAL, val1, val2)
 
 /**
  * This works in the same way as normal assert from assert.h
@@ -89,30 +98,289 @@
  * If condition (relation) is evaluated to false then library will produce
  * and error message on stderr and will terminate program using exit(1) command.
  *
- * The example of output can be like this (with -rdynamic):
+ * The example of output can be like this (with -g):
  * main.c:9: h: Assertion 'n == 10' failed.
  * ThreadID: 739272
  * Stacktrace:
- * ./main(+0x13f0) [0x5643089a63f0]
- * ./main(__kassert_print_and_exit+0xe0) [0x5643089a6570]
- * ./main(h+0x54) [0x5643089a62dd]
- * ./main(g+0x19) [0x5643089a6380]
- * ./main(f+0x19) [0x5643089a639c]
- * ./main(main+0x12) [0x5643089a63b1]
- * /lib/x86_64-linux-gnu/libc.so.6(__libc_start_main+0xf3) [0x7f16d28890b3]
- * ./main(_start+0x2e) [0x5643089a61ce]
+ * #0 0x5643089a63f0 in __kassert_print_backtrace+0x20 (/home/user/main)
+ * #1 0x5643089a6570 in __kassert_print_and_exit+0xe0 (/home/user/main)
+ * #2 0x5643089a62dd in h+0x54 at /home/user/main.c:9 (/home/user/main)
+ * #3 0x5643089a6380 in g+0x19 at /home/user/main.c:14 (/home/user/main)
+ * #4 0x5643089a639c in f+0x19 at /home/user/main.c:19 (/home/user/main)
+ * #5 0x5643089a63b1 in main+0x12 at /home/user/main.c:24 (/home/user/main)
+ * #6 0x7f16d28890b3 in __libc_start_main+0xf3 (/usr/lib/x86_64-linux-gnu/libc.so.6)
+ * #7 0x5643089a61ce in _start+0x2e (/home/user/main)
  */
-#define KASSERT(cond)             KASSERT_PRIV_COND(cond)
+#define KASSERT(cond)             KASSERT_L(KASSERT_LEVEL_NORMAL, cond)
+
+/**
+ * Leveled versions of the macros above. Level is one of KASSERT_LEVEL:
+ * CHEAP, NORMAL, EXPENSIVE, PARANOID. Macros without _L suffix use NORMAL level.
+ *
+ * Every site can be enabled / disabled in runtime (by level, file glob or site id),
+ * see kassert-control.h for details. Disabled site costs a single load and branch,
+ * so you can keep expensive invariants compiled in and enable them when needed.
+ *
+ * By default sites with level <= KASSERT_LEVEL_DEFAULT (NORMAL) are enabled.
+ *
+ * Example:
+ * KASSERT_L(KASSERT_LEVEL_PARANOID, tree_is_balanced(tree));
+ * KASSERT_LT_L(KASSERT_LEVEL_EXPENSIVE, checksum(buf, len), limit);
+ */
+#define KASSERT_EQ_L(level, val1, val2)    KASSERT_PRIV_EQ(level, ALWAYS, 1U, FATAL, val1, val2)
+#define KASSERT_NEQ_L(level, val1, val2)   KASSERT_PRIV_NEQ(level, ALWAYS, 1U, FATAL, val1, val2)
+#define KASSERT_GT_L(level, val1, val2)    KASSERT_PRIV_GT(level, ALWAYS, 1U, FATAL, val1, val2)
+#define KASSERT_GEQ_L(level, val1, val2)   KASSERT_PRIV_GEQ(level, ALWAYS, 1U, FATAL, val1, val2)
+#define KASSERT_LT_L(level, val1, val2)    KASSERT_PRIV_LT(level, ALWAYS, 1U, FATAL, val1, val2)
+#define KASSERT_LEQ_L(level, val1, val2)   KASSERT_PRIV_LEQ(level, ALWAYS, 1U, FATAL, val1, val2)
+
+#define KASSERT_L(level, cond)             KASSERT_PRIV_COND(level, ALWAYS, 1U, FATAL, cond)
+
+/**
+ * Sampled versions of the macros, for checks which are too expensive to run on every call.
+ * Condition is evaluated on ~1/rate executions (rate has to be a compile time constant).
+ * Sampling uses thread-local countdown, so there are no atomics and no shared cache lines.
+ * Rate can be changed per site in runtime (kassert_site_set_rate, rate=<N>:site=<id> rule).
+ *
+ * Example:
+ * KASSERT_SAMPLED(1000, tree_is_balanced(tree));
+ * KASSERT_EQ_SAMPLED(100, crc32(buf, len), hdr->crc);
+ */
+#define KASSERT_EQ_SAMPLED(rate, val1, val2)    KASSERT_PRIV_EQ(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, val1, val2)
+#define KASSERT_NEQ_SAMPLED(rate, val1, val2)   KASSERT_PRIV_NEQ(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, val1, val2)
+#define KASSERT_GT_SAMPLED(rate, val1, val2)    KASSERT_PRIV_GT(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, val1, val2)
+#define KASSERT_GEQ_SAMPLED(rate, val1, val2)   KASSERT_PRIV_GEQ(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, val1, val2)
+#define KASSERT_LT_SAMPLED(rate, val1, val2)    KASSERT_PRIV_LT(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, val1, val2)
+#define KASSERT_LEQ_SAMPLED(rate, val1, val2)   KASSERT_PRIV_LEQ(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, val1, val2)
+
+#define KASSERT_SAMPLED(rate, cond)             KASSERT_PRIV_COND(KASSERT_LEVEL_NORMAL, RATE, rate, FATAL, cond)
+
+/**
+ * Condition is evaluated only during the first execution of the site (in whole program).
+ */
+#define KASSERT_EQ_ONCE(val1, val2)    KASSERT_PRIV_EQ(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, val1, val2)
+#define KASSERT_NEQ_ONCE(val1, val2)   KASSERT_PRIV_NEQ(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, val1, val2)
+#define KASSERT_GT_ONCE(val1, val2)    KASSERT_PRIV_GT(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, val1, val2)
+#define KASSERT_GEQ_ONCE(val1, val2)   KASSERT_PRIV_GEQ(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, val1, val2)
+#define KASSERT_LT_ONCE(val1, val2)    KASSERT_PRIV_LT(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, val1, val2)
+#define KASSERT_LEQ_ONCE(val1, val2)   KASSERT_PRIV_LEQ(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, val1, val2)
+
+#define KASSERT_ONCE(cond)             KASSERT_PRIV_COND(KASSERT_LEVEL_NORMAL, ONCE, 0U, FATAL, cond)
+
+/**
+ * Condition is evaluated only during the first execution of the site in each thread.
+ */
+#define KASSERT_EQ_ONCE_PER_THREAD(val1, val2)    KASSERT_PRIV_EQ(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, val1, val2)
+#define KASSERT_NEQ_ONCE_PER_THREAD(val1, val2)   KASSERT_PRIV_NEQ(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, val1, val2)
+#define KASSERT_GT_ONCE_PER_THREAD(val1, val2)    KASSERT_PRIV_GT(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, val1, val2)
+#define KASSERT_GEQ_ONCE_PER_THREAD(val1, val2)   KASSERT_PRIV_GEQ(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, val1, val2)
+#define KASSERT_LT_ONCE_PER_THREAD(val1, val2)    KASSERT_PRIV_LT(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, val1, val2)
+#define KASSERT_LEQ_ONCE_PER_THREAD(val1, val2)   KASSERT_PRIV_LEQ(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, val1, val2)
+
+#define KASSERT_ONCE_PER_THREAD(cond)             KASSERT_PRIV_COND(KASSERT_LEVEL_NORMAL, ONCE_PER_THREAD, 0U, FATAL, cond)
+
+/**
+ * Non-fatal versions of the macros. Failure is recorded and program continues.
+ * Records are kept in lock-free per-thread rings without formatting, so site which fails
+ * million times per second does not saturate stderr and does not contend on a lock.
+ * Records are printed (with deduplication and rate limiting) by kassert_drain()
+ * or by drainer thread (see kassert-soft.h).
+ *
+ * The example of output can be like this:
+ * main.c:9: h: Soft assertion 'n == 10' failed. (100 == 10) ThreadID: 739210 Time: 1697612403.123456789
+ * main.c:9: h: Soft assertion 'n == 10' repeated 1000 times
+ * main.c:9: h: Soft assertion 'n == 10' suppressed 51234 records (total 51240)
+ */
+#define KASSERT_SOFT_EQ(val1, val2)    KASSERT_PRIV_EQ(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, val1, val2)
+#define KASSERT_SOFT_NEQ(val1, val2)   KASSERT_PRIV_NEQ(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, val1, val2)
+#define KASSERT_SOFT_GT(val1, val2)    KASSERT_PRIV_GT(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, val1, val2)
+#define KASSERT_SOFT_GEQ(val1, val2)   KASSERT_PRIV_GEQ(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, val1, val2)
+#define KASSERT_SOFT_LT(val1, val2)    KASSERT_PRIV_LT(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, val1, val2)
+#define KASSERT_SOFT_LEQ(val1, val2)   KASSERT_PRIV_LEQ(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, val1, val2)
+
+#define KASSERT_SOFT(cond)             KASSERT_PRIV_COND(KASSERT_LEVEL_NORMAL, ALWAYS, 1U, SOFT, cond)
+
+/**
+ * Use this macros to check all elements of the array of primitives:
+ * ALL_EQ .. ALL_GEQ -> array[i] op bound for every i < count
+ * ALL_IN_RANGE      -> min <= array[i] <= max
+ * SORTED            -> array[i] <= array[i + 1] (non-decreasing)
+ * ALL_FINITE        -> array[i] is not inf / nan (float, double, long double)
+ *
+ * Bounds must have the same type as the element (the same rules like KASSERT_EQ).
+ * Whole array is checked by one call of the kernel selected for the element type on the first use
+ * (SSE2 / AVX2 / AVX-512 on x86, KASSERT_ARRAY_ISA=scalar|sse2|avx2|avx512 limits the choice),
+ * so it is one streaming pass instead of count branches in your code
+ * and loops around the assertion can be still vectorized.
+ * Comparisons follow C rules, so NaN fails every check except ALL_NEQ.
+ *
+ * The example of output can be like this:
+ * main.c:9: h: Assertion 'len[i] < max' failed. (index 17: 300 < 256)
+ * main.c:9: h: Assertion 'keys[i] <= keys[i + 1]' failed. (index 4: 7 <= 3)
+ */
+#define KASSERT_ALL_EQ(array, count, bound)        KASSERT_PRIV_ALL_EQ(KASSERT_LEVEL_NORMAL, array, count, bound)
+#define KASSERT_ALL_NEQ(array, count, bound)       KASSERT_PRIV_ALL_NEQ(KASSERT_LEVEL_NORMAL, array, count, bound)
+#define KASSERT_ALL_GT(array, count, bound)        KASSERT_PRIV_ALL_GT(KASSERT_LEVEL_NORMAL, array, count, bound)
+#define KASSERT_ALL_GEQ(array, count, bound)       KASSERT_PRIV_ALL_GEQ(KASSERT_LEVEL_NORMAL, array, count, bound)
+#define KASSERT_ALL_LT(array, count, bound)        KASSERT_PRIV_ALL_LT(KASSERT_LEVEL_NORMAL, array, count, bound)
+#define KASSERT_ALL_LEQ(array, count, bound)       KASSERT_PRIV_ALL_LEQ(KASSERT_LEVEL_NORMAL, array, count, bound)
+
+#define KASSERT_ALL_IN_RANGE(array, count, min, max) KASSERT_PRIV_ALL_IN_RANGE(KASSERT_LEVEL_NORMAL, array, count, min, max)
+#define KASSERT_SORTED(array, count)                 KASSERT_PRIV_SORTED(KASSERT_LEVEL_NORMAL, array, count)
+#define KASSERT_ALL_FINITE(array, count)             KASSERT_PRIV_ALL_FINITE(KASSERT_LEVEL_NORMAL, array, count)
+
+/**
+ * Use this macros to check memory regions:
+ * MEM_EQ      -> len bytes of ptr1 and ptr2 are equal (like memcmp(ptr1, ptr2, len) == 0)
+ * MEM_ZERO    -> len bytes of ptr are 0
+ * MEM_PATTERN -> len bytes of ptr are equal to byte (i.e. poison of freed blocks)
+ *
+ * Memory is read once by the vectorized kernel, failure prints the first differing offset
+ * and hexdump of both buffers around it (differing bytes are marked by >).
+ *
+ * The example of output can be like this:
+ * main.c:9: h: Assertion 'memcmp(frame, ref, 20) == 0' failed. (offset 18: 0x7f != 0x00)
+ *     offset   actual                                            expected
+ *     00000000 45 00 00 14 00 00 40 00 40 11 00 00 0a 00 00 01   45 00 00 14 00 00 40 00 40 11 00 00 0a 00 00 01
+ *     00000010 0a 00>7f 02                                       0a 00>00 02
+ */
+#define KASSERT_MEM_EQ(ptr1, ptr2, len)        KASSERT_PRIV_MEM_EQ(KASSERT_LEVEL_NORMAL, ptr1, ptr2, len)
+#define KASSERT_MEM_ZERO(ptr, len)             KASSERT_PRIV_MEM_ZERO(KASSERT_LEVEL_NORMAL, ptr, len)
+#define KASSERT_MEM_PATTERN(ptr, len, byte)    KASSERT_PRIV_MEM_PATTERN(KASSERT_LEVEL_NORMAL, ptr, len, byte)
+
+/**
+ * Use this macro to register checker of the invariant of the whole object (see kassert-invariant.h).
+ * Checker runs in KAssert thread, so threads which use the object do not pay for the check.
+ * hooks can be NULL, budget_us is time of one call of the checker (0 means whole pass in one call).
+ * Returns handle for kassert_invariant_unregister (NULL on error).
+ *
+ * The example of output can be like this:
+ * main.c:30: main: Assertion 'freelist_check(&pool)' failed.
+ */
+#define KASSERT_INVARIANT_REGISTER(fn, obj, hooks, budget_us) \
+    KASSERT_PRIV_INVARIANT_REGISTER(KASSERT_LEVEL_NORMAL, fn, obj, hooks, budget_us)
 
 /**
  * Use this macro to check if pointer is not null
  */
-#define KASSERT_PTR_NOT_NULL(ptr) KASSERT_NEQ(ptr, (void *)0)
+#define KASSERT_PTR_NOT_NULL(ptr) KASSERT_NEQ(ptr, KASSERT_PRIV_NULL(void *))
 
 /**
  * Use this macro to check if pointer is null
  */
-#define KASSERT_PTR_NULL(ptr)     KASSERT_EQ(ptr, (void *)0)
+#define KASSERT_PTR_NULL(ptr)     KASSERT_EQ(ptr, KASSERT_PRIV_NULL(void *))
+
+/**
+ * Use these macros to check that data structure is touched only by its owning thread (see kassert-owner.h).
+ * owner is pid_t, i.e. set by kassert_gettid() when the structure is created.
+ * ThreadID is cached in thread-local variable, so check is one load and compare, there is no syscall.
+ *
+ * The example of output can be like this:
+ * main.c:12: queue_push: Assertion 'kassert_gettid() == q->owner' failed. (7032 == 7031)
+ */
+#define KASSERT_ON_THREAD(owner)       KASSERT_EQ(kassert_gettid(), owner)
+#define KASSERT_NOT_ON_THREAD(owner)   KASSERT_NEQ(kassert_gettid(), owner)
+
+/**
+ * Use these macros to check that the calling thread holds (or does not hold) the mutex.
+ * m is kassert_mutex_t*, wrapper of pthread_mutex_t which tracks ThreadID of the owner (see kassert-owner.h).
+ *
+ * The example of output can be like this:
+ * main.c:20: cache_evict: Assertion 'kassert_mutex_owner(&c->lock) == kassert_gettid()' failed. (0 == 7031)
+ */
+#define KASSERT_MUTEX_HELD(m)          KASSERT_EQ(kassert_mutex_owner(m), kassert_gettid())
+#define KASSERT_MUTEX_NOT_HELD(m)      KASSERT_NEQ(kassert_mutex_owner(m), kassert_gettid())
+
+/**
+ * Context breadcrumbs printed by fatal failure of the thread (see kassert-context.h).
+ * PUSH stores tag (string literal) and value (primitive or pointer) into thread-local ring,
+ * it costs a few stores, there is no formatting. POP removes the newest entry.
+ * SCOPED pushes and pops at the end of the scope (also when scope is left by return / break).
+ *
+ * Example:
+ * KASSERT_CONTEXT_SCOPED("request", req->id);
+ * KASSERT_CONTEXT_PUSH("shard", shard);
+ * ...
+ * KASSERT_CONTEXT_POP();
+ *
+ * The example of output can be like this:
+ * main.c:9: h: Assertion 'n == 10' failed. (100 == 10)
+ * ThreadID: 739210
+ * Context (newest first):
+ *     shard = 7
+ *     request = 1042
+ * Stacktrace:
+ */
+#define KASSERT_CONTEXT_PUSH(tag, val)     ((void)KASSERT_PRIV_CONTEXT_PUSH("" tag, val))
+#define KASSERT_CONTEXT_POP()              __kassert_context_pop()
+#define KASSERT_CONTEXT_SCOPED(tag, val)   KASSERT_PRIV_CONTEXT_SCOPED(tag, val)
+
+/**
+ * Latency budgets in ns (see kassert-deadline.h). Time is taken from invariant TSC or CLOCK_MONOTONIC.
+ * ELAPSED_LT checks that less than budget_ns passed since start (timestamp from kassert_now()).
+ * DEADLINE starts the clock and checks the budget when the scope is left (also by return / break).
+ * Met budget costs two clock readings and compare.
+ *
+ * Example:
+ * KASSERT_DEADLINE(50000);
+ * ...
+ * const unsigned long long start = kassert_now();
+ * send(fd, buf, len, 0);
+ * KASSERT_ELAPSED_LT(start, 2000);
+ *
+ * The example of output can be like this:
+ * main.c:14: handle: Assertion 'elapsed_ns(scope) < 50000' failed. (73811 < 50000)
+ */
+#define KASSERT_ELAPSED_LT(start, budget_ns)        KASSERT_PRIV_ELAPSED_LT(KASSERT_LEVEL_NORMAL, FATAL, start, budget_ns)
+#define KASSERT_DEADLINE(budget_ns)                 KASSERT_PRIV_DEADLINE(KASSERT_LEVEL_NORMAL, FATAL, budget_ns)
+#define KASSERT_SOFT_ELAPSED_LT(start, budget_ns)   KASSERT_PRIV_ELAPSED_LT(KASSERT_LEVEL_NORMAL, SOFT, start, budget_ns)
+#define KASSERT_SOFT_DEADLINE(budget_ns)            KASSERT_PRIV_DEADLINE(KASSERT_LEVEL_NORMAL, SOFT, budget_ns)
+
+/**
+ * No-allocation regions (see kassert-noalloc.h). Allocation in the region fails at the allocating call,
+ * when libkassert-noalloc.a (interposer of malloc / free) is linked. Without it macros only mark the region.
+ * BEGIN / END can be nested, SCOPED ends the region at the end of the scope (also when scope is left by return / break).
+ * Region costs a thread-local increment and decrement, interposed malloc checks the depth by a load and compare.
+ *
+ * Example:
+ * KASSERT_NO_ALLOC_SCOPED();
+ * ...
+ * KASSERT_NO_ALLOC_BEGIN();
+ * route(pkt);
+ * KASSERT_NO_ALLOC_END();
+ *
+ * The example of output can be like this:
+ * main.c:12: handle: Assertion 'no allocation in region' failed.
+ * ThreadID: 739210
+ * Context (newest first):
+ *     malloc = 64
+ * Stacktrace:
+ */
+#define KASSERT_NO_ALLOC_BEGIN()    KASSERT_PRIV_NO_ALLOC_BEGIN(KASSERT_LEVEL_NORMAL)
+#define KASSERT_NO_ALLOC_END()      __kassert_noalloc_end()
+#define KASSERT_NO_ALLOC_SCOPED()   KASSERT_PRIV_NO_ALLOC_SCOPED(KASSERT_LEVEL_NORMAL)
+
+/**
+ * Integrity of pages, frames and blocks (see kassert-checksum.h).
+ * CRC32C is computed by crc32 instruction (3 streams folded by carry-less multiply for big buffers)
+ * or slice-by-8 tables, XXH64 (seed 0) is portable C. Both run at GB/s, so they can stay enabled in production.
+ * Failure prints computed and expected value.
+ *
+ * The example of output can be like this:
+ * main.c:30: page_read: Assertion 'crc32c(page->data, PAGE_SIZE) == page->crc' failed. (2910523156 == 2910523157)
+ */
+#define KASSERT_CRC32C_EQ(buf, len, expected)  KASSERT_PRIV_CRC32C_EQ(KASSERT_LEVEL_NORMAL, buf, len, expected)
+#define KASSERT_XXH64_EQ(buf, len, expected)   KASSERT_PRIV_XXH64_EQ(KASSERT_LEVEL_NORMAL, buf, len, expected)
+
+/**
+ * Like KASSERT, but in release builds with KASSERT_ASSUME_IN_RELEASE condition is always a hint for the optimizer.
+ * Use it for conditions which have no side effects, but the compiler cannot prove it (i.e. call of inline function).
+ * Other macros give the hint only when the compiler sees no side effects in the condition.
+ *
+ * Example:
+ * KASSERT_ASSUME(is_power_of_2(size));
+ */
+#define KASSERT_ASSUME(cond)      KASSERT(cond)
 
 /**
  * When you have assert in your code and want to use KASSERT instead of, pass this define to compiler
@@ -136,7 +404,67 @@
 
 #else /* ifndef NDEBUG */
 
-/* NDEBUG defined do nothing */
+/*
+    NDEBUG defined, conditions are not checked in runtime.
+    By default sites are empty. KASSERT_ASSUME_IN_RELEASE turns fatal assertions into hints for the optimizer:
+    if (!(cond)) __builtin_unreachable(), only for conditions without side effects, so nothing is evaluated.
+    Soft, array and memory assertions stay empty, failure of them is not undefined behaviour.
+    Please note that assertion which is false in runtime is undefined behaviour in this mode.
+*/
+#if defined(KASSERT_ASSUME_IN_RELEASE) || defined(KASSERT_STATIC_CHECK)
+
+#define KASSERT_EQ(val1, val2)    KASSERT_PRIV_RELEASE_OP(val1, val2, ==)
+#define KASSERT_NEQ(val1, val2)   KASSERT_PRIV_RELEASE_OP(val1, val2, !=)
+#define KASSERT_GT(val1, val2)    KASSERT_PRIV_RELEASE_OP(val1, val2, >)
+#define KASSERT_GEQ(val1, val2)   KASSERT_PRIV_RELEASE_OP(val1, val2, >=)
+#define KASSERT_LT(val1, val2)    KASSERT_PRIV_RELEASE_OP(val1, val2, <)
+#define KASSERT_LEQ(val1, val2)   KASSERT_PRIV_RELEASE_OP(val1, val2, <=)
+
+#define KASSERT(cond)             KASSERT_PRIV_RELEASE(cond)
+#define KASSERT_ASSUME(cond)      KASSERT_PRIV_RELEASE_FORCED(cond)
+
+#define KASSERT_EQ_L(level, val1, val2)    KASSERT_EQ(val1, val2)
+#define KASSERT_NEQ_L(level, val1, val2)   KASSERT_NEQ(val1, val2)
+#define KASSERT_GT_L(level, val1, val2)    KASSERT_GT(val1, val2)
+#define KASSERT_GEQ_L(level, val1, val2)   KASSERT_GEQ(val1, val2)
+#define KASSERT_LT_L(level, val1, val2)    KASSERT_LT(val1, val2)
+#define KASSERT_LEQ_L(level, val1, val2)   KASSERT_LEQ(val1, val2)
+
+#define KASSERT_L(level, cond)             KASSERT(cond)
+
+#define KASSERT_EQ_SAMPLED(rate, val1, val2)    KASSERT_EQ(val1, val2)
+#define KASSERT_NEQ_SAMPLED(rate, val1, val2)   KASSERT_NEQ(val1, val2)
+#define KASSERT_GT_SAMPLED(rate, val1, val2)    KASSERT_GT(val1, val2)
+#define KASSERT_GEQ_SAMPLED(rate, val1, val2)   KASSERT_GEQ(val1, val2)
+#define KASSERT_LT_SAMPLED(rate, val1, val2)    KASSERT_LT(val1, val2)
+#define KASSERT_LEQ_SAMPLED(rate, val1, val2)   KASSERT_LEQ(val1, val2)
+
+#define KASSERT_SAMPLED(rate, cond)             KASSERT(cond)
+
+#define KASSERT_EQ_ONCE(val1, val2)    KASSERT_EQ(val1, val2)
+#define KASSERT_NEQ_ONCE(val1, val2)   KASSERT_NEQ(val1, val2)
+#define KASSERT_GT_ONCE(val1, val2)    KASSERT_GT(val1, val2)
+#define KASSERT_GEQ_ONCE(val1, val2)   KASSERT_GEQ(val1, val2)
+#define KASSERT_LT_ONCE(val1, val2)    KASSERT_LT(val1, val2)
+#define KASSERT_LEQ_ONCE(val1, val2)   KASSERT_LEQ(val1, val2)
+
+#define KASSERT_ONCE(cond)             KASSERT(cond)
+
+#define KASSERT_EQ_ONCE_PER_THREAD(val1, val2)    KASSERT_EQ(val1, val2)
+#define KASSERT_NEQ_ONCE_PER_THREAD(val1, val2)   KASSERT_NEQ(val1, val2)
+#define KASSERT_GT_ONCE_PER_THREAD(val1, val2)    KASSERT_GT(val1, val2)
+#define KASSERT_GEQ_ONCE_PER_THREAD(val1, val2)   KASSERT_GEQ(val1, val2)
+#define KASSERT_LT_ONCE_PER_THREAD(val1, val2)    KASSERT_LT(val1, val2)
+#define KASSERT_LEQ_ONCE_PER_THREAD(val1, val2)   KASSERT_LEQ(val1, val2)
+
+#define KASSERT_ONCE_PER_THREAD(cond)             KASSERT(cond)
+
+#define KASSERT_PTR_NOT_NULL(ptr) KASSERT_NEQ(ptr, KASSERT_PRIV_NULL(void *))
+
+#define KASSERT_PTR_NULL(ptr)     KASSERT_EQ(ptr, KASSERT_PRIV_NULL(void *))
+
+#else /* if defined(KASSERT_ASSUME_IN_RELEASE) || defined(KASSERT_STATIC_CHECK) */
+
 #define KASSERT_EQ(val1, val2)
 #define KASSERT_NEQ(val1, val2)
 #define KASSERT_GT(val1, val2)
@@ -145,11 +473,99 @@
 #define KASSERT_LEQ(val1, val2)
 
 #define KASSERT(cond)
+#define KASSERT_ASSUME(cond)
+
+#define KASSERT_EQ_L(level, val1, val2)
+#define KASSERT_NEQ_L(level, val1, val2)
+#define KASSERT_GT_L(level, val1, val2)
+#define KASSERT_GEQ_L(level, val1, val2)
+#define KASSERT_LT_L(level, val1, val2)
+#define KASSERT_LEQ_L(level, val1, val2)
+
+#define KASSERT_L(level, cond)
+
+#define KASSERT_EQ_SAMPLED(rate, val1, val2)
+#define KASSERT_NEQ_SAMPLED(rate, val1, val2)
+#define KASSERT_GT_SAMPLED(rate, val1, val2)
+#define KASSERT_GEQ_SAMPLED(rate, val1, val2)
+#define KASSERT_LT_SAMPLED(rate, val1, val2)
+#define KASSERT_LEQ_SAMPLED(rate, val1, val2)
+
+#define KASSERT_SAMPLED(rate, cond)
+
+#define KASSERT_EQ_ONCE(val1, val2)
+#define KASSERT_NEQ_ONCE(val1, val2)
+#define KASSERT_GT_ONCE(val1, val2)
+#define KASSERT_GEQ_ONCE(val1, val2)
+#define KASSERT_LT_ONCE(val1, val2)
+#define KASSERT_LEQ_ONCE(val1, val2)
+
+#define KASSERT_ONCE(cond)
+
+#define KASSERT_EQ_ONCE_PER_THREAD(val1, val2)
+#define KASSERT_NEQ_ONCE_PER_THREAD(val1, val2)
+#define KASSERT_GT_ONCE_PER_THREAD(val1, val2)
+#define KASSERT_GEQ_ONCE_PER_THREAD(val1, val2)
+#define KASSERT_LT_ONCE_PER_THREAD(val1, val2)
+#define KASSERT_LEQ_ONCE_PER_THREAD(val1, val2)
+
+#define KASSERT_ONCE_PER_THREAD(cond)
 
 #define KASSERT_PTR_NOT_NULL(ptr)
 
 #define KASSERT_PTR_NULL(ptr)
 
+#endif /* if defined(KASSERT_ASSUME_IN_RELEASE) || defined(KASSERT_STATIC_CHECK) */
+
+#define KASSERT_SOFT_EQ(val1, val2)
+#define KASSERT_SOFT_NEQ(val1, val2)
+#define KASSERT_SOFT_GT(val1, val2)
+#define KASSERT_SOFT_GEQ(val1, val2)
+#define KASSERT_SOFT_LT(val1, val2)
+#define KASSERT_SOFT_LEQ(val1, val2)
+
+#define KASSERT_SOFT(cond)
+
+#define KASSERT_ALL_EQ(array, count, bound)
+#define KASSERT_ALL_NEQ(array, count, bound)
+#define KASSERT_ALL_GT(array, count, bound)
+#define KASSERT_ALL_GEQ(array, count, bound)
+#define KASSERT_ALL_LT(array, count, bound)
+#define KASSERT_ALL_LEQ(array, count, bound)
+
+#define KASSERT_ALL_IN_RANGE(array, count, min, max)
+#define KASSERT_SORTED(array, count)
+#define KASSERT_ALL_FINITE(array, count)
+
+#define KASSERT_MEM_EQ(ptr1, ptr2, len)
+#define KASSERT_MEM_ZERO(ptr, len)
+#define KASSERT_MEM_PATTERN(ptr, len, byte)
+
+#define KASSERT_ON_THREAD(owner)
+#define KASSERT_NOT_ON_THREAD(owner)
+#define KASSERT_MUTEX_HELD(m)
+#define KASSERT_MUTEX_NOT_HELD(m)
+
+#define KASSERT_CONTEXT_PUSH(tag, val)
+#define KASSERT_CONTEXT_POP()
+#define KASSERT_CONTEXT_SCOPED(tag, val)
+
+#define KASSERT_ELAPSED_LT(start, budget_ns)
+#define KASSERT_DEADLINE(budget_ns)
+#define KASSERT_SOFT_ELAPSED_LT(start, budget_ns)
+#define KASSERT_SOFT_DEADLINE(budget_ns)
+
+#define KASSERT_NO_ALLOC_BEGIN()
+#define KASSERT_NO_ALLOC_END()
+#define KASSERT_NO_ALLOC_SCOPED()
+
+#define KASSERT_CRC32C_EQ(buf, len, expected)
+#define KASSERT_XXH64_EQ(buf, len, expected)
+
+/* Arguments are not evaluated, sizeof only marks them as used */
+#define KASSERT_INVARIANT_REGISTER(fn, obj, hooks, budget_us) \
+    ((void)sizeof(&(fn)), (void)sizeof(obj), (void)sizeof(hooks), (void)sizeof(budget_us), KASSERT_PRIV_NULL(kassert_invariant_t *))
+
 #endif /* ifndef NDEBUG */
 
 #endif /* include guard */
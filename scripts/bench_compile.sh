@@ -0,0 +1,118 @@
+#!/bin/bash
+
+# Author: Michal Kukowski
+# email: michalkukowski10@gmail.com
+
+# Compile time benchmark of the KAssert macros.
+# Generates translation units with 1k and 10k assertion sites (relations of every kind of primitive, pointers and conditions)
+# and reports bytes after preprocessing and seconds of compilation (-O0 and -O2) for every compiler as JSON.
+#
+# Usage: bench_compile.sh [compilers...], default: gcc clang. Missing compilers are skipped.
+# SITES="1000 10000" and REPEAT=3 (the best time is reported) can be changed by environment.
+
+# Full path of this script
+THIS_DIR=`readlink -f "${BASH_SOURCE[0]}" 2>/dev/null||echo $0`
+
+# This directory path
+DIR=`dirname "${THIS_DIR}"`
+
+INC_DIR="$DIR/../inc"
+
+SITES=${SITES:-"1000 10000"}
+REPEAT=${REPEAT:-3}
+
+compilers="$@"
+if [ -z "$compilers" ]; then
+    compilers="gcc clang"
+fi
+
+TMP_DIR=`mktemp -d`
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+# Every function has 10 sites
+generate()
+{
+    local sites=$1
+    local file=$2
+
+    {
+        echo "#include <stdbool.h>"
+        echo "#include <stddef.h>"
+        echo "#include <kassert/kassert.h>"
+        echo ""
+        echo "struct bench_obj { int i; unsigned u; long l; unsigned long long ull; double d; float f; char c; bool b; const void* p; };"
+        echo ""
+
+        for ((i = 0; i < sites / 10; ++i)); do
+            echo "int bench_fn_$i(const struct bench_obj* o, const struct bench_obj* r);"
+            echo "int bench_fn_$i(const struct bench_obj* o, const struct bench_obj* r)"
+            echo "{"
+            echo "    KASSERT_PTR_NOT_NULL(o);"
+            echo "    KASSERT_EQ(o->i, r->i);"
+            echo "    KASSERT_NEQ(o->u, r->u + 1U);"
+            echo "    KASSERT_LT(o->l, r->l * 2);"
+            echo "    KASSERT_LEQ(o->ull, r->ull);"
+            echo "    KASSERT_GT(o->d, r->d);"
+            echo "    KASSERT_GEQ(o->f, r->f);"
+            echo "    KASSERT_EQ(o->b, true);"
+            echo "    KASSERT_NEQ(o->p, r->p);"
+            echo "    KASSERT(o->c != 'x' && o->i > $i);"
+            echo "    return o->i;"
+            echo "}"
+            echo ""
+        done
+    } > "$file"
+}
+
+# The best of REPEAT runs, in seconds
+compile_time()
+{
+    local cc=$1
+    local opt=$2
+    local file=$3
+    local best=
+
+    for ((r = 0; r < REPEAT; ++r)); do
+        local start=`date +%s%N`
+        $cc -std=gnu17 $opt -I"$INC_DIR" -c "$file" -o "$TMP_DIR/bench.o" || return 1
+        local end=`date +%s%N`
+        local ns=$((end - start))
+        if [ -z "$best" ] || [ $ns -lt $best ]; then
+            best=$ns
+        fi
+    done
+
+    awk -v ns=$best 'BEGIN { printf "%.3f", ns / 1e9 }'
+}
+
+results=()
+for sites in $SITES; do
+    file="$TMP_DIR/bench_$sites.c"
+    generate $sites "$file"
+
+    for cc in $compilers; do
+        if ! command -v $cc > /dev/null 2>&1; then
+            echo "$cc not found, skipped" >&2
+            continue
+        fi
+
+        bytes=`$cc -std=gnu17 -E -P -I"$INC_DIR" "$file" | wc -c`
+        o0=`compile_time $cc -O0 "$file"` || exit 1
+        o2=`compile_time $cc -O2 "$file"` || exit 1
+
+        results+=("    {\"compiler\": \"$cc\", \"sites\": $sites, \"preprocessed_bytes\": $bytes, \"bytes_per_site\": $((bytes / sites)), \"O0_s\": $o0, \"O2_s\": $o2}")
+    done
+done
+
+echo "{"
+echo "  \"schema\": 1,"
+echo "  \"compile\": ["
+for ((i = 0; i < ${#results[@]}; ++i)); do
+    if [ $i -lt $((${#results[@]} - 1)) ]; then
+        echo "${results[$i]},"
+    else
+        echo "${results[$i]}"
+    fi
+done
+echo "  ]"
+echo "}"
@@ -25,7 +25,7 @@ echo "DIR = $lib_dir"
 # Compile KAssert
 cd "$DIR"
 cd ../
-make lib
+make lib tools
 
 # Now we have compiled kassert into libkassert.a we need also a inc/ directory
 
@@ -33,6 +33,8 @@ make lib
 echo "Installing kassert to $lib_dir ..."
 mkdir -p "$lib_dir"
 cp ./libkassert.a $lib_dir/
+cp ./libkassert-noalloc.a $lib_dir/
+cp ./kassert-decode $lib_dir/
 cp -R ./inc/ $lib_dir
 
 echo "DONE"
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+/*
+    Kernels of KASSERT_ALL_* / KASSERT_SORTED / KASSERT_ALL_FINITE.
+
+    Array is checked in blocks. Block loop only ORs results of the checks without any exit,
+    so compiler vectorizes it for the ISA of the kernel. Block with a bad element is scanned again
+    to find the first one, this is done at most once per call.
+
+    Kernels are the same C code compiled for every ISA by target attribute:
+    scalar - loop with exit on the first bad element, no vectorization
+    sse2   - default flags (SSE2 is the baseline of x86-64, NEON / other SIMD elsewhere)
+    avx2   - x86 only
+    avx512 - x86 only (avx512f + avx512bw, so also 8 and 16 bit elements use zmm registers)
+*/
+
+/* Elements checked without exit, small enough to stay in L1 when block is scanned again */
+#define ARRAY_BLOCK 256
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_X86 1
+#else
+#define ARRAY_X86 0
+#endif
+
+typedef size_t (*kassert_array_kernel_t)(const void* array, size_t count, const void* bound1, const void* bound2);
+
+/* X(arg, name, type), element types in order of KASSERT_PRIMITIVES (bool is a macro, so it cannot be a name) */
+#define ARRAY_TYPES(X, arg) \
+    X(arg, boolean,            bool) \
+    X(arg, char,               char) \
+    X(arg, signed_char,        signed char) \
+    X(arg, unsigned_char,      unsigned char) \
+    X(arg, short,              short) \
+    X(arg, unsigned_short,     unsigned short) \
+    X(arg, int,                int) \
+    X(arg, unsigned_int,       unsigned int) \
+    X(arg, long,               long) \
+    X(arg, unsigned_long,      unsigned long) \
+    X(arg, long_long,          long long) \
+    X(arg, unsigned_long_long, unsigned long long) \
+    X(arg, float,              float) \
+    X(arg, double,             double) \
+    X(arg, long_double,        long double)
+
+/* X(arg, op), FINITE has own kernels only for floating point types */
+#define ARRAY_OPS(X, arg) \
+    X(arg, EQ) \
+    X(arg, NEQ) \
+    X(arg, LT) \
+    X(arg, LEQ) \
+    X(arg, GT) \
+    X(arg, GEQ) \
+    X(arg, IN_RANGE) \
+    X(arg, SORTED)
+
+#define ARRAY_FLOAT_TYPES(X, arg) \
+    X(arg, float,       float) \
+    X(arg, double,      double) \
+    X(arg, long_double, long double)
+
+/* True when a[i] does not pass the check, written without branches */
+#define ARRAY_BAD_EQ(a, i, b1, b2)       (!((a)[i] == (b1)))
+#define ARRAY_BAD_NEQ(a, i, b1, b2)      (!((a)[i] != (b1)))
+#define ARRAY_BAD_LT(a, i, b1, b2)       (!((a)[i] < (b1)))
+#define ARRAY_BAD_LEQ(a, i, b1, b2)      (!((a)[i] <= (b1)))
+#define ARRAY_BAD_GT(a, i, b1, b2)       (!((a)[i] > (b1)))
+#define ARRAY_BAD_GEQ(a, i, b1, b2)      (!((a)[i] >= (b1)))
+#define ARRAY_BAD_IN_RANGE(a, i, b1, b2) (!(((a)[i] >= (b1)) & ((a)[i] <= (b2))))
+#define ARRAY_BAD_SORTED(a, i, b1, b2)   (!((a)[i] <= (a)[(i) + 1]))
+
+/* x - x is 0 for finite x and nan for inf / nan, nan is the only value not equal to itself */
+#define ARRAY_BAD_FINITE(a, i, b1, b2)   (((a)[i] - (a)[i]) != ((a)[i] - (a)[i]))
+
+/* SORTED compares pairs, so it checks count - 1 elements */
+#define ARRAY_LEN_EQ(count)       (count)
+#define ARRAY_LEN_NEQ(count)      (count)
+#define ARRAY_LEN_LT(count)       (count)
+#define ARRAY_LEN_LEQ(count)      (count)
+#define ARRAY_LEN_GT(count)       (count)
+#define ARRAY_LEN_GEQ(count)      (count)
+#define ARRAY_LEN_IN_RANGE(count) (count)
+#define ARRAY_LEN_SORTED(count)   ((count) == 0 ? 0 : (count) - 1)
+#define ARRAY_LEN_FINITE(count)   (count)
+
+#define ARRAY_KERNEL_NAME(isa, op, name) __kassert_array_##isa##_##op##_##name
+
+/* Bounds are NULL when check has no bound */
+#define ARRAY_KERNEL_PROLOGUE(op, type) \
+    const type* const a = array; \
+    const type b1 = bound1 != NULL ? *(const type *)bound1 : (type)0; \
+    const type b2 = bound2 != NULL ? *(const type *)bound2 : (type)0; \
+    const size_t len = ARRAY_LEN_##op(count); \
+    (void)b1; \
+    (void)b2;
+
+#define ARRAY_SCALAR_KERNEL(op, name, type) \
+    static size_t ARRAY_KERNEL_NAME(scalar, op, name)(const void* array, size_t count, const void* bound1, const void* bound2) \
+    { \
+        ARRAY_KERNEL_PROLOGUE(op, type) \
+        for (size_t i = 0; i < len; ++i) \
+            if (ARRAY_BAD_##op(a, i, b1, b2)) \
+                return i; \
+        return count; \
+    }
+
+#define ARRAY_BLOCK_KERNEL(isa, attr, op, name, type) \
+    static size_t __attribute__(( attr )) ARRAY_KERNEL_NAME(isa, op, name)(const void* array, size_t count, const void* bound1, const void* bound2) \
+    { \
+        ARRAY_KERNEL_PROLOGUE(op, type) \
+        for (size_t i = 0; i < len; i += ARRAY_BLOCK) \
+        { \
+            const size_t end = len - i > ARRAY_BLOCK ? i + ARRAY_BLOCK : len; \
+            int bad = 0; \
+            for (size_t j = i; j < end; ++j) \
+                bad |= ARRAY_BAD_##op(a, j, b1, b2); \
+            if (__builtin_expect(bad, 0)) \
+                for (size_t j = i; j < end; ++j) \
+                    if (ARRAY_BAD_##op(a, j, b1, b2)) \
+                        return j; \
+        } \
+        return count; \
+    }
+
+#define ARRAY_DEFINE_ISA_TYPE(args, name, type) ARRAY_DEFINE_ISA_TYPE_I((ARRAY_EXPAND args, name, type))
+#define ARRAY_DEFINE_ISA_TYPE_I(args) ARRAY_DEFINE_ISA_TYPE_II args
+#define ARRAY_DEFINE_ISA_TYPE_II(kernel, op, name, type) kernel(op, name, type)
+#define ARRAY_EXPAND(...) __VA_ARGS__
+
+#define ARRAY_DEFINE_OP(kernel, op) ARRAY_TYPES(ARRAY_DEFINE_ISA_TYPE, (kernel, op))
+
+/* Kernels of one ISA, kernel(op, name, type) */
+#define ARRAY_DEFINE_KERNELS(kernel) \
+    ARRAY_OPS(ARRAY_DEFINE_OP, kernel) \
+    ARRAY_FLOAT_TYPES(ARRAY_DEFINE_ISA_TYPE, (kernel, FINITE))
+
+#define ARRAY_SSE2_KERNEL(op, name, type)   ARRAY_BLOCK_KERNEL(sse2, , op, name, type)
+
+ARRAY_DEFINE_KERNELS(ARRAY_SCALAR_KERNEL)
+ARRAY_DEFINE_KERNELS(ARRAY_SSE2_KERNEL)
+
+#if ARRAY_X86
+#define ARRAY_AVX2_KERNEL(op, name, type)   ARRAY_BLOCK_KERNEL(avx2, target("avx2"), op, name, type)
+#define ARRAY_AVX512_KERNEL(op, name, type) ARRAY_BLOCK_KERNEL(avx512, target("avx512f,avx512bw"), op, name, type)
+
+ARRAY_DEFINE_KERNELS(ARRAY_AVX2_KERNEL)
+ARRAY_DEFINE_KERNELS(ARRAY_AVX512_KERNEL)
+#endif
+
+/* Tables [op][type], FINITE of integer types is NULL (rejected by the macro during compilation) */
+#define ARRAY_TABLE_TYPE(args, name, type) ARRAY_TABLE_TYPE_I((ARRAY_EXPAND args, name))
+#define ARRAY_TABLE_TYPE_I(args) ARRAY_TABLE_TYPE_II args
+#define ARRAY_TABLE_TYPE_II(isa, op, name) [KASSERT_PRIMITIVES_##name] = ARRAY_KERNEL_NAME(isa, op, name),
+
+#define ARRAY_TABLE_OP(isa, op) [KASSERT_ARRAY_OP_##op] = { ARRAY_TYPES(ARRAY_TABLE_TYPE, (isa, op)) },
+
+#define ARRAY_TABLE(isa) \
+    { \
+        ARRAY_OPS(ARRAY_TABLE_OP, isa) \
+        [KASSERT_ARRAY_OP_FINITE] = { ARRAY_FLOAT_TYPES(ARRAY_TABLE_TYPE, (isa, FINITE)) } \
+    }
+
+/* KASSERT_PRIMITIVES_name uses upper case names */
+#define KASSERT_PRIMITIVES_boolean            KASSERT_PRIMITIVES_BOOL
+#define KASSERT_PRIMITIVES_char               KASSERT_PRIMITIVES_CHAR
+#define KASSERT_PRIMITIVES_signed_char        KASSERT_PRIMITIVES_SIGNED_CHAR
+#define KASSERT_PRIMITIVES_unsigned_char      KASSERT_PRIMITIVES_UNSIGNED_CHAR
+#define KASSERT_PRIMITIVES_short              KASSERT_PRIMITIVES_SHORT
+#define KASSERT_PRIMITIVES_unsigned_short     KASSERT_PRIMITIVES_UNSIGNED_SHORT
+#define KASSERT_PRIMITIVES_int                KASSERT_PRIMITIVES_INT
+#define KASSERT_PRIMITIVES_unsigned_int       KASSERT_PRIMITIVES_UNSIGNED_INT
+#define KASSERT_PRIMITIVES_long               KASSERT_PRIMITIVES_LONG
+#define KASSERT_PRIMITIVES_unsigned_long      KASSERT_PRIMITIVES_UNSIGNED_LONG
+#define KASSERT_PRIMITIVES_long_long          KASSERT_PRIMITIVES_LONG_LONG
+#define KASSERT_PRIMITIVES_unsigned_long_long KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG
+#define KASSERT_PRIMITIVES_float              KASSERT_PRIMITIVES_FLOAT
+#define KASSERT_PRIMITIVES_double             KASSERT_PRIMITIVES_DOUBLE
+#define KASSERT_PRIMITIVES_long_double        KASSERT_PRIMITIVES_LONG_DOUBLE
+
+typedef kassert_array_kernel_t kassert_array_table_t[KASSERT_ARRAY_OP_FINITE + 1][KASSERT_PRIMITIVES_NON_PRIMITIVE];
+
+static const kassert_array_table_t __kassert_array_tables[KASSERT_ISA_COUNT] =
+{
+    [KASSERT_ISA_SCALAR] = ARRAY_TABLE(scalar),
+    [KASSERT_ISA_SSE2]   = ARRAY_TABLE(sse2),
+#if ARRAY_X86
+    [KASSERT_ISA_AVX2]   = ARRAY_TABLE(avx2),
+    [KASSERT_ISA_AVX512] = ARRAY_TABLE(avx512),
+#endif
+};
+
+static const char* const __kassert_isa_names[KASSERT_ISA_COUNT] =
+{
+    [KASSERT_ISA_SCALAR] = "scalar",
+    [KASSERT_ISA_SSE2]   = "sse2",
+    [KASSERT_ISA_AVX2]   = "avx2",
+    [KASSERT_ISA_AVX512] = "avx512"
+};
+
+/* Selected table, NULL until the first call */
+static const kassert_array_table_t* __kassert_array_table;
+
+static KASSERT_ISA __kassert_isa_supported(void);
+static const kassert_array_table_t* __kassert_array_select(void);
+
+static KASSERT_ISA __kassert_isa_supported(void)
+{
+#if ARRAY_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return KASSERT_ISA_AVX512;
+
+    if (__builtin_cpu_supports("avx2"))
+        return KASSERT_ISA_AVX2;
+#endif
+
+    return KASSERT_ISA_SSE2;
+}
+
+static const kassert_array_table_t* __kassert_array_select(void)
+{
+    const kassert_array_table_t* table = &__kassert_array_tables[__kassert_isa()];
+
+    /* Threads racing here select the same table */
+    __atomic_store_n(&__kassert_array_table, table, __ATOMIC_RELEASE);
+
+    return table;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+KASSERT_ISA __kassert_isa(void)
+{
+    KASSERT_ISA isa = __kassert_isa_supported();
+
+    const char* env = getenv("KASSERT_ARRAY_ISA");
+    if (env != NULL)
+        for (size_t i = 0; i < KASSERT_ISA_COUNT; ++i)
+            if (strcmp(env, __kassert_isa_names[i]) == 0 && (KASSERT_ISA)i < isa)
+                isa = (KASSERT_ISA)i;
+
+    return isa;
+}
+
+size_t __kassert_array_find(KASSERT_ARRAY_OP op,
+                            KASSERT_PRIMITIVES type,
+                            const void* array,
+                            size_t count,
+                            const void* bound1,
+                            const void* bound2)
+{
+    const kassert_array_table_t* table = __atomic_load_n(&__kassert_array_table, __ATOMIC_ACQUIRE);
+    if (__builtin_expect(table == NULL, 0))
+        table = __kassert_array_select();
+
+    const kassert_array_kernel_t kernel = (*table)[op][type];
+    if (kernel == NULL)
+        return count;
+
+    return kernel(array, count, bound1, bound2);
+}
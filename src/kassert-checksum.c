@@ -0,0 +1,398 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CHECKSUM_X86_64 1
+#else
+#define CHECKSUM_X86_64 0
+#endif
+
+/* Reflected polynomial of CRC32C */
+#define CRC32C_POLY             0x82f63b78U
+
+/* Bytes of one stream of PCLMUL kernel, long blocks first, then short ones */
+#define CRC32C_LONG             8192
+#define CRC32C_SHORT            256
+
+#define XXH_PRIME64_1           0x9e3779b185ebca87ULL
+#define XXH_PRIME64_2           0xc2b2ae3d27d4eb4fULL
+#define XXH_PRIME64_3           0x165667b19e3779f9ULL
+#define XXH_PRIME64_4           0x85ebca77c2b2ae63ULL
+#define XXH_PRIME64_5           0x27d4eb2f165667c5ULL
+
+/* Raw register in, raw register out, initial value and final xor are done by the caller */
+typedef uint32_t (*kassert_crc32c_fn_t)(uint32_t crc, const unsigned char* buf, size_t len);
+
+static uint32_t __kassert_crc32c_table[8][256];
+
+/*
+    Shift of CRC register by n bytes of zeros is multiplication by x^(8n) mod P.
+    Carry-less product of reflected values is multiplied by x and crc32 instruction multiplies by x^32,
+    so constants are x^(8n - 33) mod P.
+*/
+static uint64_t __kassert_crc32c_long_shift[2];
+static uint64_t __kassert_crc32c_short_shift[2];
+
+static kassert_crc32c_fn_t   __kassert_crc32c_fn;
+static KASSERT_CRC32C_KERNEL __kassert_crc32c_kernel;
+static KASSERT_CRC32C_KERNEL __kassert_crc32c_supported;
+static pthread_once_t        __kassert_crc32c_once = PTHREAD_ONCE_INIT;
+
+static const char* const __kassert_crc32c_names[KASSERT_CRC32C_KERNEL_COUNT] =
+{
+    [KASSERT_CRC32C_KERNEL_SLICE8] = "slice8",
+    [KASSERT_CRC32C_KERNEL_SSE42]  = "sse42",
+    [KASSERT_CRC32C_KERNEL_PCLMUL] = "pclmul"
+};
+
+static uint32_t __kassert_crc32c_slice8(uint32_t crc, const unsigned char* buf, size_t len);
+#if CHECKSUM_X86_64
+static uint32_t __kassert_crc32c_sse42(uint32_t crc, const unsigned char* buf, size_t len);
+static uint32_t __kassert_crc32c_shift(uint32_t crc, uint64_t k);
+static uint32_t __kassert_crc32c_3way(uint32_t crc, const unsigned char** buf, size_t* len, size_t block, const uint64_t* k);
+static uint32_t __kassert_crc32c_pclmul(uint32_t crc, const unsigned char* buf, size_t len);
+#endif
+static uint32_t __kassert_crc32c_xpow(size_t exponent);
+static KASSERT_CRC32C_KERNEL __kassert_crc32c_kernel_supported(void);
+static void __kassert_crc32c_setup(void);
+static kassert_crc32c_fn_t __kassert_crc32c_kernel_fn(KASSERT_CRC32C_KERNEL kernel);
+static uint64_t __kassert_xxh64_read64(const unsigned char* ptr);
+static uint32_t __kassert_xxh64_read32(const unsigned char* ptr);
+static uint64_t __kassert_xxh64_rotl(uint64_t val, unsigned int bits);
+static uint64_t __kassert_xxh64_round(uint64_t acc, uint64_t input);
+static uint64_t __kassert_xxh64_merge(uint64_t acc, uint64_t val);
+
+static uint32_t __kassert_crc32c_slice8(uint32_t crc, const unsigned char* buf, size_t len)
+{
+    uint32_t (*const t)[256] = __kassert_crc32c_table;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; len >= 8; buf += 8, len -= 8)
+    {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy(&lo, buf, sizeof(lo));
+        memcpy(&hi, buf + 4, sizeof(hi));
+
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+#endif
+
+    for (; len > 0; ++buf, --len)
+        crc = t[0][(crc ^ *buf) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+#if CHECKSUM_X86_64
+static uint32_t __attribute__(( target("sse4.2") )) __kassert_crc32c_sse42(uint32_t crc, const unsigned char* buf, size_t len)
+{
+    for (; len > 0 && ((uintptr_t)buf & 7) != 0; ++buf, --len)
+        crc = _mm_crc32_u8(crc, *buf);
+
+    uint64_t crc64 = crc;
+    for (; len >= 8; buf += 8, len -= 8)
+    {
+        uint64_t val;
+        memcpy(&val, buf, sizeof(val));
+        crc64 = _mm_crc32_u64(crc64, val);
+    }
+    crc = (uint32_t)crc64;
+
+    for (; len > 0; ++buf, --len)
+        crc = _mm_crc32_u8(crc, *buf);
+
+    return crc;
+}
+
+/* crc * x^(8n) mod P, k is the constant of n */
+static inline uint32_t __attribute__(( target("sse4.2,pclmul") )) __kassert_crc32c_shift(uint32_t crc, uint64_t k)
+{
+    const __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc), _mm_cvtsi64_si128((long long)k), 0);
+
+    return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(prod));
+}
+
+/*
+    Blocks of 3 * block bytes, every stream has its own crc32 chain, so 3 instructions are in flight.
+    Streams 1 and 2 start from 0, CRC is linear: crc(A B C) = crc(A) * x^(16 block) ^ crc(B) * x^(8 block) ^ crc(C).
+    k[0] shifts by block bytes, k[1] by 2 * block bytes.
+*/
+static inline uint32_t __attribute__(( target("sse4.2,pclmul") )) __kassert_crc32c_3way(uint32_t crc,
+                                                                                          const unsigned char** buf,
+                                                                                          size_t* len,
+                                                                                          size_t block,
+                                                                                          const uint64_t* k)
+{
+    const unsigned char* ptr = *buf;
+    size_t left = *len;
+
+    for (; left >= 3 * block; left -= 3 * block)
+    {
+        uint64_t crc0 = crc;
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+
+        for (size_t i = 0; i < block; i += 8)
+        {
+            uint64_t val0;
+            uint64_t val1;
+            uint64_t val2;
+            memcpy(&val0, ptr + i, sizeof(val0));
+            memcpy(&val1, ptr + block + i, sizeof(val1));
+            memcpy(&val2, ptr + 2 * block + i, sizeof(val2));
+
+            crc0 = _mm_crc32_u64(crc0, val0);
+            crc1 = _mm_crc32_u64(crc1, val1);
+            crc2 = _mm_crc32_u64(crc2, val2);
+        }
+
+        crc = __kassert_crc32c_shift((uint32_t)crc0, k[1]) ^ __kassert_crc32c_shift((uint32_t)crc1, k[0]) ^ (uint32_t)crc2;
+        ptr += 3 * block;
+    }
+
+    *buf = ptr;
+    *len = left;
+
+    return crc;
+}
+
+static uint32_t __attribute__(( target("sse4.2,pclmul") )) __kassert_crc32c_pclmul(uint32_t crc, const unsigned char* buf, size_t len)
+{
+    if (len < 3 * CRC32C_SHORT)
+        return __kassert_crc32c_sse42(crc, buf, len);
+
+    for (; ((uintptr_t)buf & 7) != 0; ++buf, --len)
+        crc = _mm_crc32_u8(crc, *buf);
+
+    crc = __kassert_crc32c_3way(crc, &buf, &len, CRC32C_LONG, __kassert_crc32c_long_shift);
+    crc = __kassert_crc32c_3way(crc, &buf, &len, CRC32C_SHORT, __kassert_crc32c_short_shift);
+
+    return __kassert_crc32c_sse42(crc, buf, len);
+}
+#endif
+
+/* x^exponent mod P, reflected */
+static uint32_t __kassert_crc32c_xpow(size_t exponent)
+{
+    uint32_t val = 0x80000000U;
+
+    for (size_t i = 0; i < exponent; ++i)
+        val = (val >> 1) ^ ((val & 1) != 0 ? CRC32C_POLY : 0);
+
+    return val;
+}
+
+static KASSERT_CRC32C_KERNEL __kassert_crc32c_kernel_supported(void)
+{
+#if CHECKSUM_X86_64
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul"))
+        return KASSERT_CRC32C_KERNEL_PCLMUL;
+
+    if (__builtin_cpu_supports("sse4.2"))
+        return KASSERT_CRC32C_KERNEL_SSE42;
+#endif
+
+    return KASSERT_CRC32C_KERNEL_SLICE8;
+}
+
+static kassert_crc32c_fn_t __kassert_crc32c_kernel_fn(KASSERT_CRC32C_KERNEL kernel)
+{
+    switch (kernel)
+    {
+#if CHECKSUM_X86_64
+        case KASSERT_CRC32C_KERNEL_PCLMUL:
+            return __kassert_crc32c_pclmul;
+        case KASSERT_CRC32C_KERNEL_SSE42:
+            return __kassert_crc32c_sse42;
+#endif
+        default:
+            return __kassert_crc32c_slice8;
+    }
+}
+
+static void __kassert_crc32c_setup(void)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (unsigned int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32C_POLY : 0);
+
+        __kassert_crc32c_table[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; ++i)
+        for (size_t t = 1; t < 8; ++t)
+            __kassert_crc32c_table[t][i] = __kassert_crc32c_table[0][__kassert_crc32c_table[t - 1][i] & 0xff] ^
+                                           (__kassert_crc32c_table[t - 1][i] >> 8);
+
+    __kassert_crc32c_long_shift[0] = __kassert_crc32c_xpow(8 * CRC32C_LONG - 33);
+    __kassert_crc32c_long_shift[1] = __kassert_crc32c_xpow(16 * CRC32C_LONG - 33);
+    __kassert_crc32c_short_shift[0] = __kassert_crc32c_xpow(8 * CRC32C_SHORT - 33);
+    __kassert_crc32c_short_shift[1] = __kassert_crc32c_xpow(16 * CRC32C_SHORT - 33);
+
+    KASSERT_CRC32C_KERNEL kernel = __kassert_crc32c_kernel_supported();
+    __kassert_crc32c_supported = kernel;
+
+    const char* env = getenv("KASSERT_CRC32C_KERNEL");
+    if (env != NULL)
+        for (size_t i = 0; i < KASSERT_CRC32C_KERNEL_COUNT; ++i)
+            if (strcmp(env, __kassert_crc32c_names[i]) == 0 && (KASSERT_CRC32C_KERNEL)i < kernel)
+                kernel = (KASSERT_CRC32C_KERNEL)i;
+
+    __kassert_crc32c_kernel = kernel;
+    __atomic_store_n(&__kassert_crc32c_fn, __kassert_crc32c_kernel_fn(kernel), __ATOMIC_RELEASE);
+}
+
+static uint64_t __kassert_xxh64_read64(const unsigned char* ptr)
+{
+    uint64_t val;
+    memcpy(&val, ptr, sizeof(val));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    val = __builtin_bswap64(val);
+#endif
+
+    return val;
+}
+
+static uint32_t __kassert_xxh64_read32(const unsigned char* ptr)
+{
+    uint32_t val;
+    memcpy(&val, ptr, sizeof(val));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    val = __builtin_bswap32(val);
+#endif
+
+    return val;
+}
+
+static inline uint64_t __kassert_xxh64_rotl(uint64_t val, unsigned int bits)
+{
+    return (val << bits) | (val >> (64 - bits));
+}
+
+static inline uint64_t __kassert_xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = __kassert_xxh64_rotl(acc, 31);
+
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t __kassert_xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= __kassert_xxh64_round(0, val);
+
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+bool kassert_crc32c_kernel_set(KASSERT_CRC32C_KERNEL kernel)
+{
+    (void)pthread_once(&__kassert_crc32c_once, __kassert_crc32c_setup);
+
+    if (kernel >= KASSERT_CRC32C_KERNEL_COUNT || kernel > __kassert_crc32c_supported)
+        return false;
+
+    __kassert_crc32c_kernel = kernel;
+    __atomic_store_n(&__kassert_crc32c_fn, __kassert_crc32c_kernel_fn(kernel), __ATOMIC_RELEASE);
+
+    return true;
+}
+
+KASSERT_CRC32C_KERNEL kassert_crc32c_kernel_get(void)
+{
+    (void)pthread_once(&__kassert_crc32c_once, __kassert_crc32c_setup);
+
+    return __kassert_crc32c_kernel;
+}
+
+uint32_t kassert_crc32c_update(uint32_t crc, const void* buf, size_t len)
+{
+    kassert_crc32c_fn_t fn = __atomic_load_n(&__kassert_crc32c_fn, __ATOMIC_ACQUIRE);
+    if (__builtin_expect(fn == NULL, 0))
+    {
+        (void)pthread_once(&__kassert_crc32c_once, __kassert_crc32c_setup);
+        fn = __atomic_load_n(&__kassert_crc32c_fn, __ATOMIC_ACQUIRE);
+    }
+
+    return ~fn(~crc, buf, len);
+}
+
+uint32_t kassert_crc32c(const void* buf, size_t len)
+{
+    return kassert_crc32c_update(0, buf, len);
+}
+
+uint64_t kassert_xxh64(const void* buf, size_t len, uint64_t seed)
+{
+    const unsigned char* ptr = buf;
+    const unsigned char* const end = ptr + len;
+    uint64_t hash;
+
+    if (len >= 32)
+    {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+
+        for (; end - ptr >= 32; ptr += 32)
+        {
+            v1 = __kassert_xxh64_round(v1, __kassert_xxh64_read64(ptr));
+            v2 = __kassert_xxh64_round(v2, __kassert_xxh64_read64(ptr + 8));
+            v3 = __kassert_xxh64_round(v3, __kassert_xxh64_read64(ptr + 16));
+            v4 = __kassert_xxh64_round(v4, __kassert_xxh64_read64(ptr + 24));
+        }
+
+        hash = __kassert_xxh64_rotl(v1, 1) + __kassert_xxh64_rotl(v2, 7) + __kassert_xxh64_rotl(v3, 12) + __kassert_xxh64_rotl(v4, 18);
+        hash = __kassert_xxh64_merge(hash, v1);
+        hash = __kassert_xxh64_merge(hash, v2);
+        hash = __kassert_xxh64_merge(hash, v3);
+        hash = __kassert_xxh64_merge(hash, v4);
+    }
+    else
+        hash = seed + XXH_PRIME64_5;
+
+    hash += (uint64_t)len;
+
+    for (; end - ptr >= 8; ptr += 8)
+    {
+        hash ^= __kassert_xxh64_round(0, __kassert_xxh64_read64(ptr));
+        hash = __kassert_xxh64_rotl(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+
+    if (end - ptr >= 4)
+    {
+        hash ^= (uint64_t)__kassert_xxh64_read32(ptr) * XXH_PRIME64_1;
+        hash = __kassert_xxh64_rotl(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        ptr += 4;
+    }
+
+    for (; ptr < end; ++ptr)
+    {
+        hash ^= *ptr * XXH_PRIME64_5;
+        hash = __kassert_xxh64_rotl(hash, 11) * XXH_PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
@@ -0,0 +1,75 @@
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-report.h"
+
+__thread kassert_context_t __kassert_context __attribute__(( tls_model("initial-exec") ));
+
+static void __kassert_context_print_entry(kassert_report_t* report, const kassert_context_entry_t* entry);
+
+static void __kassert_context_print_entry(kassert_report_t* report, const kassert_context_entry_t* entry)
+{
+    kassert_value_t val;
+
+    switch (entry->type)
+    {
+        case KASSERT_PRIMITIVES_FLOAT:
+        case KASSERT_PRIMITIVES_DOUBLE:
+            val.d = entry->value.d;
+            break;
+        case KASSERT_PRIMITIVES_LONG_DOUBLE:
+            val.ld = entry->value.d;
+            break;
+        case KASSERT_PRIMITIVES_NON_PRIMITIVE:
+            val.ptr = entry->value.ptr;
+            break;
+        default:
+            /* s and u have the same representation */
+            val.u = entry->value.u;
+            break;
+    }
+
+    __kassert_report_str(report, "    ");
+    __kassert_report_str(report, entry->tag);
+    __kassert_report_str(report, " = ");
+    __kassert_report_value(report, entry->type, &val);
+    __kassert_report_char(report, '\n');
+}
+
+/***** GLOBAL FUNCTIONS *****/
+unsigned int __kassert_context_push_ld(const char* tag, KASSERT_PRIMITIVES type, long double val)
+{
+    __kassert_context_entry(tag, type)->value.d = (double)val;
+    return __kassert_context_commit();
+}
+
+void __kassert_context_dump(kassert_report_t* report)
+{
+    const unsigned int depth = __kassert_context.depth;
+    if (depth == 0)
+        return;
+
+    __atomic_signal_fence(__ATOMIC_ACQUIRE);
+
+    const unsigned int count = depth < KASSERT_CONTEXT_DEPTH ? depth : KASSERT_CONTEXT_DEPTH;
+    unsigned int printed = 0;
+
+    __kassert_report_str(report, "Context (newest first):\n");
+    for (unsigned int i = 1; i <= count; ++i)
+    {
+        /* Slot was reused by deeper push (popped later), entry of this depth is lost */
+        const kassert_context_entry_t* entry = &__kassert_context.entries[(depth - i) % KASSERT_CONTEXT_DEPTH];
+        if (entry->depth != depth - i)
+            continue;
+
+        __kassert_context_print_entry(report, entry);
+        ++printed;
+    }
+
+    if (depth > printed)
+    {
+        __kassert_report_str(report, "    ... ");
+        __kassert_report_uint(report, depth - printed);
+        __kassert_report_str(report, " entries are overwritten\n");
+    }
+}
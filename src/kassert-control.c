@@ -0,0 +1,617 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-report.h"
+
+/* Control file has fixed size, rules end at first NUL */
+#define CONTROL_FILE_SIZE         4096
+#define CONTROL_RULES_MAX         4096
+#define CONTROL_POLL_MS_DEFAULT   100
+#define CONTROL_RULE_DELIMS       ",; \t\r\n"
+
+/* Provided by linker, weak because program can have no assertions at all */
+extern const kassert_site_t __start_kassert_sites[] __attribute__(( weak ));
+extern const kassert_site_t __stop_kassert_sites[] __attribute__(( weak ));
+
+static const char* const __kassert_level_names[] =
+{
+    [KASSERT_LEVEL_CHEAP]     = "cheap",
+    [KASSERT_LEVEL_NORMAL]    = "normal",
+    [KASSERT_LEVEL_EXPENSIVE] = "expensive",
+    [KASSERT_LEVEL_PARANOID]  = "paranoid"
+};
+
+/* Only writers are serialized, hot path reads flags without any lock */
+static pthread_mutex_t __kassert_control_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Rules from KASSERT_CONTROL, they are reapplied when control file is changed */
+static char __kassert_control_env_rules[CONTROL_RULES_MAX];
+
+/* Last applied content of the control file */
+static char __kassert_control_file_rules[CONTROL_RULES_MAX];
+
+/* Rules are tokenized in place, so we need a copy */
+static char __kassert_control_parse_buf[CONTROL_RULES_MAX];
+
+/* Sites out of the section (C++ sites), slots are filled under control mutex and never reused */
+static const kassert_site_t* __kassert_sites_registered[KASSERT_SITES_REGISTERED_MAX];
+static size_t __kassert_sites_registered_count;
+
+/* Set by __kassert_control_init, site registered later gets the startup state when it is added */
+static bool __kassert_control_started;
+
+/* Rules change sites with ids in [first, end), only the new site when it is registered after startup */
+static size_t __kassert_control_first;
+static size_t __kassert_control_end = SIZE_MAX;
+
+static const char* __kassert_control_file_map;
+static int         __kassert_control_file_fd = -1;
+static unsigned    __kassert_control_poll_ms;
+
+static void __kassert_site_set(const kassert_site_t* site, bool enable);
+static bool __kassert_site_set_rate(const kassert_site_t* site, unsigned int rate);
+static const char* __kassert_basename(const char* path);
+static size_t __kassert_control_end_locked(void);
+static const kassert_site_t* __kassert_control_site_locked(size_t id);
+static void __kassert_set_level_locked(int level);
+static size_t __kassert_enable_file_locked(const char* glob, bool enable);
+static size_t __kassert_file_set_rate_locked(const char* glob, unsigned int rate);
+static bool __kassert_site_match(const kassert_site_t* site, const char* glob);
+static bool __kassert_enable_site_locked(size_t id, bool enable);
+static bool __kassert_control_rule_locked(char* rule);
+static bool __kassert_control_locked(const char* rules);
+static void __kassert_control_reset_locked(void);
+static void __kassert_control_file_poll(void);
+static void* __kassert_control_file_thread(void* arg);
+static bool __kassert_control_file_watch_locked(const char* path, unsigned poll_ms);
+
+static void __kassert_site_set(const kassert_site_t* site, bool enable)
+{
+    __atomic_store_n(&site->state->enabled, (unsigned char)enable, __ATOMIC_RELAXED);
+}
+
+static bool __kassert_site_set_rate(const kassert_site_t* site, unsigned int rate)
+{
+    if (site->sample_rate == NULL)
+        return false;
+
+    __atomic_store_n(site->sample_rate, rate, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+static const char* __kassert_basename(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+
+    return slash == NULL ? path : slash + 1;
+}
+
+static bool __kassert_site_match(const kassert_site_t* site, const char* glob)
+{
+    return fnmatch(glob, site->file, 0) == 0 || fnmatch(glob, __kassert_basename(site->file), 0) == 0;
+}
+
+static size_t __kassert_control_end_locked(void)
+{
+    const size_t count = kassert_sites_count();
+
+    return __kassert_control_end < count ? __kassert_control_end : count;
+}
+
+static const kassert_site_t* __kassert_control_site_locked(size_t id)
+{
+    if (id < __kassert_control_first || id >= __kassert_control_end_locked())
+        return NULL;
+
+    return kassert_site_get(id);
+}
+
+static void __kassert_set_level_locked(int level)
+{
+    const size_t end = __kassert_control_end_locked();
+    for (size_t id = __kassert_control_first; id < end; ++id)
+    {
+        const kassert_site_t* site = kassert_site_get(id);
+        __kassert_site_set(site, (int)site->level <= level);
+    }
+}
+
+static size_t __kassert_enable_file_locked(const char* glob, bool enable)
+{
+    size_t matched = 0;
+
+    const size_t end = __kassert_control_end_locked();
+    for (size_t id = __kassert_control_first; id < end; ++id)
+    {
+        const kassert_site_t* site = kassert_site_get(id);
+        if (__kassert_site_match(site, glob))
+        {
+            __kassert_site_set(site, enable);
+            ++matched;
+        }
+    }
+
+    return matched;
+}
+
+static size_t __kassert_file_set_rate_locked(const char* glob, unsigned int rate)
+{
+    size_t matched = 0;
+
+    const size_t end = __kassert_control_end_locked();
+    for (size_t id = __kassert_control_first; id < end; ++id)
+    {
+        const kassert_site_t* site = kassert_site_get(id);
+        if (__kassert_site_match(site, glob) && __kassert_site_set_rate(site, rate))
+            ++matched;
+    }
+
+    return matched;
+}
+
+static bool __kassert_enable_site_locked(size_t id, bool enable)
+{
+    const kassert_site_t* site = __kassert_control_site_locked(id);
+    if (site == NULL)
+        return false;
+
+    __kassert_site_set(site, enable);
+
+    return true;
+}
+
+static bool __kassert_control_rule_locked(char* rule)
+{
+    if (strncmp(rule, "level=", strlen("level=")) == 0)
+    {
+        const char* name = rule + strlen("level=");
+        if (strcasecmp(name, "none") == 0)
+        {
+            __kassert_set_level_locked(KASSERT_LEVEL_NONE);
+            return true;
+        }
+
+        for (size_t i = 0; i < sizeof(__kassert_level_names) / sizeof(__kassert_level_names[0]); ++i)
+            if (strcasecmp(name, __kassert_level_names[i]) == 0)
+            {
+                __kassert_set_level_locked((int)i);
+                return true;
+            }
+
+        return false;
+    }
+
+    if (strncmp(rule, "rate=", strlen("rate=")) == 0)
+    {
+        const char* rate_str = rule + strlen("rate=");
+        char* end;
+        const unsigned long rate = strtoul(rate_str, &end, 10);
+        if (end == rate_str || *end != ':' || rate > UINT_MAX)
+            return false;
+
+        ++end;
+        if (strncmp(end, "file=", strlen("file=")) == 0)
+        {
+            (void)__kassert_file_set_rate_locked(end + strlen("file="), (unsigned int)rate);
+            return true;
+        }
+
+        if (strncmp(end, "site=", strlen("site=")) == 0)
+        {
+            const char* id_str = end + strlen("site=");
+            const unsigned long long id = strtoull(id_str, &end, 10);
+            if (end == id_str || *end != '\0')
+                return false;
+
+            const kassert_site_t* site = __kassert_control_site_locked((size_t)id);
+
+            return site != NULL && __kassert_site_set_rate(site, (unsigned int)rate);
+        }
+
+        return false;
+    }
+
+    if (rule[0] != '+' && rule[0] != '-')
+        return false;
+
+    const bool enable = rule[0] == '+';
+    ++rule;
+
+    if (strncmp(rule, "file=", strlen("file=")) == 0)
+    {
+        (void)__kassert_enable_file_locked(rule + strlen("file="), enable);
+        return true;
+    }
+
+    if (strncmp(rule, "site=", strlen("site=")) == 0)
+    {
+        const char* id_str = rule + strlen("site=");
+        char* end;
+        const unsigned long long id = strtoull(id_str, &end, 10);
+        if (end == id_str || *end != '\0')
+            return false;
+
+        return __kassert_enable_site_locked((size_t)id, enable);
+    }
+
+    return false;
+}
+
+static bool __kassert_control_locked(const char* rules)
+{
+    bool ret = true;
+
+    strncpy(__kassert_control_parse_buf, rules, sizeof(__kassert_control_parse_buf) - 1);
+    __kassert_control_parse_buf[sizeof(__kassert_control_parse_buf) - 1] = '\0';
+
+    /* Comment to the end of line, useful in control file */
+    for (char* comment = strchr(__kassert_control_parse_buf, '#'); comment != NULL; comment = strchr(comment, '#'))
+        while (*comment != '\0' && *comment != '\n')
+            *comment++ = ' ';
+
+    char* saveptr = NULL;
+    for (char* rule = strtok_r(__kassert_control_parse_buf, CONTROL_RULE_DELIMS, &saveptr);
+         rule != NULL;
+         rule = strtok_r(NULL, CONTROL_RULE_DELIMS, &saveptr))
+        if (!__kassert_control_rule_locked(rule))
+            ret = false;
+
+    return ret;
+}
+
+/* Startup state: compile time default + KASSERT_CONTROL */
+static void __kassert_control_reset_locked(void)
+{
+    const size_t end = __kassert_control_end_locked();
+    for (size_t id = __kassert_control_first; id < end; ++id)
+    {
+        const kassert_site_t* site = kassert_site_get(id);
+        __kassert_site_set(site, site->enabled_default);
+        (void)__kassert_site_set_rate(site, site->sample_rate_default);
+    }
+
+    (void)__kassert_control_locked(__kassert_control_env_rules);
+}
+
+static void __kassert_control_file_poll(void)
+{
+    char rules[CONTROL_RULES_MAX];
+    struct stat st;
+
+    if (fstat(__kassert_control_file_fd, &st) != 0)
+        return;
+
+    /* File could be truncated by operator, do not touch pages beyond the end of file */
+    size_t len = st.st_size < 0 ? 0 : (size_t)st.st_size;
+    if (len > CONTROL_FILE_SIZE)
+        len = CONTROL_FILE_SIZE;
+    if (len > sizeof(rules) - 1)
+        len = sizeof(rules) - 1;
+
+    size_t i;
+    for (i = 0; i < len && __kassert_control_file_map[i] != '\0'; ++i)
+        rules[i] = __kassert_control_file_map[i];
+    rules[i] = '\0';
+
+    if (strcmp(rules, __kassert_control_file_rules) == 0)
+        return;
+
+    pthread_mutex_lock(&__kassert_control_mutex);
+
+    memcpy(__kassert_control_file_rules, rules, i + 1);
+    __kassert_control_reset_locked();
+    (void)__kassert_control_locked(__kassert_control_file_rules);
+
+    pthread_mutex_unlock(&__kassert_control_mutex);
+}
+
+static void* __kassert_control_file_thread(void* arg)
+{
+    (void)arg;
+
+    const struct timespec poll_time =
+    {
+        .tv_sec = __kassert_control_poll_ms / 1000,
+        .tv_nsec = (long)(__kassert_control_poll_ms % 1000) * 1000000L
+    };
+
+    for (;;)
+    {
+        __kassert_control_file_poll();
+        nanosleep(&poll_time, NULL);
+    }
+
+    return NULL;
+}
+
+/* Check of the watched file and its publication are done under control mutex, so only one watcher is started */
+static bool __kassert_control_file_watch_locked(const char* path, unsigned poll_ms)
+{
+    if (__kassert_control_file_map != NULL)
+        return false;
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size < CONTROL_FILE_SIZE && ftruncate(fd, CONTROL_FILE_SIZE) != 0))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, CONTROL_FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    __kassert_control_file_fd = fd;
+    __kassert_control_file_map = map;
+    __kassert_control_poll_ms = poll_ms == 0 ? CONTROL_POLL_MS_DEFAULT : poll_ms;
+
+    /* Thread should not steal signals from the program */
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    pthread_t thread;
+    const int ret = pthread_create(&thread, NULL, __kassert_control_file_thread, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (ret != 0)
+    {
+        munmap(map, CONTROL_FILE_SIZE);
+        close(fd);
+        __kassert_control_file_map = NULL;
+        __kassert_control_file_fd = -1;
+        return false;
+    }
+
+    pthread_detach(thread);
+
+    return true;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void kassert_set_level(int level)
+{
+    pthread_mutex_lock(&__kassert_control_mutex);
+    __kassert_set_level_locked(level);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+}
+
+size_t kassert_enable_file(const char* glob, bool enable)
+{
+    pthread_mutex_lock(&__kassert_control_mutex);
+    const size_t matched = __kassert_enable_file_locked(glob, enable);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    return matched;
+}
+
+bool kassert_enable_site(size_t id, bool enable)
+{
+    pthread_mutex_lock(&__kassert_control_mutex);
+    const bool ret = __kassert_enable_site_locked(id, enable);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    return ret;
+}
+
+bool kassert_site_set_rate(size_t id, unsigned int rate)
+{
+    const kassert_site_t* site = kassert_site_get(id);
+    if (site == NULL)
+        return false;
+
+    pthread_mutex_lock(&__kassert_control_mutex);
+    const bool ret = __kassert_site_set_rate(site, rate);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    return ret;
+}
+
+size_t kassert_file_set_rate(const char* glob, unsigned int rate)
+{
+    pthread_mutex_lock(&__kassert_control_mutex);
+    const size_t matched = __kassert_file_set_rate_locked(glob, rate);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    return matched;
+}
+
+bool kassert_control(const char* rules)
+{
+    pthread_mutex_lock(&__kassert_control_mutex);
+    const bool ret = __kassert_control_locked(rules);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    return ret;
+}
+
+bool kassert_control_file_watch(const char* path, unsigned poll_ms)
+{
+    pthread_mutex_lock(&__kassert_control_mutex);
+    const bool ret = __kassert_control_file_watch_locked(path, poll_ms);
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    return ret;
+}
+
+size_t kassert_sites_count(void)
+{
+    return __kassert_sites_section_count() + __atomic_load_n(&__kassert_sites_registered_count, __ATOMIC_ACQUIRE);
+}
+
+const kassert_site_t* kassert_site_get(size_t id)
+{
+    const size_t section_count = __kassert_sites_section_count();
+    if (id < section_count)
+        return &__start_kassert_sites[id];
+
+    id -= section_count;
+    if (id >= __atomic_load_n(&__kassert_sites_registered_count, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    return __kassert_sites_registered[id];
+}
+
+void kassert_sites_dump(int fd)
+{
+    kassert_report_t report;
+    __kassert_report_init(&report, fd);
+
+    for (size_t id = 0; id < kassert_sites_count(); ++id)
+    {
+        const kassert_site_t* site = kassert_site_get(id);
+
+        __kassert_report_uint(&report, id);
+        __kassert_report_char(&report, ' ');
+        __kassert_report_str(&report, __kassert_level_names[site->level]);
+        __kassert_report_str(&report, __atomic_load_n(&site->state->enabled, __ATOMIC_RELAXED) ? " on " : " off ");
+        switch (site->sample)
+        {
+            case KASSERT_SAMPLE_RATE:
+                __kassert_report_str(&report, "1/");
+                __kassert_report_uint(&report, __atomic_load_n(site->sample_rate, __ATOMIC_RELAXED));
+                __kassert_report_char(&report, ' ');
+                break;
+            case KASSERT_SAMPLE_ONCE:
+                __kassert_report_str(&report, "once ");
+                break;
+            case KASSERT_SAMPLE_ONCE_PER_THREAD:
+                __kassert_report_str(&report, "once-per-thread ");
+                break;
+            case KASSERT_SAMPLE_ALWAYS:
+            default:
+                break;
+        }
+        __kassert_report_str(&report, site->file);
+        __kassert_report_char(&report, ':');
+        __kassert_report_int(&report, site->line);
+        __kassert_report_str(&report, ": ");
+        __kassert_report_str(&report, site->func);
+        __kassert_report_str(&report, ": \'");
+        __kassert_report_str(&report, site->expr);
+        __kassert_report_str(&report, "\'\n");
+    }
+
+    __kassert_report_flush(&report);
+}
+
+const char* __kassert_level_name(KASSERT_LEVEL level)
+{
+    return __kassert_level_names[level];
+}
+
+size_t __kassert_sites_section_count(void)
+{
+    return (size_t)(__stop_kassert_sites - __start_kassert_sites);
+}
+
+size_t __kassert_site_id(const kassert_site_t* site)
+{
+    if (site >= __start_kassert_sites && site < __stop_kassert_sites)
+        return (size_t)(site - __start_kassert_sites);
+
+    /* C site of other module (dlopen) has its own section */
+    if (!site->registered)
+        return SIZE_MAX;
+
+    const size_t index = ((const kassert_site_registered_t *)site->state)->index;
+    if (index >= __atomic_load_n(&__kassert_sites_registered_count, __ATOMIC_ACQUIRE) || __kassert_sites_registered[index] != site)
+        return SIZE_MAX;
+
+    return __kassert_sites_section_count() + index;
+}
+
+bool __kassert_site_register(const kassert_site_t* site)
+{
+    kassert_site_registered_t* registered = (kassert_site_registered_t *)site->state;
+
+    pthread_mutex_lock(&__kassert_control_mutex);
+
+    /* Threads can evaluate the new site together, only the first one adds it */
+    const size_t index = __kassert_sites_registered_count;
+    if (registered->index < index && __kassert_sites_registered[registered->index] == site)
+    {
+        pthread_mutex_unlock(&__kassert_control_mutex);
+        return __atomic_load_n(&site->state->enabled, __ATOMIC_RELAXED);
+    }
+
+    /* Site out of the table still gets its compile time default */
+    __kassert_site_set(site, site->enabled_default);
+    if (index >= KASSERT_SITES_REGISTERED_MAX)
+    {
+        pthread_mutex_unlock(&__kassert_control_mutex);
+        return site->enabled_default;
+    }
+
+    registered->index = index;
+    __kassert_sites_registered[index] = site;
+    __atomic_store_n(&__kassert_sites_registered_count, index + 1, __ATOMIC_RELEASE);
+
+    /* Site evaluated before __kassert_control_init (static constructors) gets the rules from it */
+    if (__kassert_control_started)
+    {
+        __kassert_control_first = __kassert_sites_section_count() + index;
+        __kassert_control_end = __kassert_control_first + 1;
+
+        __kassert_control_reset_locked();
+        (void)__kassert_control_locked(__kassert_control_file_rules);
+
+        __kassert_control_first = 0;
+        __kassert_control_end = SIZE_MAX;
+    }
+
+    const bool enabled = __atomic_load_n(&site->state->enabled, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    __kassert_profile_site_registered(site);
+
+    return enabled;
+}
+
+void __kassert_control_init(void)
+{
+    const char* rules = getenv("KASSERT_CONTROL");
+
+    /* Sites registered before are changed here, later ones by __kassert_site_register */
+    pthread_mutex_lock(&__kassert_control_mutex);
+    if (rules != NULL)
+    {
+        strncpy(__kassert_control_env_rules, rules, sizeof(__kassert_control_env_rules) - 1);
+        (void)__kassert_control_locked(__kassert_control_env_rules);
+    }
+    __kassert_control_started = true;
+    pthread_mutex_unlock(&__kassert_control_mutex);
+
+    const char* path = getenv("KASSERT_CONTROL_FILE");
+    if (path != NULL)
+    {
+        const char* poll_ms_str = getenv("KASSERT_CONTROL_POLL_MS");
+        const unsigned long poll_ms = poll_ms_str == NULL ? 0 : strtoul(poll_ms_str, NULL, 10);
+        (void)kassert_control_file_watch(path, (unsigned)poll_ms);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef KASSERT_CRASH_RECORD_H
+#define KASSERT_CRASH_RECORD_H
+
+/*
+    This is the private header for the KAssert library sources and tools.
+    Layout of the crash-record file (see kassert-crash.h), shared by the library and kassert-decode.
+
+    File = header + records_max records. Writer takes slot records_count % records_max,
+    so the file keeps the newest records. Record is complete when seq != 0 (seq is stored last).
+    Layout is fixed for the architecture (host byte order, 64-bit fields), values are raw kassert_value_t bytes.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stdint.h>
+
+#define KASSERT_CRASH_MAGIC         "KASCRASH"
+#define KASSERT_CRASH_VERSION       1
+
+#define KASSERT_CRASH_MODULES_MAX   32
+#define KASSERT_CRASH_PATH_MAX      256
+#define KASSERT_CRASH_BUILD_ID_MAX  32
+#define KASSERT_CRASH_VALUES_MAX    3
+#define KASSERT_CRASH_VALUE_SIZE    16
+#define KASSERT_CRASH_FRAMES_MAX    64
+
+/* Which failure path wrote the record, it decides meaning of aux and values */
+typedef enum KASSERT_CRASH_KIND
+{
+    KASSERT_CRASH_KIND_ASSERT,  /* values: val1, val2 (none for KASSERT(cond)) */
+    KASSERT_CRASH_KIND_ARRAY,   /* aux: index, values: element, bound / next element, upper bound */
+    KASSERT_CRASH_KIND_MEM      /* aux: offset, values: actual byte, expected byte */
+} KASSERT_CRASH_KIND;
+
+/* Object loaded when the file was opened, runtime address = file address + bias */
+typedef struct kassert_crash_module
+{
+    uint64_t bias;
+    uint64_t start;     /* runtime range of PT_LOAD segments */
+    uint64_t end;
+    uint32_t build_id_size;
+    uint32_t reserved;
+    uint8_t  build_id[KASSERT_CRASH_BUILD_ID_MAX];
+    char     path[KASSERT_CRASH_PATH_MAX];
+} kassert_crash_module_t;
+
+typedef struct kassert_crash_header
+{
+    char                   magic[8];
+    uint32_t               version;
+    uint32_t               header_size;
+    uint32_t               record_size;
+    uint32_t               records_max;
+    uint32_t               pid;
+    uint32_t               modules_count;
+    uint64_t               records_count;   /* number of taken slots, incremented atomically */
+    kassert_crash_module_t modules[KASSERT_CRASH_MODULES_MAX];
+} kassert_crash_header_t;
+
+typedef struct kassert_crash_record
+{
+    uint64_t seq;                /* records_count after taking the slot, 0 when record is not complete */
+    uint64_t site;               /* runtime address of kassert_site_t */
+    uint64_t site_id;            /* id for kassert_site_get, UINT64_MAX when site is not in the table of sites */
+    uint64_t timestamp_ns;       /* CLOCK_REALTIME */
+    uint64_t aux;
+    uint32_t tid;
+    uint32_t kind;
+    uint32_t values_count;
+    uint32_t frames_count;
+    uint32_t types[KASSERT_CRASH_VALUES_MAX];
+    uint32_t reserved;
+    uint8_t  values[KASSERT_CRASH_VALUES_MAX][KASSERT_CRASH_VALUE_SIZE];
+    uint64_t frames[KASSERT_CRASH_FRAMES_MAX];   /* frames[0] is in the failing function */
+} kassert_crash_record_t;
+
+#endif
@@ -0,0 +1,227 @@
+/* dl_iterate_phdr */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <link.h>
+#include <sys/mman.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-elf.h"
+
+#define RECORDS_DEFAULT     16
+#define RECORDS_MAX         4096
+
+#define NSEC_PER_SEC        1000000000ULL
+
+#define PATH_SIZE           4096
+
+/* Mapped file, NULL when sink is disabled */
+static kassert_crash_header_t* __kassert_crash_header;
+static pthread_mutex_t         __kassert_crash_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int __kassert_crash_module_add(struct dl_phdr_info* info, size_t size, void* data);
+static void __kassert_crash_modules(kassert_crash_header_t* header);
+static bool __kassert_crash_file_open_locked(const char* path, unsigned int records);
+
+static int __kassert_crash_module_add(struct dl_phdr_info* info, size_t size, void* data)
+{
+    (void)size;
+
+    kassert_crash_header_t* header = data;
+    if (header->modules_count == KASSERT_CRASH_MODULES_MAX)
+        return 1;
+
+    kassert_crash_module_t* module = &header->modules[header->modules_count];
+
+    /* The first object is the executable, its name is empty */
+    if (header->modules_count == 0)
+    {
+        const ssize_t len = readlink("/proc/self/exe", module->path, sizeof(module->path) - 1);
+        module->path[len > 0 ? len : 0] = '\0';
+    }
+    else if (info->dlpi_name != NULL)
+    {
+        strncpy(module->path, info->dlpi_name, sizeof(module->path) - 1);
+    }
+
+    module->bias = info->dlpi_addr;
+    module->start = UINT64_MAX;
+
+    for (size_t i = 0; i < info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+
+        if (phdr->p_type == PT_LOAD)
+        {
+            const uint64_t start = info->dlpi_addr + phdr->p_vaddr;
+            const uint64_t end = start + phdr->p_memsz;
+
+            module->start = start < module->start ? start : module->start;
+            module->end = end > module->end ? end : module->end;
+        }
+        else if (phdr->p_type == PT_NOTE && module->build_id_size == 0)
+        {
+            const unsigned char* id;
+            size_t id_size;
+            if (__kassert_elf_notes_build_id((const void *)(info->dlpi_addr + phdr->p_vaddr), phdr->p_memsz, &id, &id_size))
+            {
+                module->build_id_size = (uint32_t)(id_size < sizeof(module->build_id) ? id_size : sizeof(module->build_id));
+                memcpy(module->build_id, id, module->build_id_size);
+            }
+        }
+    }
+
+    /* vdso has no file */
+    if (module->start != UINT64_MAX && module->path[0] == '/')
+        ++header->modules_count;
+    else
+        memset(module, 0, sizeof(*module));
+
+    return 0;
+}
+
+static void __kassert_crash_modules(kassert_crash_header_t* header)
+{
+    (void)dl_iterate_phdr(__kassert_crash_module_add, header);
+}
+
+static bool __kassert_crash_file_open_locked(const char* path, unsigned int records)
+{
+    if (__kassert_crash_header != NULL)
+        return false;
+
+    if (records == 0)
+        records = RECORDS_DEFAULT;
+    else if (records > RECORDS_MAX)
+        records = RECORDS_MAX;
+
+    const size_t size = sizeof(kassert_crash_header_t) + (size_t)records * sizeof(kassert_crash_record_t);
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    /* Blocks are allocated now, so failure path cannot get SIGBUS on full disk */
+    if (posix_fallocate(fd, 0, (off_t)size) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    kassert_crash_header_t* header = map;
+    header->version = KASSERT_CRASH_VERSION;
+    header->header_size = sizeof(kassert_crash_header_t);
+    header->record_size = sizeof(kassert_crash_record_t);
+    header->records_max = records;
+    header->pid = (uint32_t)getpid();
+    __kassert_crash_modules(header);
+
+    /* Magic is written last, decoder ignores file without it */
+    memcpy(header->magic, KASSERT_CRASH_MAGIC, sizeof(header->magic));
+
+    __atomic_store_n(&__kassert_crash_header, header, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_crash_init(void)
+{
+    const char* path = getenv("KASSERT_CRASH_FILE");
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    /* %p is replaced by PID, so processes with the same environment do not truncate records of each other */
+    char buf[PATH_SIZE];
+    size_t len = 0;
+    for (const char* c = path; *c != '\0' && len < sizeof(buf) - 1; ++c)
+    {
+        if (c[0] == '%' && c[1] == 'p')
+        {
+            const int ret = snprintf(buf + len, sizeof(buf) - len, "%d", (int)getpid());
+            len = ret > 0 && (size_t)ret < sizeof(buf) - len ? len + (size_t)ret : sizeof(buf) - 1;
+            ++c;
+        }
+        else
+            buf[len++] = *c;
+    }
+    buf[len] = '\0';
+
+    const char* records = getenv("KASSERT_CRASH_RECORDS");
+
+    (void)kassert_crash_file_open(buf, records == NULL ? 0 : (unsigned int)strtoul(records, NULL, 10));
+}
+
+void __kassert_crash_record(const kassert_site_t* site,
+                            const void* caller,
+                            KASSERT_CRASH_KIND kind,
+                            unsigned long long aux,
+                            const KASSERT_PRIMITIVES* types,
+                            const kassert_value_t* values,
+                            size_t values_count)
+{
+    kassert_crash_header_t* header = __atomic_load_n(&__kassert_crash_header, __ATOMIC_ACQUIRE);
+    if (header == NULL)
+        return;
+
+    const uint64_t seq = __atomic_add_fetch(&header->records_count, 1, __ATOMIC_RELAXED);
+    kassert_crash_record_t* records = (kassert_crash_record_t *)(header + 1);
+    kassert_crash_record_t* record = &records[(seq - 1) % header->records_max];
+
+    /* Slot can be reused, mark it incomplete first */
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    record->site = (uintptr_t)site;
+    const size_t site_id = __kassert_site_id(site);
+    record->site_id = site_id == SIZE_MAX ? UINT64_MAX : (uint64_t)site_id;
+    record->timestamp_ns = (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+    record->aux = aux;
+    record->tid = (uint32_t)kassert_gettid();
+    record->kind = (uint32_t)kind;
+
+    record->values_count = (uint32_t)(values_count < KASSERT_CRASH_VALUES_MAX ? values_count : KASSERT_CRASH_VALUES_MAX);
+    memset(record->values, 0, sizeof(record->values));
+    for (size_t i = 0; i < record->values_count; ++i)
+    {
+        record->types[i] = (uint32_t)types[i];
+        memcpy(record->values[i], &values[i], sizeof(values[i]) < KASSERT_CRASH_VALUE_SIZE ? sizeof(values[i]) : KASSERT_CRASH_VALUE_SIZE);
+    }
+
+    void* frames[KASSERT_CRASH_FRAMES_MAX];
+    record->frames_count = (uint32_t)__kassert_backtrace_from(caller, frames, KASSERT_CRASH_FRAMES_MAX);
+    for (uint32_t i = 0; i < record->frames_count; ++i)
+        record->frames[i] = (uintptr_t)frames[i];
+
+    /* Page cache keeps the record when process dies, msync is not needed */
+    __atomic_store_n(&record->seq, seq, __ATOMIC_RELEASE);
+}
+
+bool kassert_crash_file_open(const char* path, unsigned int records)
+{
+    pthread_mutex_lock(&__kassert_crash_mutex);
+
+    const bool ret = __kassert_crash_file_open_locked(path, records);
+
+    pthread_mutex_unlock(&__kassert_crash_mutex);
+
+    return ret;
+}
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+/* Minimal interval between the pairs of readings, earlier readings do not calibrate */
+#define CALIBRATION_NS          10000000ULL
+
+#define CPUID_LEAF_POWER        0x80000007U
+#define CPUID_INVARIANT_TSC     (1U << 8)
+
+bool               __kassert_clock_tsc;
+unsigned long long __kassert_clock_conv;
+
+/* The first pair of readings, taken during startup */
+static unsigned long long __kassert_clock_anchor_ticks;
+static unsigned long long __kassert_clock_anchor_ns;
+
+/* TSC is selected and not calibrated yet, claimed by the reading which calibrates */
+static bool __kassert_clock_pending;
+
+static bool __kassert_clock_tsc_invariant(void);
+static void __kassert_clock_read(unsigned long long* ticks, unsigned long long* ns);
+static void __kassert_clock_calibrate(unsigned long long ticks, unsigned long long ns);
+
+static bool __kassert_clock_tsc_invariant(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax;
+    unsigned int ebx;
+    unsigned int ecx;
+    unsigned int edx;
+
+    if (__get_cpuid(CPUID_LEAF_POWER, &eax, &ebx, &ecx, &edx) == 0)
+        return false;
+
+    return (edx & CPUID_INVARIANT_TSC) != 0;
+#else
+    return false;
+#endif
+}
+
+/* TSC is read on both sides of clock_gettime, the middle is paired with ns */
+static void __kassert_clock_read(unsigned long long* ticks, unsigned long long* ns)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    const unsigned long long before = __builtin_ia32_rdtsc();
+    *ns = __kassert_profile_now();
+    const unsigned long long after = __builtin_ia32_rdtsc();
+
+    *ticks = before + (after - before) / 2;
+#else
+    *ns = __kassert_profile_now();
+    *ticks = *ns;
+#endif
+}
+
+/* Publishes the conversion from the second pair of readings and switches kassert_now to TSC */
+static void __kassert_clock_calibrate(unsigned long long ticks, unsigned long long ns)
+{
+    ticks -= __kassert_clock_anchor_ticks;
+    ns -= __kassert_clock_anchor_ns;
+
+    /* ns << 32 cannot overflow */
+    while (ns > UINT32_MAX)
+    {
+        ns >>= 1;
+        ticks >>= 1;
+    }
+
+    if (ticks == 0 || ns == 0)
+        return;
+
+    /* Slower TSC than 1 GHz needs smaller shift, multiplier has to fit 32 bits */
+    unsigned int shift = 32;
+    while (shift > 0 && (ns << shift) / ticks > UINT32_MAX)
+        --shift;
+
+    unsigned long long mult = (ns << shift) / ticks;
+    if (mult == 0)
+        mult = 1;
+
+    __atomic_store_n(&__kassert_clock_conv, ((unsigned long long)shift << 32) | mult, __ATOMIC_RELAXED);
+    __atomic_store_n(&__kassert_clock_tsc, true, __ATOMIC_RELEASE);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_clock_init(void)
+{
+    const char* clock = getenv("KASSERT_CLOCK");
+
+    /* tsc forces TSC also when invariant bit is hidden (i.e. by hypervisor) */
+    bool tsc = __kassert_clock_tsc_invariant();
+    if (clock != NULL && strcmp(clock, "monotonic") == 0)
+        tsc = false;
+    else if (clock != NULL && strcmp(clock, "tsc") == 0)
+        tsc = true;
+
+#if !defined(__x86_64__) && !defined(__i386__)
+    tsc = false;
+#endif
+
+    if (!tsc)
+        return;
+
+    /* No thread and no spinning, the first reading 10ms after the startup calibrates */
+    __kassert_clock_read(&__kassert_clock_anchor_ticks, &__kassert_clock_anchor_ns);
+    __atomic_store_n(&__kassert_clock_pending, true, __ATOMIC_RELEASE);
+}
+
+unsigned long long __kassert_clock_now(void)
+{
+    if (!__atomic_load_n(&__kassert_clock_pending, __ATOMIC_ACQUIRE))
+        return __kassert_profile_now();
+
+    unsigned long long ticks;
+    unsigned long long ns;
+    __kassert_clock_read(&ticks, &ns);
+
+    /* One-shot, readings of other threads stay on CLOCK_MONOTONIC until the conversion is published */
+    if (ns - __kassert_clock_anchor_ns >= CALIBRATION_NS && __atomic_exchange_n(&__kassert_clock_pending, false, __ATOMIC_ACQ_REL))
+        __kassert_clock_calibrate(ticks, ns);
+
+    return ns;
+}
+
+KASSERT_CLOCK kassert_clock_get(void)
+{
+    return __atomic_load_n(&__kassert_clock_tsc, __ATOMIC_ACQUIRE) ? KASSERT_CLOCK_TSC : KASSERT_CLOCK_MONOTONIC;
+}
+
+void __kassert_deadline_fail(const kassert_site_t* site, unsigned long long elapsed_ns, unsigned long long budget_ns)
+{
+    if (site->soft)
+        __kassert_soft_record(site, elapsed_ns, budget_ns);
+    else
+        __kassert_print_and_exit(site, elapsed_ns, budget_ns);
+}
@@ -0,0 +1,1050 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "kassert-elf.h"
+
+/* DWARF line program opcodes, forms and content types used by .debug_line */
+#define DW_LNS_copy                 0x01
+#define DW_LNS_advance_pc           0x02
+#define DW_LNS_advance_line         0x03
+#define DW_LNS_set_file             0x04
+#define DW_LNS_const_add_pc         0x08
+#define DW_LNS_fixed_advance_pc     0x09
+
+#define DW_LNE_end_sequence         0x01
+#define DW_LNE_set_address          0x02
+
+#define DW_LNCT_path                0x01
+#define DW_LNCT_directory_index     0x02
+
+#define DW_FORM_data2               0x05
+#define DW_FORM_data4               0x06
+#define DW_FORM_data8               0x07
+#define DW_FORM_string              0x08
+#define DW_FORM_block               0x09
+#define DW_FORM_data1               0x0b
+#define DW_FORM_sdata               0x0d
+#define DW_FORM_strp                0x0e
+#define DW_FORM_udata               0x0f
+#define DW_FORM_data16              0x1e
+#define DW_FORM_line_strp           0x1f
+
+#define DWARF64_ESCAPE              0xffffffffULL
+
+/* Relocation which stores load bias + addend, RELA files keep the pointer only in the addend */
+#if defined(__x86_64__)
+#define ELF_R_RELATIVE              R_X86_64_RELATIVE
+#elif defined(__aarch64__)
+#define ELF_R_RELATIVE              R_AARCH64_RELATIVE
+#endif
+
+/* Bounds checked cursor over the mapped file, error is sticky */
+typedef struct kassert_elf_reader
+{
+    const unsigned char* cur;
+    const unsigned char* end;
+    bool                 error;
+} kassert_elf_reader_t;
+
+/* Header of one line program unit */
+typedef struct kassert_elf_unit
+{
+    unsigned             version;
+    unsigned             offset_size;
+    unsigned             address_size;
+    unsigned             min_inst_length;
+    int                  line_base;
+    unsigned             line_range;
+    unsigned             opcode_base;
+    const unsigned char* std_lengths;
+
+    /* Directory and file tables, v5 entries are described by formats */
+    const unsigned char* dirs;
+    size_t               dirs_count;
+    const unsigned char* dir_format;
+    size_t               dir_format_count;
+    const unsigned char* files;
+    size_t               files_count;
+    const unsigned char* file_format;
+    size_t               file_format_count;
+
+    const unsigned char* program;
+    const unsigned char* end;
+} kassert_elf_unit_t;
+
+/* Output of the line programs, pointers are NULL when rows and files are only counted */
+typedef struct kassert_elf_lines
+{
+    kassert_elf_row_t*  rows;
+    size_t              rows_count;
+    size_t              rows_max;
+    kassert_elf_file_t* files;
+    size_t              files_count;
+    size_t              files_max;
+} kassert_elf_lines_t;
+
+static const unsigned char* __kassert_elf_read_bytes(kassert_elf_reader_t* r, size_t n);
+static uint64_t __kassert_elf_read_uint(kassert_elf_reader_t* r, size_t n);
+static uint64_t __kassert_elf_read_uleb(kassert_elf_reader_t* r);
+static int64_t __kassert_elf_read_sleb(kassert_elf_reader_t* r);
+static const char* __kassert_elf_read_str(kassert_elf_reader_t* r);
+static const char* __kassert_elf_section_str(const char* section, size_t size, uint64_t offset);
+static bool __kassert_elf_read_form(const kassert_elf_t* elf, kassert_elf_reader_t* r, const kassert_elf_unit_t* unit, uint64_t form, const char** str, uint64_t* val);
+static bool __kassert_elf_read_entry(const kassert_elf_t* elf, kassert_elf_reader_t* r, const kassert_elf_unit_t* unit, const unsigned char* format, size_t format_count, const char** path, uint64_t* dir);
+static bool __kassert_elf_skip_formats(kassert_elf_reader_t* r, size_t count);
+static bool __kassert_elf_unit_parse(kassert_elf_reader_t* r, kassert_elf_unit_t* unit);
+static const char* __kassert_elf_unit_dir(const kassert_elf_t* elf, const kassert_elf_unit_t* unit, uint64_t index);
+static size_t __kassert_elf_unit_files(const kassert_elf_t* elf, const kassert_elf_unit_t* unit, kassert_elf_lines_t* lines);
+static void __kassert_elf_unit_run(const kassert_elf_unit_t* unit, size_t file_base, size_t files_count, kassert_elf_lines_t* lines);
+static void __kassert_elf_lines_run(const kassert_elf_t* elf, kassert_elf_lines_t* lines);
+static void __kassert_elf_sections(kassert_elf_t* elf);
+static bool __kassert_elf_func_valid(const ElfW(Sym)* sym);
+static int __kassert_elf_func_cmp(const void* a, const void* b);
+static int __kassert_elf_row_cmp(const void* a, const void* b);
+static void __kassert_elf_swap(unsigned char* a, unsigned char* b, size_t size);
+static void __kassert_elf_sort(void* base, size_t n, size_t size, int (*cmp)(const void*, const void*));
+static void __kassert_elf_index(kassert_elf_t* elf);
+static const ElfW(Phdr)* __kassert_elf_phdrs(const kassert_elf_t* elf, size_t* count);
+
+static const unsigned char* __kassert_elf_read_bytes(kassert_elf_reader_t* r, size_t n)
+{
+    if (r->error || (size_t)(r->end - r->cur) < n)
+    {
+        r->error = true;
+        return NULL;
+    }
+
+    const unsigned char* bytes = r->cur;
+    r->cur += n;
+
+    return bytes;
+}
+
+/* Debug info of own process, so byte order of the host */
+static uint64_t __kassert_elf_read_uint(kassert_elf_reader_t* r, size_t n)
+{
+    const unsigned char* bytes = __kassert_elf_read_bytes(r, n);
+    if (bytes == NULL || n > sizeof(uint64_t))
+        return 0;
+
+    uint64_t val = 0;
+    for (size_t i = 0; i < n; ++i)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        val |= (uint64_t)bytes[i] << (8 * i);
+#else
+        val = (val << 8) | bytes[i];
+#endif
+
+    return val;
+}
+
+static uint64_t __kassert_elf_read_uleb(kassert_elf_reader_t* r)
+{
+    uint64_t val = 0;
+    unsigned shift = 0;
+
+    for (;;)
+    {
+        const unsigned char* byte = __kassert_elf_read_bytes(r, 1);
+        if (byte == NULL)
+            return 0;
+
+        if (shift < 64)
+            val |= (uint64_t)(*byte & 0x7f) << shift;
+
+        shift += 7;
+
+        if ((*byte & 0x80) == 0)
+            return val;
+    }
+}
+
+static int64_t __kassert_elf_read_sleb(kassert_elf_reader_t* r)
+{
+    uint64_t val = 0;
+    unsigned shift = 0;
+
+    for (;;)
+    {
+        const unsigned char* byte = __kassert_elf_read_bytes(r, 1);
+        if (byte == NULL)
+            return 0;
+
+        if (shift < 64)
+            val |= (uint64_t)(*byte & 0x7f) << shift;
+
+        shift += 7;
+
+        if ((*byte & 0x80) == 0)
+        {
+            if (shift < 64 && (*byte & 0x40) != 0)
+                val |= ~0ULL << shift;
+
+            return (int64_t)val;
+        }
+    }
+}
+
+static const char* __kassert_elf_read_str(kassert_elf_reader_t* r)
+{
+    if (r->error)
+        return NULL;
+
+    const unsigned char* nul = memchr(r->cur, '\0', (size_t)(r->end - r->cur));
+    if (nul == NULL)
+    {
+        r->error = true;
+        return NULL;
+    }
+
+    const char* str = (const char *)r->cur;
+    r->cur = nul + 1;
+
+    return str;
+}
+
+/* String from string section, NULL when offset is out of section */
+static const char* __kassert_elf_section_str(const char* section, size_t size, uint64_t offset)
+{
+    if (section == NULL || offset >= size || memchr(section + offset, '\0', size - offset) == NULL)
+        return NULL;
+
+    return section + offset;
+}
+
+/* Reads attribute of directory / file entry, string forms set str, constant forms set val */
+static bool __kassert_elf_read_form(const kassert_elf_t* elf, kassert_elf_reader_t* r, const kassert_elf_unit_t* unit, uint64_t form, const char** str, uint64_t* val)
+{
+    *str = NULL;
+    *val = 0;
+
+    switch (form)
+    {
+        case DW_FORM_string:
+            *str = __kassert_elf_read_str(r);
+            break;
+        case DW_FORM_strp:
+            *str = __kassert_elf_section_str(elf->debug_str, elf->debug_str_size, __kassert_elf_read_uint(r, unit->offset_size));
+            break;
+        case DW_FORM_line_strp:
+            *str = __kassert_elf_section_str(elf->debug_line_str, elf->debug_line_str_size, __kassert_elf_read_uint(r, unit->offset_size));
+            break;
+        case DW_FORM_udata:
+            *val = __kassert_elf_read_uleb(r);
+            break;
+        case DW_FORM_sdata:
+            *val = (uint64_t)__kassert_elf_read_sleb(r);
+            break;
+        case DW_FORM_data1:
+            *val = __kassert_elf_read_uint(r, 1);
+            break;
+        case DW_FORM_data2:
+            *val = __kassert_elf_read_uint(r, 2);
+            break;
+        case DW_FORM_data4:
+            *val = __kassert_elf_read_uint(r, 4);
+            break;
+        case DW_FORM_data8:
+            *val = __kassert_elf_read_uint(r, 8);
+            break;
+        case DW_FORM_data16:
+            (void)__kassert_elf_read_bytes(r, 16);
+            break;
+        case DW_FORM_block:
+            (void)__kassert_elf_read_bytes(r, (size_t)__kassert_elf_read_uleb(r));
+            break;
+        default:
+            /* strx forms need .debug_str_offsets of the compile unit, not used by the line tables in practice */
+            r->error = true;
+            break;
+    }
+
+    return !r->error;
+}
+
+/* Reads DWARF 5 directory / file entry */
+static bool __kassert_elf_read_entry(const kassert_elf_t* elf, kassert_elf_reader_t* r, const kassert_elf_unit_t* unit, const unsigned char* format, size_t format_count, const char** path, uint64_t* dir)
+{
+    kassert_elf_reader_t fr = { .cur = format, .end = unit->end, .error = false };
+
+    *path = NULL;
+    *dir = 0;
+
+    for (size_t i = 0; i < format_count; ++i)
+    {
+        const uint64_t type = __kassert_elf_read_uleb(&fr);
+        const uint64_t form = __kassert_elf_read_uleb(&fr);
+
+        const char* str;
+        uint64_t val;
+        if (fr.error || !__kassert_elf_read_form(elf, r, unit, form, &str, &val))
+            return false;
+
+        if (type == DW_LNCT_path)
+            *path = str;
+        else if (type == DW_LNCT_directory_index)
+            *dir = val;
+    }
+
+    return true;
+}
+
+static bool __kassert_elf_skip_formats(kassert_elf_reader_t* r, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        (void)__kassert_elf_read_uleb(r);
+        (void)__kassert_elf_read_uleb(r);
+    }
+
+    return !r->error;
+}
+
+/* Parses header of the unit which starts at r->cur, r->cur is moved to the end of the unit */
+static bool __kassert_elf_unit_parse(kassert_elf_reader_t* r, kassert_elf_unit_t* unit)
+{
+    memset(unit, 0, sizeof(*unit));
+
+    uint64_t length = __kassert_elf_read_uint(r, 4);
+    unit->offset_size = 4;
+    if (length == DWARF64_ESCAPE)
+    {
+        length = __kassert_elf_read_uint(r, 8);
+        unit->offset_size = 8;
+    }
+
+    if (r->error || length > (uint64_t)(r->end - r->cur))
+    {
+        r->error = true;
+        return false;
+    }
+
+    unit->end = r->cur + length;
+
+    /* Header is read by own reader, so broken unit does not stop reading of next units */
+    kassert_elf_reader_t hr = { .cur = r->cur, .end = unit->end, .error = false };
+    r->cur = unit->end;
+
+    unit->version = (unsigned)__kassert_elf_read_uint(&hr, 2);
+    if (unit->version < 2 || unit->version > 5)
+        return false;
+
+    unit->address_size = sizeof(uintptr_t);
+    if (unit->version >= 5)
+    {
+        unit->address_size = (unsigned)__kassert_elf_read_uint(&hr, 1);
+        (void)__kassert_elf_read_uint(&hr, 1); /* segment selector size */
+    }
+
+    const uint64_t header_length = __kassert_elf_read_uint(&hr, unit->offset_size);
+    if (hr.error || header_length > (uint64_t)(unit->end - hr.cur))
+        return false;
+
+    unit->program = hr.cur + header_length;
+
+    unit->min_inst_length = (unsigned)__kassert_elf_read_uint(&hr, 1);
+    if (unit->version >= 4)
+        (void)__kassert_elf_read_uint(&hr, 1); /* maximum operations per instruction, VLIW only */
+
+    (void)__kassert_elf_read_uint(&hr, 1); /* default is_stmt */
+    unit->line_base = (int)(signed char)__kassert_elf_read_uint(&hr, 1);
+    unit->line_range = (unsigned)__kassert_elf_read_uint(&hr, 1);
+    unit->opcode_base = (unsigned)__kassert_elf_read_uint(&hr, 1);
+    unit->std_lengths = hr.cur;
+
+    if (unit->line_range == 0 || unit->opcode_base == 0)
+        return false;
+
+    (void)__kassert_elf_read_bytes(&hr, unit->opcode_base - 1);
+
+    if (unit->version >= 5)
+    {
+        unit->dir_format_count = (size_t)__kassert_elf_read_uint(&hr, 1);
+        unit->dir_format = hr.cur;
+        if (!__kassert_elf_skip_formats(&hr, unit->dir_format_count))
+            return false;
+
+        unit->dirs_count = (size_t)__kassert_elf_read_uleb(&hr);
+        unit->dirs = hr.cur;
+
+        /* Directories are skipped by file formats reader later */
+        return !hr.error;
+    }
+
+    unit->dirs = hr.cur;
+    while (!hr.error && *hr.cur != '\0')
+    {
+        (void)__kassert_elf_read_str(&hr);
+        ++unit->dirs_count;
+    }
+
+    (void)__kassert_elf_read_bytes(&hr, 1);
+    unit->files = hr.cur;
+
+    return !hr.error;
+}
+
+/* Directory with index, NULL when unknown. Index 0 is the compilation directory in v5 and current directory before */
+static const char* __kassert_elf_unit_dir(const kassert_elf_t* elf, const kassert_elf_unit_t* unit, uint64_t index)
+{
+    kassert_elf_reader_t r = { .cur = unit->dirs, .end = unit->end, .error = false };
+
+    if (unit->version >= 5)
+    {
+        if (index >= unit->dirs_count)
+            return NULL;
+
+        const char* path = NULL;
+        uint64_t dir;
+        for (uint64_t i = 0; i <= index; ++i)
+            if (!__kassert_elf_read_entry(elf, &r, unit, unit->dir_format, unit->dir_format_count, &path, &dir))
+                return NULL;
+
+        return path;
+    }
+
+    if (index == 0 || index > unit->dirs_count)
+        return NULL;
+
+    const char* path = NULL;
+    for (uint64_t i = 0; i < index; ++i)
+        path = __kassert_elf_read_str(&r);
+
+    return path;
+}
+
+/* Appends files of the unit to lines (or only counts them), returns number of files of the unit */
+static size_t __kassert_elf_unit_files(const kassert_elf_t* elf, const kassert_elf_unit_t* unit, kassert_elf_lines_t* lines)
+{
+    kassert_elf_reader_t r = { .cur = unit->dirs, .end = unit->program, .error = false };
+    size_t count = 0;
+
+    if (unit->version >= 5)
+    {
+        /* Skip directories to the file formats */
+        const char* path;
+        uint64_t dir;
+        for (size_t i = 0; i < unit->dirs_count; ++i)
+            if (!__kassert_elf_read_entry(elf, &r, unit, unit->dir_format, unit->dir_format_count, &path, &dir))
+                return 0;
+
+        const size_t format_count = (size_t)__kassert_elf_read_uint(&r, 1);
+        const unsigned char* format = r.cur;
+        if (!__kassert_elf_skip_formats(&r, format_count))
+            return 0;
+
+        const size_t files_count = (size_t)__kassert_elf_read_uleb(&r);
+        for (size_t i = 0; i < files_count; ++i)
+        {
+            if (!__kassert_elf_read_entry(elf, &r, unit, format, format_count, &path, &dir))
+                break;
+
+            if (lines->files != NULL && lines->files_count < lines->files_max)
+                lines->files[lines->files_count] = (kassert_elf_file_t){ .dir = __kassert_elf_unit_dir(elf, unit, dir), .name = path };
+
+            ++lines->files_count;
+            ++count;
+        }
+
+        return count;
+    }
+
+    r.cur = unit->files;
+    while (!r.error && r.cur < r.end && *r.cur != '\0')
+    {
+        const char* path = __kassert_elf_read_str(&r);
+        const uint64_t dir = __kassert_elf_read_uleb(&r);
+        (void)__kassert_elf_read_uleb(&r); /* modification time */
+        (void)__kassert_elf_read_uleb(&r); /* file size */
+
+        if (r.error)
+            break;
+
+        if (lines->files != NULL && lines->files_count < lines->files_max)
+            lines->files[lines->files_count] = (kassert_elf_file_t){ .dir = __kassert_elf_unit_dir(elf, unit, dir), .name = path };
+
+        ++lines->files_count;
+        ++count;
+    }
+
+    return count;
+}
+
+/* Runs line program of the unit, appends rows (or only counts them) */
+static void __kassert_elf_unit_run(const kassert_elf_unit_t* unit, size_t file_base, size_t files_count, kassert_elf_lines_t* lines)
+{
+    kassert_elf_reader_t r = { .cur = unit->program, .end = unit->end, .error = false };
+
+    /* Files are numbered from 1 before DWARF 5 */
+    const uint64_t file_first = unit->version >= 5 ? 0 : 1;
+
+    uintptr_t addr = 0;
+    uint64_t file = 1;
+    int64_t line = 1;
+
+    /* Sequences of discarded functions start at 0 (or at -1 / -2 tombstones of lld) */
+    bool discarded = false;
+
+    /* The first row of the current sequence */
+    size_t sequence_first = lines->rows_count;
+
+#define ELF_EMIT_ROW(row_line) \
+    do { \
+        if (discarded) \
+            break; \
+        if (lines->rows != NULL && lines->rows_count < lines->rows_max) \
+            lines->rows[lines->rows_count] = (kassert_elf_row_t) \
+            { \
+                .addr = addr, \
+                .file = file >= file_first && file - file_first < files_count ? (uint32_t)(file_base + file - file_first) : UINT32_MAX, \
+                .line = (uint32_t)(row_line) \
+            }; \
+        ++lines->rows_count; \
+    } while (0)
+
+    while (!r.error && r.cur < r.end)
+    {
+        const unsigned opcode = (unsigned)__kassert_elf_read_uint(&r, 1);
+
+        if (opcode >= unit->opcode_base)
+        {
+            const unsigned adjusted = opcode - unit->opcode_base;
+            addr += (uintptr_t)(adjusted / unit->line_range) * unit->min_inst_length;
+            line += unit->line_base + (int)(adjusted % unit->line_range);
+            ELF_EMIT_ROW(line > 0 ? line : 1);
+            continue;
+        }
+
+        switch (opcode)
+        {
+            case 0:
+            {
+                const uint64_t len = __kassert_elf_read_uleb(&r);
+                const unsigned char* next = __kassert_elf_read_bytes(&r, (size_t)len);
+                if (next == NULL || len == 0)
+                    break;
+
+                kassert_elf_reader_t er = { .cur = next, .end = next + len, .error = false };
+                const unsigned sub = (unsigned)__kassert_elf_read_uint(&er, 1);
+
+                if (sub == DW_LNE_end_sequence)
+                {
+                    /* Row at the end address covers nothing (gcc emits it for .cold parts), after sort it would hide the end */
+                    if (!discarded && lines->rows != NULL && lines->rows_count > sequence_first &&
+                        lines->rows_count <= lines->rows_max && lines->rows[lines->rows_count - 1].addr == addr)
+                        --lines->rows_count;
+
+                    /* Row with line 0 closes the sequence */
+                    ELF_EMIT_ROW(0);
+                    addr = 0;
+                    file = 1;
+                    line = 1;
+                    discarded = false;
+                    sequence_first = lines->rows_count;
+                }
+                else if (sub == DW_LNE_set_address)
+                {
+                    addr = (uintptr_t)__kassert_elf_read_uint(&er, (size_t)(len - 1));
+                    discarded = addr == 0 || addr >= UINTPTR_MAX - 1;
+                }
+
+                break;
+            }
+            case DW_LNS_copy:
+                ELF_EMIT_ROW(line > 0 ? line : 1);
+                break;
+            case DW_LNS_advance_pc:
+                addr += (uintptr_t)__kassert_elf_read_uleb(&r) * unit->min_inst_length;
+                break;
+            case DW_LNS_advance_line:
+                line += __kassert_elf_read_sleb(&r);
+                break;
+            case DW_LNS_set_file:
+                file = __kassert_elf_read_uleb(&r);
+                break;
+            case DW_LNS_const_add_pc:
+                addr += (uintptr_t)((255 - unit->opcode_base) / unit->line_range) * unit->min_inst_length;
+                break;
+            case DW_LNS_fixed_advance_pc:
+                addr += (uintptr_t)__kassert_elf_read_uint(&r, 2);
+                break;
+            default:
+                /* Other standard opcodes only change flags, skip their ULEB arguments */
+                for (unsigned i = 0; i < unit->std_lengths[opcode - 1]; ++i)
+                    (void)__kassert_elf_read_uleb(&r);
+                break;
+        }
+    }
+
+#undef ELF_EMIT_ROW
+}
+
+static void __kassert_elf_lines_run(const kassert_elf_t* elf, kassert_elf_lines_t* lines)
+{
+    kassert_elf_reader_t r = { .cur = elf->debug_line, .end = elf->debug_line + elf->debug_line_size, .error = false };
+
+    while (!r.error && r.cur < r.end)
+    {
+        kassert_elf_unit_t unit;
+        if (!__kassert_elf_unit_parse(&r, &unit))
+            continue;
+
+        const size_t file_base = lines->files_count;
+        const size_t files_count = __kassert_elf_unit_files(elf, &unit, lines);
+
+        __kassert_elf_unit_run(&unit, file_base, files_count, lines);
+    }
+}
+
+static void __kassert_elf_sections(kassert_elf_t* elf)
+{
+    const ElfW(Ehdr)* ehdr = (const ElfW(Ehdr) *)elf->map;
+
+    if (ehdr->e_shoff == 0 || ehdr->e_shentsize != sizeof(ElfW(Shdr)) ||
+        ehdr->e_shoff > elf->map_size || (elf->map_size - ehdr->e_shoff) / sizeof(ElfW(Shdr)) < ehdr->e_shnum ||
+        ehdr->e_shstrndx >= ehdr->e_shnum)
+        return;
+
+    const ElfW(Shdr)* shdrs = (const ElfW(Shdr) *)(elf->map + ehdr->e_shoff);
+    const ElfW(Shdr)* shstr = &shdrs[ehdr->e_shstrndx];
+    if (shstr->sh_offset > elf->map_size || shstr->sh_size > elf->map_size - shstr->sh_offset)
+        return;
+
+    const char* names = (const char *)elf->map + shstr->sh_offset;
+    const ElfW(Shdr)* dynsym = NULL;
+
+    for (size_t i = 0; i < ehdr->e_shnum; ++i)
+    {
+        const ElfW(Shdr)* shdr = &shdrs[i];
+
+        /* Compressed sections would need zlib and a copy */
+        if (shdr->sh_type == SHT_NOBITS || (shdr->sh_flags & SHF_COMPRESSED) != 0 ||
+            shdr->sh_offset > elf->map_size || shdr->sh_size > elf->map_size - shdr->sh_offset)
+            continue;
+
+        const char* name = __kassert_elf_section_str(names, shstr->sh_size, shdr->sh_name);
+        if (name == NULL)
+            continue;
+
+        const unsigned char* data = elf->map + shdr->sh_offset;
+
+        if (shdr->sh_type == SHT_SYMTAB)
+        {
+            elf->symtab = (const ElfW(Sym) *)data;
+            elf->symtab_count = shdr->sh_size / sizeof(ElfW(Sym));
+
+            if (shdr->sh_link < ehdr->e_shnum)
+            {
+                const ElfW(Shdr)* str = &shdrs[shdr->sh_link];
+                if (str->sh_offset <= elf->map_size && str->sh_size <= elf->map_size - str->sh_offset)
+                {
+                    elf->strtab = (const char *)elf->map + str->sh_offset;
+                    elf->strtab_size = str->sh_size;
+                }
+            }
+        }
+        else if (shdr->sh_type == SHT_DYNSYM)
+            dynsym = shdr;
+        else if (strcmp(name, ".debug_line") == 0)
+        {
+            elf->debug_line = data;
+            elf->debug_line_size = shdr->sh_size;
+        }
+        else if (strcmp(name, ".debug_str") == 0)
+        {
+            elf->debug_str = (const char *)data;
+            elf->debug_str_size = shdr->sh_size;
+        }
+        else if (strcmp(name, ".debug_line_str") == 0)
+        {
+            elf->debug_line_str = (const char *)data;
+            elf->debug_line_str_size = shdr->sh_size;
+        }
+    }
+
+    /* Stripped file has only dynamic symbols */
+    if (elf->symtab == NULL && dynsym != NULL && dynsym->sh_link < ehdr->e_shnum)
+    {
+        const ElfW(Shdr)* str = &shdrs[dynsym->sh_link];
+        if (str->sh_offset <= elf->map_size && str->sh_size <= elf->map_size - str->sh_offset)
+        {
+            elf->symtab = (const ElfW(Sym) *)(elf->map + dynsym->sh_offset);
+            elf->symtab_count = dynsym->sh_size / sizeof(ElfW(Sym));
+            elf->strtab = (const char *)elf->map + str->sh_offset;
+            elf->strtab_size = str->sh_size;
+        }
+    }
+}
+
+static bool __kassert_elf_func_valid(const ElfW(Sym)* sym)
+{
+    const unsigned type = ELF64_ST_TYPE(sym->st_info);
+
+    return (type == STT_FUNC || type == STT_GNU_IFUNC) && sym->st_shndx != SHN_UNDEF && sym->st_value != 0;
+}
+
+static int __kassert_elf_func_cmp(const void* a, const void* b)
+{
+    const kassert_elf_func_t* fa = a;
+    const kassert_elf_func_t* fb = b;
+
+    return (fa->addr > fb->addr) - (fa->addr < fb->addr);
+}
+
+/* End of sequence before the row starting the next sequence at the same address */
+static int __kassert_elf_row_cmp(const void* a, const void* b)
+{
+    const kassert_elf_row_t* ra = a;
+    const kassert_elf_row_t* rb = b;
+
+    if (ra->addr != rb->addr)
+        return ra->addr > rb->addr ? 1 : -1;
+
+    return (ra->line != 0) - (rb->line != 0);
+}
+
+static void __kassert_elf_swap(unsigned char* a, unsigned char* b, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        const unsigned char t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+
+/* Heap sort, qsort can allocate memory and we can be in signal handler */
+static void __kassert_elf_sort(void* base, size_t n, size_t size, int (*cmp)(const void*, const void*))
+{
+    unsigned char* array = base;
+
+    for (size_t end = n, start = n / 2; end > 1;)
+    {
+        if (start > 0)
+            --start;
+        else
+        {
+            --end;
+            __kassert_elf_swap(array, array + end * size, size);
+        }
+
+        /* Sift down from start in [0, end) */
+        size_t root = start;
+        for (size_t child = 2 * root + 1; child < end; child = 2 * root + 1)
+        {
+            if (child + 1 < end && cmp(array + child * size, array + (child + 1) * size) < 0)
+                ++child;
+
+            if (cmp(array + root * size, array + child * size) >= 0)
+                break;
+
+            __kassert_elf_swap(array + root * size, array + child * size, size);
+            root = child;
+        }
+    }
+}
+
+/* Builds sorted indexes in one anonymous mapping. Counts first, then fills */
+static void __kassert_elf_index(kassert_elf_t* elf)
+{
+    elf->indexed = true;
+
+    size_t funcs_count = 0;
+    for (size_t i = 0; i < elf->symtab_count; ++i)
+        if (__kassert_elf_func_valid(&elf->symtab[i]))
+            ++funcs_count;
+
+    kassert_elf_lines_t lines = { 0 };
+    __kassert_elf_lines_run(elf, &lines);
+
+    const size_t size = funcs_count * sizeof(kassert_elf_func_t) +
+                        lines.rows_count * sizeof(kassert_elf_row_t) +
+                        lines.files_count * sizeof(kassert_elf_file_t);
+    if (size == 0)
+        return;
+
+    void* index = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (index == MAP_FAILED)
+        return;
+
+    elf->index = index;
+    elf->index_size = size;
+
+    elf->funcs = index;
+    elf->rows = (kassert_elf_row_t *)(elf->funcs + funcs_count);
+    elf->files = (kassert_elf_file_t *)(elf->rows + lines.rows_count);
+
+    for (size_t i = 0; i < elf->symtab_count; ++i)
+    {
+        const ElfW(Sym)* sym = &elf->symtab[i];
+        if (!__kassert_elf_func_valid(sym))
+            continue;
+
+        elf->funcs[elf->funcs_count++] = (kassert_elf_func_t)
+        {
+            .addr = (uintptr_t)sym->st_value,
+            .size = (uintptr_t)sym->st_size,
+            .name = __kassert_elf_section_str(elf->strtab, elf->strtab_size, sym->st_name)
+        };
+    }
+
+    /* The same programs again, now rows and files are stored */
+    kassert_elf_lines_t store =
+    {
+        .rows = elf->rows,
+        .rows_max = lines.rows_count,
+        .files = elf->files,
+        .files_max = lines.files_count
+    };
+    __kassert_elf_lines_run(elf, &store);
+
+    elf->rows_count = store.rows_count < lines.rows_count ? store.rows_count : lines.rows_count;
+    elf->files_count = store.files_count < lines.files_count ? store.files_count : lines.files_count;
+
+    __kassert_elf_sort(elf->funcs, elf->funcs_count, sizeof(elf->funcs[0]), __kassert_elf_func_cmp);
+    __kassert_elf_sort(elf->rows, elf->rows_count, sizeof(elf->rows[0]), __kassert_elf_row_cmp);
+}
+
+/* Program headers were validated by open */
+static const ElfW(Phdr)* __kassert_elf_phdrs(const kassert_elf_t* elf, size_t* count)
+{
+    const ElfW(Ehdr)* ehdr = (const ElfW(Ehdr) *)elf->map;
+    *count = ehdr->e_phnum;
+
+    return (const ElfW(Phdr) *)(elf->map + ehdr->e_phoff);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+bool __kassert_elf_open(kassert_elf_t* elf, const char* path)
+{
+    memset(elf, 0, sizeof(*elf));
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ElfW(Ehdr)))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    elf->map = map;
+    elf->map_size = (size_t)st.st_size;
+
+    const ElfW(Ehdr)* ehdr = map;
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != (sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32) ||
+        ehdr->e_phentsize != sizeof(ElfW(Phdr)) ||
+        ehdr->e_phoff > elf->map_size ||
+        (elf->map_size - ehdr->e_phoff) / sizeof(ElfW(Phdr)) < ehdr->e_phnum)
+    {
+        __kassert_elf_close(elf);
+        return false;
+    }
+
+    const ElfW(Phdr)* phdrs = (const ElfW(Phdr) *)(elf->map + ehdr->e_phoff);
+    for (size_t i = 0; i < ehdr->e_phnum; ++i)
+        if (phdrs[i].p_type == PT_LOAD)
+        {
+            elf->load_vaddr = (uintptr_t)(phdrs[i].p_vaddr - phdrs[i].p_offset);
+            break;
+        }
+
+    __kassert_elf_sections(elf);
+
+    return true;
+}
+
+void __kassert_elf_close(kassert_elf_t* elf)
+{
+    if (elf->index != NULL)
+        munmap(elf->index, elf->index_size);
+
+    if (elf->map != NULL)
+        munmap((void *)elf->map, elf->map_size);
+
+    memset(elf, 0, sizeof(*elf));
+}
+
+bool __kassert_elf_lookup(kassert_elf_t* elf, uintptr_t addr, kassert_elf_symbol_t* sym)
+{
+    memset(sym, 0, sizeof(*sym));
+
+    if (!elf->indexed)
+        __kassert_elf_index(elf);
+
+    /* Last function which starts at or before addr */
+    size_t lo = 0;
+    size_t hi = elf->funcs_count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (elf->funcs[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo > 0)
+    {
+        const kassert_elf_func_t* func = &elf->funcs[lo - 1];
+        if (func->size == 0 || addr - func->addr < func->size)
+        {
+            sym->func = func->name;
+            sym->func_offset = addr - func->addr;
+        }
+    }
+
+    /* Last row at or before addr, row with line 0 means addr is between sequences */
+    lo = 0;
+    hi = elf->rows_count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (elf->rows[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo > 0 && elf->rows[lo - 1].line != 0)
+    {
+        const kassert_elf_row_t* row = &elf->rows[lo - 1];
+        sym->line = row->line;
+
+        if (row->file < elf->files_count)
+        {
+            sym->dir = elf->files[row->file].dir;
+            sym->file = elf->files[row->file].name;
+        }
+    }
+
+    return sym->func != NULL || sym->line != 0;
+}
+
+bool __kassert_elf_notes_build_id(const void* notes, size_t size, const unsigned char** id, size_t* id_size)
+{
+    const unsigned char* note = notes;
+    const unsigned char* const end = note + size;
+
+    /* Name and descriptor are padded to 4 bytes */
+    while ((size_t)(end - note) >= sizeof(ElfW(Nhdr)))
+    {
+        const ElfW(Nhdr)* nhdr = (const ElfW(Nhdr) *)note;
+        const size_t name_size = (nhdr->n_namesz + 3U) & ~(size_t)3;
+        const size_t desc_size = (nhdr->n_descsz + 3U) & ~(size_t)3;
+
+        note += sizeof(*nhdr);
+        if ((size_t)(end - note) < name_size || (size_t)(end - note) - name_size < desc_size)
+            return false;
+
+        if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == sizeof(ELF_NOTE_GNU) && memcmp(note, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0)
+        {
+            *id = note + name_size;
+            *id_size = nhdr->n_descsz;
+            return true;
+        }
+
+        note += name_size + desc_size;
+    }
+
+    return false;
+}
+
+bool __kassert_elf_build_id(const kassert_elf_t* elf, const unsigned char** id, size_t* id_size)
+{
+    size_t count;
+    const ElfW(Phdr)* phdrs = __kassert_elf_phdrs(elf, &count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (phdrs[i].p_type != PT_NOTE || phdrs[i].p_offset > elf->map_size || phdrs[i].p_filesz > elf->map_size - phdrs[i].p_offset)
+            continue;
+
+        if (__kassert_elf_notes_build_id(elf->map + phdrs[i].p_offset, phdrs[i].p_filesz, id, id_size))
+            return true;
+    }
+
+    return false;
+}
+
+const void* __kassert_elf_vaddr(const kassert_elf_t* elf, uintptr_t vaddr, size_t size)
+{
+    size_t count;
+    const ElfW(Phdr)* phdrs = __kassert_elf_phdrs(elf, &count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ElfW(Phdr)* phdr = &phdrs[i];
+        if (phdr->p_type != PT_LOAD || vaddr < phdr->p_vaddr || vaddr - phdr->p_vaddr >= phdr->p_filesz)
+            continue;
+
+        const uintptr_t offset = vaddr - phdr->p_vaddr;
+        if (size > phdr->p_filesz - offset || phdr->p_offset + offset > elf->map_size || size > elf->map_size - (phdr->p_offset + offset))
+            return NULL;
+
+        return elf->map + phdr->p_offset + offset;
+    }
+
+    return NULL;
+}
+
+const char* __kassert_elf_vaddr_str(const kassert_elf_t* elf, uintptr_t vaddr)
+{
+    const char* str = __kassert_elf_vaddr(elf, vaddr, 1);
+    if (str == NULL)
+        return NULL;
+
+    /* String ends in the same segment */
+    const size_t max = elf->map_size - (size_t)((const unsigned char *)str - elf->map);
+
+    return memchr(str, '\0', max) != NULL ? str : NULL;
+}
+
+bool __kassert_elf_vaddr_ptr(const kassert_elf_t* elf, uintptr_t vaddr, uintptr_t* ptr)
+{
+    const void* raw = __kassert_elf_vaddr(elf, vaddr, sizeof(*ptr));
+    if (raw == NULL)
+        return false;
+
+    memcpy(ptr, raw, sizeof(*ptr));
+
+#ifdef ELF_R_RELATIVE
+    const ElfW(Ehdr)* ehdr = (const ElfW(Ehdr) *)elf->map;
+    if (ehdr->e_shoff == 0 || ehdr->e_shentsize != sizeof(ElfW(Shdr)) ||
+        ehdr->e_shoff > elf->map_size || (elf->map_size - ehdr->e_shoff) / sizeof(ElfW(Shdr)) < ehdr->e_shnum)
+        return true;
+
+    const ElfW(Shdr)* shdrs = (const ElfW(Shdr) *)(elf->map + ehdr->e_shoff);
+    for (size_t i = 0; i < ehdr->e_shnum; ++i)
+    {
+        const ElfW(Shdr)* shdr = &shdrs[i];
+        if (shdr->sh_type != SHT_RELA || shdr->sh_offset > elf->map_size || shdr->sh_size > elf->map_size - shdr->sh_offset)
+            continue;
+
+        const ElfW(Rela)* relas = (const ElfW(Rela) *)(elf->map + shdr->sh_offset);
+        const size_t relas_count = shdr->sh_size / sizeof(ElfW(Rela));
+
+        for (size_t j = 0; j < relas_count; ++j)
+            if (relas[j].r_offset == vaddr && ELF64_R_TYPE(relas[j].r_info) == ELF_R_RELATIVE)
+            {
+                *ptr = (uintptr_t)relas[j].r_addend;
+                return true;
+            }
+    }
+#endif
+
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef KASSERT_ELF_H
+#define KASSERT_ELF_H
+
+/*
+    This is the private header for the KAssert library sources.
+    Reader of ELF files for the symbolizer: function names from .symtab (or .dynsym)
+    and file:line from DWARF .debug_line (versions 2 - 5).
+
+    File is mmaped and never copied, all names point into the mapping.
+    Sorted indexes of functions and line rows are built on the first lookup
+    in one anonymous mapping, so lookups do not use heap. Async-signal-safe.
+
+    Compressed debug sections and separate debug files (.gnu_debuglink) are not supported.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <link.h>
+
+typedef struct kassert_elf_func
+{
+    uintptr_t   addr;
+    uintptr_t   size;
+    const char* name;
+} kassert_elf_func_t;
+
+/* Row of the line table, line 0 marks end of the sequence (address out of any sequence) */
+typedef struct kassert_elf_row
+{
+    uintptr_t addr;
+    uint32_t  file;
+    uint32_t  line;
+} kassert_elf_row_t;
+
+typedef struct kassert_elf_file
+{
+    const char* dir;    /* NULL when unknown */
+    const char* name;
+} kassert_elf_file_t;
+
+typedef struct kassert_elf
+{
+    const unsigned char* map;
+    size_t               map_size;
+
+    /* p_vaddr - p_offset of the first PT_LOAD, so load bias = address of file offset 0 - load_vaddr */
+    uintptr_t            load_vaddr;
+
+    const ElfW(Sym)*     symtab;
+    size_t               symtab_count;
+    const char*          strtab;
+    size_t               strtab_size;
+
+    const unsigned char* debug_line;
+    size_t               debug_line_size;
+    const char*          debug_str;
+    size_t               debug_str_size;
+    const char*          debug_line_str;
+    size_t               debug_line_str_size;
+
+    /* Indexes, built by the first lookup */
+    bool                 indexed;
+    void*                index;
+    size_t               index_size;
+    kassert_elf_func_t*  funcs;
+    size_t               funcs_count;
+    kassert_elf_row_t*   rows;
+    size_t               rows_count;
+    kassert_elf_file_t*  files;
+    size_t               files_count;
+} kassert_elf_t;
+
+/* Result of the lookup, fields are NULL / 0 when unknown */
+typedef struct kassert_elf_symbol
+{
+    const char* func;
+    uintptr_t   func_offset;
+    const char* dir;
+    const char* file;
+    unsigned    line;
+} kassert_elf_symbol_t;
+
+/* Maps ELF file. Returns false when file cannot be mapped or it is not ELF of this architecture */
+bool __kassert_elf_open(kassert_elf_t* elf, const char* path);
+
+/* Unmaps file and indexes */
+void __kassert_elf_close(kassert_elf_t* elf);
+
+/* Looks up address from the file address space (runtime address - load bias). Returns false when nothing is found */
+bool __kassert_elf_lookup(kassert_elf_t* elf, uintptr_t addr, kassert_elf_symbol_t* sym);
+
+/* Finds GNU build-id in notes (PT_NOTE segment in memory or in file). Returns false when there is no build-id */
+bool __kassert_elf_notes_build_id(const void* notes, size_t size, const unsigned char** id, size_t* id_size);
+
+/* Build-id of the file */
+bool __kassert_elf_build_id(const kassert_elf_t* elf, const unsigned char** id, size_t* id_size);
+
+/* Bytes of the file loaded at vaddr (file address space), NULL when [vaddr, vaddr + size) is not in the file */
+const void* __kassert_elf_vaddr(const kassert_elf_t* elf, uintptr_t vaddr, size_t size);
+
+/* String at vaddr, NULL when it is not in the file */
+const char* __kassert_elf_vaddr_str(const kassert_elf_t* elf, uintptr_t vaddr);
+
+/*
+    Pointer stored at vaddr as it would be after loading with bias 0.
+    Position independent files keep 0 in the file and the value in the addend of R_*_RELATIVE relocation.
+*/
+bool __kassert_elf_vaddr_ptr(const kassert_elf_t* elf, uintptr_t vaddr, uintptr_t* ptr);
+
+#endif
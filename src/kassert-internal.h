@@ -0,0 +1,105 @@
+#ifndef KASSERT_INTERNAL_H
+#define KASSERT_INTERNAL_H
+
+/*
+    This is the private header for the KAssert library sources.
+    Entry points of the library modules, called during library initialization.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stddef.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-report.h"
+#include "kassert-crash-record.h"
+
+/* Reads KASSERT_UNWINDER, pre-warms backtrace (dlopen of libgcc_s) */
+void __kassert_stack_init(void);
+
+/*
+    Like kassert_backtrace, but the first frame is caller (__builtin_return_address of the entry point of the library),
+    so frames of the library are dropped. Whole stack is returned when caller is not found. Async-signal-safe
+*/
+size_t __kassert_backtrace_from(const void* caller, void** frames, size_t max);
+
+/* Reads KASSERT_CLOCK, detects invariant TSC and takes the first pair of calibration readings */
+void __kassert_clock_init(void);
+
+/* When there is a profiled site: calibrates the profiler, reads KASSERT_PROFILE_* and registers dump at exit */
+void __kassert_profile_init(void);
+
+/* Parses KASSERT_CONTROL and KASSERT_CONTROL_FILE environment variables */
+void __kassert_control_init(void);
+
+/* Max number of registered sites (C++ sites), sites registered after the limit are out of the table */
+#define KASSERT_SITES_REGISTERED_MAX 16384
+
+/* Number of sites in KASSERT_SITE_SECTION, registered sites have ids from this number */
+size_t __kassert_sites_section_count(void);
+
+/* Id of the site for kassert_site_get or SIZE_MAX when site is not in the table. Async-signal-safe, lock free */
+size_t __kassert_site_id(const kassert_site_t* site);
+
+/* Starts the profiler when registered site is profiled and __kassert_profile_init has already run */
+void __kassert_profile_site_registered(const kassert_site_t* site);
+
+/* Opens crash-record file from KASSERT_CRASH_FILE environment variable */
+void __kassert_crash_init(void);
+
+/* Writes crash record when the file is opened, stack starts at caller. Async-signal-safe, only memory stores and backtrace */
+void __kassert_crash_record(const kassert_site_t* site,
+                            const void* caller,
+                            KASSERT_CRASH_KIND kind,
+                            unsigned long long aux,
+                            const KASSERT_PRIMITIVES* types,
+                            const kassert_value_t* values,
+                            size_t values_count);
+
+/* Reads KASSERT_ALL_THREADS* environment variables */
+void __kassert_threads_init(void);
+
+/* The first failing thread returns, other threads block until the process exits. Async-signal-safe */
+void __kassert_failure_elect(void);
+
+/* Prints stacks of other threads when all-threads mode is enabled. Async-signal-safe */
+void __kassert_threads_dump(kassert_report_t* report);
+
+/* Prints context ring of the calling thread, newest entry first. Async-signal-safe */
+void __kassert_context_dump(kassert_report_t* report);
+
+/* Registers pthread_atfork handler which clears cached ThreadID in the child */
+void __kassert_owner_init(void);
+
+/* Ends no-allocation regions of the calling thread, so failure path and exit handlers can allocate */
+void __kassert_noalloc_disable(void);
+
+/* Reads KASSERT_FAILURE_POLICY environment variable */
+void __kassert_policy_init(void);
+
+/* Forks for FORK_ABORT policy, parent exits. Returns true in the child, false when policy is different or fork failed */
+bool __kassert_policy_fork(kassert_report_t* report);
+
+/* Ends the process by the failure policy. Report has to be flushed */
+void __attribute__ (( noreturn )) __kassert_policy_terminate(void);
+
+/* Name of the level used by control rules, i.e. "normal" */
+const char* __kassert_level_name(KASSERT_LEVEL level);
+
+/* SIMD extensions used by kernels of array and memory assertions */
+typedef enum KASSERT_ISA
+{
+    KASSERT_ISA_SCALAR,
+    KASSERT_ISA_SSE2,
+    KASSERT_ISA_AVX2,
+    KASSERT_ISA_AVX512,
+    KASSERT_ISA_COUNT
+} KASSERT_ISA;
+
+/* Best ISA supported by the CPU, KASSERT_ARRAY_ISA environment variable can only lower it */
+KASSERT_ISA __kassert_isa(void);
+
+#endif
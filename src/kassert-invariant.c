@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sched.h>
+
+#include <kassert/kassert.h>
+
+#define INTERVAL_MS_DEFAULT     10
+
+/* check_all gives up a checker after so many refusals of the lock hook in a row */
+#define CHECK_ALL_LOCK_RETRIES  1000
+
+#define NSEC_PER_SEC            1000000000ULL
+#define NSEC_PER_USEC           1000ULL
+
+struct kassert_invariant
+{
+    struct kassert_invariant* next;
+
+    const kassert_site_t*     site;
+    kassert_invariant_fn_t    fn;
+    void*                     obj;
+    kassert_invariant_hooks_t hooks;
+    unsigned long long        budget_ns;
+
+    /* Resumable pass of the KAssert thread */
+    kassert_invariant_ctx_t   ctx;
+    unsigned long long        epoch;
+
+    /* Guarded by __kassert_invariant_mutex */
+    unsigned long long        passes;
+};
+
+/* Registered checkers, next is the next one in round-robin order (NULL means head) */
+static kassert_invariant_t* __kassert_invariant_head;
+static kassert_invariant_t* __kassert_invariant_next;
+
+/*
+    Checker which is called now (by KAssert thread or check_all), only one at a time.
+    Unregister waits until its checker is not running, so object can be freed after it.
+*/
+static kassert_invariant_t* __kassert_invariant_running;
+
+static pthread_mutex_t __kassert_invariant_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __kassert_invariant_cond = PTHREAD_COND_INITIALIZER;
+static bool            __kassert_invariant_check_all_active;
+static bool            __kassert_invariant_thread_started;
+
+static unsigned long long __kassert_invariant_now_ns(void);
+static KASSERT_INVARIANT_RESULT __kassert_invariant_call(kassert_invariant_t* inv, kassert_invariant_ctx_t* ctx, unsigned long long* epoch, bool* skipped);
+static bool __kassert_invariant_step(void);
+static void* __kassert_invariant_thread(void* arg);
+static bool __kassert_invariant_thread_start(void);
+
+static unsigned long long __kassert_invariant_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * NSEC_PER_SEC + (unsigned long long)ts.tv_nsec;
+}
+
+/*
+    One call of the checker with hooks. Pass starts again (ctx is reset) when epoch of the object changed.
+    skipped is set when lock hook refused the call.
+*/
+static KASSERT_INVARIANT_RESULT __kassert_invariant_call(kassert_invariant_t* inv, kassert_invariant_ctx_t* ctx, unsigned long long* epoch, bool* skipped)
+{
+    *skipped = false;
+
+    if (inv->hooks.lock != NULL && !inv->hooks.lock(inv->obj))
+    {
+        *skipped = true;
+        return KASSERT_INVARIANT_MORE;
+    }
+
+    if (inv->hooks.epoch != NULL)
+    {
+        const unsigned long long current = inv->hooks.epoch(inv->obj);
+        if (ctx->cursor != 0 && current != *epoch)
+            ctx->cursor = 0;
+
+        *epoch = current;
+    }
+
+    ctx->deadline_ns = inv->budget_ns == 0 ? 0 : __kassert_invariant_now_ns() + inv->budget_ns;
+
+    const KASSERT_INVARIANT_RESULT result = inv->fn(inv->obj, ctx);
+
+    if (inv->hooks.unlock != NULL)
+        inv->hooks.unlock(inv->obj);
+
+    if (result == KASSERT_INVARIANT_FAILED)
+        __kassert_print_and_exit(inv->site);
+
+    return result;
+}
+
+/* One call of the next checker in round-robin order, returns false when round is finished */
+static bool __kassert_invariant_step(void)
+{
+    pthread_mutex_lock(&__kassert_invariant_mutex);
+
+    while (__kassert_invariant_head == NULL || __kassert_invariant_check_all_active)
+        pthread_cond_wait(&__kassert_invariant_cond, &__kassert_invariant_mutex);
+
+    kassert_invariant_t* inv = __kassert_invariant_next != NULL ? __kassert_invariant_next : __kassert_invariant_head;
+    __kassert_invariant_next = inv->next;
+    __kassert_invariant_running = inv;
+
+    pthread_mutex_unlock(&__kassert_invariant_mutex);
+
+    /* Disabled site keeps its cursor, pass continues when site is enabled again */
+    bool skipped;
+    const bool enabled = __atomic_load_n(&inv->site->state->enabled, __ATOMIC_RELAXED);
+    const KASSERT_INVARIANT_RESULT result = enabled ? __kassert_invariant_call(inv, &inv->ctx, &inv->epoch, &skipped) : KASSERT_INVARIANT_MORE;
+
+    if (result == KASSERT_INVARIANT_OK)
+        inv->ctx.cursor = 0;
+
+    pthread_mutex_lock(&__kassert_invariant_mutex);
+
+    if (result == KASSERT_INVARIANT_OK)
+        ++inv->passes;
+
+    __kassert_invariant_running = NULL;
+    pthread_cond_broadcast(&__kassert_invariant_cond);
+
+    const bool more = __kassert_invariant_next != NULL;
+
+    pthread_mutex_unlock(&__kassert_invariant_mutex);
+
+    return more;
+}
+
+static void* __kassert_invariant_thread(void* arg)
+{
+    (void)arg;
+
+    const char* interval_str = getenv("KASSERT_INVARIANT_INTERVAL_MS");
+    const unsigned long interval_ms = interval_str == NULL ? INTERVAL_MS_DEFAULT : strtoul(interval_str, NULL, 10);
+
+    const struct timespec interval =
+    {
+        .tv_sec = (time_t)(interval_ms / 1000),
+        .tv_nsec = (long)(interval_ms % 1000) * 1000000L
+    };
+
+    for (;;)
+        if (!__kassert_invariant_step())
+            nanosleep(&interval, NULL);
+
+    return NULL;
+}
+
+/* Mutex is held */
+static bool __kassert_invariant_thread_start(void)
+{
+    if (__kassert_invariant_thread_started)
+        return true;
+
+    /* Thread should not steal signals from the program */
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    pthread_t thread;
+    const int ret = pthread_create(&thread, NULL, __kassert_invariant_thread, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (ret != 0)
+        return false;
+
+    pthread_detach(thread);
+    __kassert_invariant_thread_started = true;
+
+    return true;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+kassert_invariant_t* __kassert_invariant_register(const kassert_site_t* site,
+                                                  kassert_invariant_fn_t fn,
+                                                  void* obj,
+                                                  const kassert_invariant_hooks_t* hooks,
+                                                  unsigned int budget_us)
+{
+    if (fn == NULL)
+        return NULL;
+
+    /* Registration of the checker is the first evaluation of C++ site */
+    if (site->registered && __atomic_load_n(&site->state->enabled, __ATOMIC_RELAXED) == KASSERT_SITE_STATE_UNREGISTERED)
+        (void)__kassert_site_register(site);
+
+    kassert_invariant_t* inv = calloc(1, sizeof(*inv));
+    if (inv == NULL)
+        return NULL;
+
+    inv->site = site;
+    inv->fn = fn;
+    inv->obj = obj;
+    inv->budget_ns = budget_us * NSEC_PER_USEC;
+    if (hooks != NULL)
+        inv->hooks = *hooks;
+
+    pthread_mutex_lock(&__kassert_invariant_mutex);
+
+    if (!__kassert_invariant_thread_start())
+    {
+        pthread_mutex_unlock(&__kassert_invariant_mutex);
+        free(inv);
+        return NULL;
+    }
+
+    inv->next = __kassert_invariant_head;
+    __kassert_invariant_head = inv;
+    pthread_cond_broadcast(&__kassert_invariant_cond);
+
+    pthread_mutex_unlock(&__kassert_invariant_mutex);
+
+    return inv;
+}
+
+bool kassert_invariant_expired(const kassert_invariant_ctx_t* ctx)
+{
+    return ctx->deadline_ns != 0 && __kassert_invariant_now_ns() >= ctx->deadline_ns;
+}
+
+void kassert_invariant_unregister(kassert_invariant_t* inv)
+{
+    if (inv == NULL)
+        return;
+
+    pthread_mutex_lock(&__kassert_invariant_mutex);
+
+    while (__kassert_invariant_running == inv)
+        pthread_cond_wait(&__kassert_invariant_cond, &__kassert_invariant_mutex);
+
+    kassert_invariant_t** link = &__kassert_invariant_head;
+    while (*link != NULL && *link != inv)
+        link = &(*link)->next;
+
+    /* Unknown or already unregistered handle */
+    if (*link == NULL)
+    {
+        pthread_mutex_unlock(&__kassert_invariant_mutex);
+        return;
+    }
+
+    *link = inv->next;
+    if (__kassert_invariant_next == inv)
+        __kassert_invariant_next = inv->next;
+
+    pthread_mutex_unlock(&__kassert_invariant_mutex);
+
+    free(inv);
+}
+
+void kassert_invariant_check_all(void)
+{
+    pthread_mutex_lock(&__kassert_invariant_mutex);
+
+    /* Wait for another check_all, then stop KAssert thread */
+    while (__kassert_invariant_check_all_active)
+        pthread_cond_wait(&__kassert_invariant_cond, &__kassert_invariant_mutex);
+
+    __kassert_invariant_check_all_active = true;
+
+    while (__kassert_invariant_running != NULL)
+        pthread_cond_wait(&__kassert_invariant_cond, &__kassert_invariant_mutex);
+
+    for (kassert_invariant_t* inv = __kassert_invariant_head; inv != NULL; inv = inv->next)
+    {
+        if (!__atomic_load_n(&inv->site->state->enabled, __ATOMIC_RELAXED))
+            continue;
+
+        __kassert_invariant_running = inv;
+
+        pthread_mutex_unlock(&__kassert_invariant_mutex);
+
+        /* Own context, so resumable pass of KAssert thread is not disturbed */
+        kassert_invariant_ctx_t ctx = { .cursor = 0, .deadline_ns = 0 };
+        unsigned long long epoch = 0;
+        bool skipped;
+        unsigned refused = 0;
+
+        KASSERT_INVARIANT_RESULT result;
+        do {
+            result = __kassert_invariant_call(inv, &ctx, &epoch, &skipped);
+            if (skipped)
+            {
+                /* Object stays locked by someone else, checker is skipped and its pass is not counted */
+                if (++refused == CHECK_ALL_LOCK_RETRIES)
+                    break;
+
+                sched_yield();
+            }
+            else
+                refused = 0;
+        } while (result == KASSERT_INVARIANT_MORE);
+
+        /* Running checker cannot be unregistered, so inv->next is valid */
+        pthread_mutex_lock(&__kassert_invariant_mutex);
+
+        if (result == KASSERT_INVARIANT_OK)
+            ++inv->passes;
+
+        __kassert_invariant_running = NULL;
+        pthread_cond_broadcast(&__kassert_invariant_cond);
+    }
+
+    __kassert_invariant_check_all_active = false;
+    pthread_cond_broadcast(&__kassert_invariant_cond);
+
+    pthread_mutex_unlock(&__kassert_invariant_mutex);
+}
+
+unsigned long long kassert_invariant_passes(const kassert_invariant_t* inv)
+{
+    if (inv == NULL)
+        return 0;
+
+    pthread_mutex_lock(&__kassert_invariant_mutex);
+    const unsigned long long passes = inv->passes;
+    pthread_mutex_unlock(&__kassert_invariant_mutex);
+
+    return passes;
+}
@@ -0,0 +1,97 @@
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+/*
+    Kernels of KASSERT_MEM_EQ / KASSERT_MEM_ZERO / KASSERT_MEM_PATTERN.
+
+    Like array kernels (see kassert-array.c) memory is checked in blocks. Block loop ORs differences
+    of bytes without any exit, so data is read once by full width vectors.
+    Only the block with difference is scanned again (from L1) to find the first differing byte.
+*/
+
+/* One page, small enough to stay in L1 when block is scanned again */
+#define MEM_BLOCK 4096
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MEM_X86 1
+#else
+#define MEM_X86 0
+#endif
+
+/* Compares a with b or when b is NULL with byte, returns offset of the first difference or len */
+typedef size_t (*kassert_mem_kernel_t)(const unsigned char* a, const unsigned char* b, size_t len, unsigned char byte);
+
+#define MEM_KERNEL_NAME(isa) __kassert_mem_##isa
+
+#define MEM_SCALAR_KERNEL() \
+    static size_t MEM_KERNEL_NAME(scalar)(const unsigned char* a, const unsigned char* b, size_t len, unsigned char byte) \
+    { \
+        for (size_t i = 0; i < len; ++i) \
+            if (a[i] != (b != NULL ? b[i] : byte)) \
+                return i; \
+        return len; \
+    }
+
+/* Separate loops for both kinds, so the check of b is not in the vector loop */
+#define MEM_BLOCK_LOOP(diff) \
+    for (size_t i = 0; i < len; i += MEM_BLOCK) \
+    { \
+        const size_t end = len - i > MEM_BLOCK ? i + MEM_BLOCK : len; \
+        unsigned char acc = 0; \
+        for (size_t j = i; j < end; ++j) \
+            acc |= (unsigned char)(diff); \
+        if (__builtin_expect(acc != 0, 0)) \
+            for (size_t j = i; j < end; ++j) \
+                if ((diff) != 0) \
+                    return j; \
+    }
+
+#define MEM_BLOCK_KERNEL(isa, attr) \
+    static size_t __attribute__(( attr )) MEM_KERNEL_NAME(isa)(const unsigned char* a, const unsigned char* b, size_t len, unsigned char byte) \
+    { \
+        if (b != NULL) \
+        { \
+            MEM_BLOCK_LOOP(a[j] ^ b[j]) \
+        } \
+        else \
+        { \
+            MEM_BLOCK_LOOP(a[j] ^ byte) \
+        } \
+        return len; \
+    }
+
+MEM_SCALAR_KERNEL()
+MEM_BLOCK_KERNEL(sse2, )
+
+#if MEM_X86
+MEM_BLOCK_KERNEL(avx2, target("avx2"))
+MEM_BLOCK_KERNEL(avx512, target("avx512f,avx512bw"))
+#endif
+
+static const kassert_mem_kernel_t __kassert_mem_kernels[KASSERT_ISA_COUNT] =
+{
+    [KASSERT_ISA_SCALAR] = MEM_KERNEL_NAME(scalar),
+    [KASSERT_ISA_SSE2]   = MEM_KERNEL_NAME(sse2),
+#if MEM_X86
+    [KASSERT_ISA_AVX2]   = MEM_KERNEL_NAME(avx2),
+    [KASSERT_ISA_AVX512] = MEM_KERNEL_NAME(avx512),
+#endif
+};
+
+/* Selected kernel, NULL until the first call */
+static kassert_mem_kernel_t __kassert_mem_kernel;
+
+/***** GLOBAL FUNCTIONS *****/
+size_t __kassert_mem_find(const void* ptr1, const void* ptr2, size_t len, unsigned char byte)
+{
+    kassert_mem_kernel_t kernel = __atomic_load_n(&__kassert_mem_kernel, __ATOMIC_ACQUIRE);
+    if (__builtin_expect(kernel == NULL, 0))
+    {
+        /* Threads racing here select the same kernel */
+        kernel = __kassert_mem_kernels[__kassert_isa()];
+        __atomic_store_n(&__kassert_mem_kernel, kernel, __ATOMIC_RELEASE);
+    }
+
+    return kernel(ptr1, ptr2, len, byte);
+}
@@ -0,0 +1,51 @@
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+__thread unsigned int             __kassert_noalloc_depth  __attribute__(( tls_model("initial-exec") ));
+__thread const kassert_site_t*    __kassert_noalloc_site   __attribute__(( tls_model("initial-exec") ));
+__thread kassert_alloc_counters_t __kassert_alloc_counters __attribute__(( tls_model("initial-exec") ));
+
+/* Defined by libkassert-noalloc.a */
+extern const bool __kassert_noalloc_interposer __attribute__(( weak ));
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_noalloc_disable(void)
+{
+    __kassert_noalloc_depth = 0;
+}
+
+bool kassert_alloc_interposed(void)
+{
+    return &__kassert_noalloc_interposer != NULL;
+}
+
+kassert_alloc_counters_t kassert_alloc_counters_get(void)
+{
+    return __kassert_alloc_counters;
+}
+
+void __kassert_noalloc_fail(const char* fn, size_t size)
+{
+    const kassert_site_t* site = __kassert_noalloc_site;
+    if (site == NULL)
+        return;
+
+    /* Entry is pushed before the report, allocations of the report itself pass (region is over) */
+    __kassert_noalloc_disable();
+    (void)__kassert_context_push_u(fn, KASSERT_PRIMITIVES_UNSIGNED_LONG, size);
+
+    __kassert_print_and_exit(site);
+}
+
+void __kassert_noalloc_fail_free(const void* ptr)
+{
+    const kassert_site_t* site = __kassert_noalloc_site;
+    if (site == NULL)
+        return;
+
+    __kassert_noalloc_disable();
+    (void)__kassert_context_push_p("free", KASSERT_PRIMITIVES_NON_PRIMITIVE, ptr);
+
+    __kassert_print_and_exit(site);
+}
@@ -0,0 +1,31 @@
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+__thread pid_t __kassert_tid __attribute__(( tls_model("initial-exec") ));
+
+static void __kassert_owner_atfork_child(void);
+
+/* The forking thread is the only thread of the child, it has new ThreadID */
+static void __kassert_owner_atfork_child(void)
+{
+    __kassert_tid = 0;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_owner_init(void)
+{
+    (void)pthread_atfork(NULL, NULL, __kassert_owner_atfork_child);
+}
+
+pid_t __kassert_tid_refresh(void)
+{
+    const pid_t tid = (pid_t)syscall(__NR_gettid);
+    __kassert_tid = tid;
+
+    return tid;
+}
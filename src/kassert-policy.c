@@ -0,0 +1,199 @@
+/* pipe2 */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-report.h"
+
+#define EXIT_CODE 1
+
+/* Child of FORK_ABORT waits at most POLL_NS * PARENT_POLLS_MAX until the parent is gone */
+#define POLL_NS          100000L
+#define PARENT_POLLS_MAX 1000
+#define NICE_LOWEST      19
+
+#define NSEC_PER_MSEC    1000000L
+
+static const char* const __kassert_policy_names[KASSERT_FAILURE_POLICY_COUNT] =
+{
+    [KASSERT_FAILURE_POLICY_EXIT]       = "exit",
+    [KASSERT_FAILURE_POLICY_FAST_EXIT]  = "fast-exit",
+    [KASSERT_FAILURE_POLICY_ABORT]      = "abort",
+    [KASSERT_FAILURE_POLICY_CALLBACK]   = "callback",
+    [KASSERT_FAILURE_POLICY_FORK_ABORT] = "fork-abort"
+};
+
+static KASSERT_FAILURE_POLICY    __kassert_policy = KASSERT_FAILURE_POLICY_EXIT;
+static kassert_failure_handler_t __kassert_policy_handler;
+static void*                     __kassert_policy_arg;
+
+/* Set in the child of FORK_ABORT */
+static bool __kassert_policy_forked;
+
+static void __kassert_policy_wait_parent(pid_t parent, int fd);
+static void __attribute__ (( noreturn )) __kassert_policy_abort_child(void);
+
+/*
+    Child competes for CPU with the parent, so report is finished after the death of the parent is visible to the supervisor.
+    fd is the read end of the pipe whose write end is held only by the parent, it is closed when the parent is gone,
+    so child does not wake up (and does not take CPU from the parent on small machines) before. -1 when there is no pipe.
+*/
+static void __kassert_policy_wait_parent(pid_t parent, int fd)
+{
+    if (fd >= 0)
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        (void)poll(&pfd, 1, (int)(POLL_NS * PARENT_POLLS_MAX / NSEC_PER_MSEC));
+
+        close(fd);
+        return;
+    }
+
+    const struct timespec poll = { .tv_sec = 0, .tv_nsec = POLL_NS };
+
+    for (unsigned int i = 0; i < PARENT_POLLS_MAX && getppid() == parent; ++i)
+        nanosleep(&poll, NULL);
+}
+
+/*
+    Child is created by raw clone, so abort (which can use thread ID cached in the thread descriptor) is not used.
+    Process has only this thread, signal to the process is delivered to it.
+*/
+static void __attribute__ (( noreturn )) __kassert_policy_abort_child(void)
+{
+    (void)signal(SIGABRT, SIG_DFL);
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGABRT);
+    (void)sigprocmask(SIG_UNBLOCK, &set, NULL);
+
+    (void)kill(getpid(), SIGABRT);
+
+    _exit(EXIT_CODE);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_policy_init(void)
+{
+    const char* name = getenv("KASSERT_FAILURE_POLICY");
+    if (name == NULL)
+        return;
+
+    /* Callback can be set only by API */
+    for (size_t i = 0; i < KASSERT_FAILURE_POLICY_COUNT; ++i)
+        if (i != KASSERT_FAILURE_POLICY_CALLBACK && strcmp(name, __kassert_policy_names[i]) == 0)
+            (void)kassert_failure_policy_set((KASSERT_FAILURE_POLICY)i, NULL, NULL);
+}
+
+bool __kassert_policy_fork(kassert_report_t* report)
+{
+    if (__atomic_load_n(&__kassert_policy, __ATOMIC_ACQUIRE) != KASSERT_FAILURE_POLICY_FORK_ABORT)
+        return false;
+
+    /* Child would write the buffer again */
+    __kassert_report_flush(report);
+
+    const pid_t parent = getpid();
+
+    /* Close on exec, so programs started by other threads do not hold the write end */
+    int death[2];
+    if (pipe2(death, O_CLOEXEC) != 0)
+        death[0] = death[1] = -1;
+
+    /* fork runs atfork handlers and takes locks of malloc, raw clone is async-signal-safe */
+    const long pid = syscall(SYS_clone, SIGCHLD, 0, 0, 0, 0);
+    if (pid < 0)
+    {
+        if (death[0] >= 0)
+        {
+            close(death[0]);
+            close(death[1]);
+        }
+
+        /* Report is finished in this process, it aborts then */
+        return false;
+    }
+
+    /*
+        Child which did not run yet would be picked before the supervisor when the parent is gone,
+        so it is moved to SCHED_IDLE here, before the parent exits
+    */
+    if (pid > 0)
+    {
+        const struct sched_param param = { .sched_priority = 0 };
+        (void)sched_setscheduler((pid_t)pid, SCHED_IDLE, &param);
+        _exit(EXIT_CODE);
+    }
+
+    if (death[1] >= 0)
+        close(death[1]);
+
+    __kassert_policy_forked = true;
+
+    /* Raw clone does not run pthread_atfork handlers */
+    __kassert_tid = 0;
+
+    /* Symbolization of the child should not delay the supervisor */
+    (void)setpriority(PRIO_PROCESS, 0, NICE_LOWEST);
+    __kassert_policy_wait_parent(parent, death[0]);
+
+    return true;
+}
+
+void __attribute__ (( noreturn )) __kassert_policy_terminate(void)
+{
+    switch (__atomic_load_n(&__kassert_policy, __ATOMIC_ACQUIRE))
+    {
+        case KASSERT_FAILURE_POLICY_FAST_EXIT:
+            _exit(EXIT_CODE);
+        case KASSERT_FAILURE_POLICY_ABORT:
+            abort();
+        case KASSERT_FAILURE_POLICY_CALLBACK:
+            __kassert_policy_handler(__kassert_policy_arg);
+            _exit(EXIT_CODE);
+        case KASSERT_FAILURE_POLICY_FORK_ABORT:
+            if (__kassert_policy_forked)
+                __kassert_policy_abort_child();
+
+            abort();
+        case KASSERT_FAILURE_POLICY_EXIT:
+        case KASSERT_FAILURE_POLICY_COUNT:
+        default:
+            /* exit instead of abort to clean program properly */
+            exit(EXIT_CODE);
+    }
+}
+
+bool kassert_failure_policy_set(KASSERT_FAILURE_POLICY policy, kassert_failure_handler_t handler, void* arg)
+{
+    if ((unsigned)policy >= KASSERT_FAILURE_POLICY_COUNT)
+        return false;
+
+    if (policy == KASSERT_FAILURE_POLICY_CALLBACK && handler == NULL)
+        return false;
+
+    /* Handler is visible before the policy which uses it */
+    __kassert_policy_handler = handler;
+    __kassert_policy_arg = arg;
+    __atomic_store_n(&__kassert_policy, policy, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+KASSERT_FAILURE_POLICY kassert_failure_policy_get(void)
+{
+    return __atomic_load_n(&__kassert_policy, __ATOMIC_ACQUIRE);
+}
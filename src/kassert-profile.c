@@ -0,0 +1,623 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-report.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROFILE_NOW()          __builtin_ia32_rdtsc()
+#define PROFILE_UNIT           "cycles"
+#else
+#define PROFILE_NOW()          __kassert_profile_now()
+#define PROFILE_UNIT           "ns"
+#endif
+
+#define CACHELINE_SIZE         64
+#define CALIBRATION_ROUNDS     64
+
+/* New thread looks for blocks of dead threads at most once per this period (syscall per block) */
+#define REAP_INTERVAL_NS       1000000000ULL
+
+typedef struct kassert_profile_counter
+{
+    unsigned long long evals;
+    unsigned long long fails;
+    unsigned long long time;
+} kassert_profile_counter_t;
+
+/*
+    Counters of all sites for one thread. Only owner writes them, so there is no contention,
+    dump reads them racy (relaxed loads). Owner is ThreadID, 0 when block is free.
+    There is no TSD destructor (pthread_setspecific allocates), block of dead thread keeps its counters
+    and a new thread takes it by compare-and-swap of the owner, after the reaper freed it.
+*/
+typedef struct kassert_profile_block
+{
+    struct kassert_profile_block* next;
+    pid_t                         owner;
+    size_t                        size;
+    kassert_profile_counter_t     counters[] __attribute__(( aligned(CACHELINE_SIZE) ));
+} kassert_profile_block_t;
+
+/* Merged counters of the site, used by dump */
+typedef struct kassert_profile_entry
+{
+    kassert_profile_counter_t sum;
+    size_t                    id;
+} kassert_profile_entry_t;
+
+/* Lock-free list of all blocks, blocks are never freed */
+static kassert_profile_block_t* __kassert_profile_blocks;
+
+static __thread kassert_profile_block_t* __kassert_profile_tls_block __attribute__(( tls_model("initial-exec") ));
+
+/* Set during startup (or by registration of C++ site) when there is a profiled site */
+static bool __kassert_profile_enabled;
+
+/* Set by __kassert_profile_init, profiled site registered later starts the profiler itself */
+static bool __kassert_profile_init_done;
+static bool __kassert_profile_started;
+
+static unsigned long long __kassert_profile_reap_ns;
+
+/* Serializes dumps and reset */
+static pthread_mutex_t __kassert_profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Cost of the empty measurement, subtracted from every sample */
+static unsigned long long __kassert_profile_overhead;
+
+static const char* __kassert_profile_out_path;
+static const char* __kassert_profile_csv_path;
+static const char* __kassert_profile_json_path;
+
+static size_t __kassert_profile_block_size(void);
+static void __kassert_profile_start(void);
+static kassert_profile_block_t* __kassert_profile_block_alloc(void);
+static void __kassert_profile_counters_add(kassert_profile_counter_t* dst, const kassert_profile_counter_t* src);
+static void __kassert_profile_atfork_child(void);
+static void __kassert_profile_calibrate(void);
+static void __kassert_profile_signal(int signo);
+static void __kassert_profile_atexit(void);
+static bool __kassert_profile_thread_dead(pid_t tid);
+static void __kassert_profile_reap(void);
+static kassert_profile_block_t* __kassert_profile_block_claim(pid_t tid);
+static kassert_profile_block_t* __kassert_profile_block_get(void);
+static void __kassert_profile_sort(kassert_profile_entry_t* entries, size_t n);
+static unsigned long long __kassert_profile_share(unsigned long long time, unsigned long long total);
+static void __kassert_profile_print_share(kassert_report_t* report, unsigned long long share, unsigned width);
+static void __kassert_profile_print_site(kassert_report_t* report, const kassert_site_t* site);
+static void __kassert_profile_escape(kassert_report_t* report, const char* str, bool json);
+static void __kassert_profile_dump_text(kassert_report_t* report, const kassert_profile_entry_t* entries, size_t n, unsigned long long total);
+static void __kassert_profile_dump_csv(kassert_report_t* report, const kassert_profile_entry_t* entries, size_t n, unsigned long long total);
+static void __kassert_profile_dump_json(kassert_report_t* report, const kassert_profile_entry_t* entries, size_t n, unsigned long long total);
+static void __kassert_profile_dump_path(const char* path, KASSERT_PROFILE_FORMAT format);
+static void __kassert_profile_dump_all(void);
+
+/* Block has counters also for sites which are not registered yet, so it never grows. Pages of unused counters are not touched */
+static size_t __kassert_profile_block_size(void)
+{
+    return __kassert_sites_section_count() + KASSERT_SITES_REGISTERED_MAX;
+}
+
+static kassert_profile_block_t* __kassert_profile_block_alloc(void)
+{
+    const size_t size = __kassert_profile_block_size();
+
+    /* mmap instead of malloc, we can profile asserts in allocator */
+    void* mem = mmap(NULL,
+                     sizeof(kassert_profile_block_t) + size * sizeof(kassert_profile_counter_t),
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1,
+                     0);
+    if (mem == MAP_FAILED)
+        return NULL;
+
+    kassert_profile_block_t* block = mem;
+    block->size = size;
+
+    return block;
+}
+
+static void __kassert_profile_counters_add(kassert_profile_counter_t* dst, const kassert_profile_counter_t* src)
+{
+    dst->evals += __atomic_load_n(&src->evals, __ATOMIC_RELAXED);
+    dst->fails += __atomic_load_n(&src->fails, __ATOMIC_RELAXED);
+    dst->time  += __atomic_load_n(&src->time, __ATOMIC_RELAXED);
+}
+
+/* Forking thread keeps its block in the child, other blocks belong to threads which do not exist there */
+static void __kassert_profile_atfork_child(void)
+{
+    kassert_profile_block_t* block = __kassert_profile_tls_block;
+    if (block != NULL)
+        __atomic_store_n(&block->owner, (pid_t)syscall(__NR_gettid), __ATOMIC_RELEASE);
+}
+
+static void __kassert_profile_calibrate(void)
+{
+    unsigned long long best = ~0ULL;
+
+    for (unsigned i = 0; i < CALIBRATION_ROUNDS; ++i)
+    {
+        const unsigned long long start = PROFILE_NOW();
+        const unsigned long long time = PROFILE_NOW() - start;
+
+        if (time < best)
+            best = time;
+    }
+
+    __kassert_profile_overhead = best;
+}
+
+static void __kassert_profile_signal(int signo)
+{
+    (void)signo;
+
+    /* Do not deadlock when signal interrupted thread which holds the mutex */
+    const bool locked = pthread_mutex_trylock(&__kassert_profile_mutex) == 0;
+
+    __kassert_profile_dump_all();
+
+    if (locked)
+        pthread_mutex_unlock(&__kassert_profile_mutex);
+}
+
+static void __kassert_profile_atexit(void)
+{
+    pthread_mutex_lock(&__kassert_profile_mutex);
+    __kassert_profile_dump_all();
+    pthread_mutex_unlock(&__kassert_profile_mutex);
+}
+
+static bool __kassert_profile_thread_dead(pid_t tid)
+{
+    return syscall(SYS_tgkill, getpid(), tid, 0) != 0 && errno == ESRCH;
+}
+
+/* Frees blocks of dead threads (counters stay), at most once per REAP_INTERVAL_NS */
+static void __kassert_profile_reap(void)
+{
+    const unsigned long long now = __kassert_profile_now();
+    unsigned long long last = __atomic_load_n(&__kassert_profile_reap_ns, __ATOMIC_RELAXED);
+    if (now - last < REAP_INTERVAL_NS ||
+        !__atomic_compare_exchange_n(&__kassert_profile_reap_ns, &last, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+
+    for (kassert_profile_block_t* block = __atomic_load_n(&__kassert_profile_blocks, __ATOMIC_ACQUIRE); block != NULL; block = block->next)
+    {
+        pid_t owner = __atomic_load_n(&block->owner, __ATOMIC_ACQUIRE);
+        if (owner != 0 && __kassert_profile_thread_dead(owner))
+            (void)__atomic_compare_exchange_n(&block->owner, &owner, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+}
+
+static kassert_profile_block_t* __kassert_profile_block_claim(pid_t tid)
+{
+    for (kassert_profile_block_t* block = __atomic_load_n(&__kassert_profile_blocks, __ATOMIC_ACQUIRE); block != NULL; block = block->next)
+    {
+        pid_t expected = 0;
+        if (__atomic_compare_exchange_n(&block->owner, &expected, tid, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return block;
+    }
+
+    return NULL;
+}
+
+/* Only syscalls and atomics, so it can be called by allocator hooks and signal handlers */
+static kassert_profile_block_t* __kassert_profile_block_get(void)
+{
+    if (!__kassert_profile_enabled)
+        return NULL;
+
+    const pid_t tid = kassert_gettid();
+
+    /* Reuse block of the dead thread if there is one */
+    kassert_profile_block_t* block = __kassert_profile_block_claim(tid);
+    if (block == NULL)
+    {
+        __kassert_profile_reap();
+        block = __kassert_profile_block_claim(tid);
+    }
+
+    if (block == NULL)
+    {
+        block = __kassert_profile_block_alloc();
+        if (block == NULL)
+            return NULL;
+
+        block->owner = tid;
+
+        block->next = __atomic_load_n(&__kassert_profile_blocks, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&__kassert_profile_blocks, &block->next, block, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+
+    __kassert_profile_tls_block = block;
+
+    return block;
+}
+
+/* Shell sort by time (desc), then by evaluations (desc). qsort can malloc, so it cannot be used in signal handler */
+static void __kassert_profile_sort(kassert_profile_entry_t* entries, size_t n)
+{
+    for (size_t gap = n / 2; gap > 0; gap /= 2)
+        for (size_t i = gap; i < n; ++i)
+        {
+            const kassert_profile_entry_t entry = entries[i];
+            size_t j = i;
+
+            for (; j >= gap; j -= gap)
+            {
+                const kassert_profile_entry_t* prev = &entries[j - gap];
+                if (prev->sum.time > entry.sum.time || (prev->sum.time == entry.sum.time && prev->sum.evals >= entry.sum.evals))
+                    break;
+
+                entries[j] = *prev;
+            }
+
+            entries[j] = entry;
+        }
+}
+
+/* Share of the total time in 1/100 of percent */
+static unsigned long long __kassert_profile_share(unsigned long long time, unsigned long long total)
+{
+    if (total == 0)
+        return 0;
+
+    return (unsigned long long)((long double)time * 10000.0L / (long double)total + 0.5L);
+}
+
+static void __kassert_profile_print_share(kassert_report_t* report, unsigned long long share, unsigned width)
+{
+    __kassert_report_uint_pad(report, share / 100, width > 3 ? width - 3 : 0);
+    __kassert_report_char(report, '.');
+    __kassert_report_char(report, (char)('0' + share / 10 % 10));
+    __kassert_report_char(report, (char)('0' + share % 10));
+}
+
+static void __kassert_profile_print_site(kassert_report_t* report, const kassert_site_t* site)
+{
+    __kassert_report_str(report, site->file);
+    __kassert_report_char(report, ':');
+    __kassert_report_int(report, site->line);
+    __kassert_report_str(report, ": ");
+    __kassert_report_str(report, site->func);
+    __kassert_report_str(report, ": \'");
+    __kassert_report_str(report, site->expr);
+    __kassert_report_str(report, "\'\n");
+}
+
+/* Writes quoted string (CSV doubles quotes, JSON escapes them), control chars are replaced by spaces */
+static void __kassert_profile_escape(kassert_report_t* report, const char* str, bool json)
+{
+    __kassert_report_char(report, '\"');
+
+    for (; *str != '\0'; ++str)
+    {
+        if (*str == '\"')
+            __kassert_report_str(report, json ? "\\\"" : "\"\"");
+        else if (json && *str == '\\')
+            __kassert_report_str(report, "\\\\");
+        else if ((unsigned char)*str < ' ')
+            __kassert_report_char(report, ' ');
+        else
+            __kassert_report_char(report, *str);
+    }
+
+    __kassert_report_char(report, '\"');
+}
+
+static void __kassert_profile_dump_text(kassert_report_t* report, const kassert_profile_entry_t* entries, size_t n, unsigned long long total)
+{
+    unsigned long long evals = 0;
+    for (size_t i = 0; i < n; ++i)
+        evals += entries[i].sum.evals;
+
+    __kassert_report_str(report, "KAssert profile: ");
+    __kassert_report_uint(report, n);
+    __kassert_report_str(report, " sites, ");
+    __kassert_report_uint(report, evals);
+    __kassert_report_str(report, " evaluations, ");
+    __kassert_report_uint(report, total);
+    __kassert_report_str(report, " " PROFILE_UNIT "\n");
+    __kassert_report_str(report, "    share        evals        fails  " PROFILE_UNIT "/eval      id  site\n");
+
+    bool never_run = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const kassert_profile_entry_t* entry = &entries[i];
+        if (entry->sum.evals == 0)
+        {
+            never_run = true;
+            continue;
+        }
+
+        __kassert_profile_print_share(report, __kassert_profile_share(entry->sum.time, total), 8);
+        __kassert_report_char(report, '%');
+        __kassert_report_uint_pad(report, entry->sum.evals, 13);
+        __kassert_report_uint_pad(report, entry->sum.fails, 13);
+        __kassert_report_uint_pad(report, entry->sum.time / entry->sum.evals, 13);
+        __kassert_report_uint_pad(report, entry->id, 8);
+        __kassert_report_str(report, "  ");
+        __kassert_profile_print_site(report, kassert_site_get(entry->id));
+    }
+
+    if (!never_run)
+        return;
+
+    __kassert_report_str(report, "Never evaluated sites:\n");
+    for (size_t i = 0; i < n; ++i)
+    {
+        const kassert_profile_entry_t* entry = &entries[i];
+        if (entry->sum.evals != 0)
+            continue;
+
+        const kassert_site_t* site = kassert_site_get(entry->id);
+
+        __kassert_report_uint_pad(report, entry->id, 8);
+        __kassert_report_char(report, ' ');
+        __kassert_report_str(report, __kassert_level_name(site->level));
+        __kassert_report_str(report, __atomic_load_n(&site->state->enabled, __ATOMIC_RELAXED) ? " on  " : " off ");
+        __kassert_profile_print_site(report, site);
+    }
+}
+
+static void __kassert_profile_dump_csv(kassert_report_t* report, const kassert_profile_entry_t* entries, size_t n, unsigned long long total)
+{
+    __kassert_report_str(report, "id,file,line,func,expr,level,evals,fails," PROFILE_UNIT "," PROFILE_UNIT "_per_eval,share\n");
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const kassert_profile_entry_t* entry = &entries[i];
+        const kassert_site_t* site = kassert_site_get(entry->id);
+
+        __kassert_report_uint(report, entry->id);
+        __kassert_report_char(report, ',');
+        __kassert_profile_escape(report, site->file, false);
+        __kassert_report_char(report, ',');
+        __kassert_report_int(report, site->line);
+        __kassert_report_char(report, ',');
+        __kassert_profile_escape(report, site->func, false);
+        __kassert_report_char(report, ',');
+        __kassert_profile_escape(report, site->expr, false);
+        __kassert_report_char(report, ',');
+        __kassert_report_str(report, __kassert_level_name(site->level));
+        __kassert_report_char(report, ',');
+        __kassert_report_uint(report, entry->sum.evals);
+        __kassert_report_char(report, ',');
+        __kassert_report_uint(report, entry->sum.fails);
+        __kassert_report_char(report, ',');
+        __kassert_report_uint(report, entry->sum.time);
+        __kassert_report_char(report, ',');
+        __kassert_report_uint(report, entry->sum.evals == 0 ? 0 : entry->sum.time / entry->sum.evals);
+        __kassert_report_char(report, ',');
+        __kassert_profile_print_share(report, __kassert_profile_share(entry->sum.time, total), 0);
+        __kassert_report_char(report, '\n');
+    }
+}
+
+static void __kassert_profile_dump_json(kassert_report_t* report, const kassert_profile_entry_t* entries, size_t n, unsigned long long total)
+{
+    __kassert_report_str(report, "{\"unit\":\"" PROFILE_UNIT "\",\"total\":");
+    __kassert_report_uint(report, total);
+    __kassert_report_str(report, ",\"sites\":[");
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const kassert_profile_entry_t* entry = &entries[i];
+        const kassert_site_t* site = kassert_site_get(entry->id);
+
+        __kassert_report_str(report, i == 0 ? "\n{\"id\":" : ",\n{\"id\":");
+        __kassert_report_uint(report, entry->id);
+        __kassert_report_str(report, ",\"file\":");
+        __kassert_profile_escape(report, site->file, true);
+        __kassert_report_str(report, ",\"line\":");
+        __kassert_report_int(report, site->line);
+        __kassert_report_str(report, ",\"func\":");
+        __kassert_profile_escape(report, site->func, true);
+        __kassert_report_str(report, ",\"expr\":");
+        __kassert_profile_escape(report, site->expr, true);
+        __kassert_report_str(report, ",\"level\":\"");
+        __kassert_report_str(report, __kassert_level_name(site->level));
+        __kassert_report_str(report, "\",\"evals\":");
+        __kassert_report_uint(report, entry->sum.evals);
+        __kassert_report_str(report, ",\"fails\":");
+        __kassert_report_uint(report, entry->sum.fails);
+        __kassert_report_str(report, ",\"" PROFILE_UNIT "\":");
+        __kassert_report_uint(report, entry->sum.time);
+        __kassert_report_str(report, ",\"share\":");
+        __kassert_profile_print_share(report, __kassert_profile_share(entry->sum.time, total), 0);
+        __kassert_report_char(report, '}');
+    }
+
+    __kassert_report_str(report, "\n]}\n");
+}
+
+static void __kassert_profile_dump_path(const char* path, KASSERT_PROFILE_FORMAT format)
+{
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return;
+
+    kassert_profile_dump(fd, format);
+    close(fd);
+}
+
+/* Caller holds the mutex (or tried to take it in signal handler) */
+static void __kassert_profile_dump_all(void)
+{
+    if (__kassert_profile_out_path != NULL)
+        __kassert_profile_dump_path(__kassert_profile_out_path, KASSERT_PROFILE_FORMAT_TEXT);
+    else
+        kassert_profile_dump(STDERR_FILENO, KASSERT_PROFILE_FORMAT_TEXT);
+
+    if (__kassert_profile_csv_path != NULL)
+        __kassert_profile_dump_path(__kassert_profile_csv_path, KASSERT_PROFILE_FORMAT_CSV);
+
+    if (__kassert_profile_json_path != NULL)
+        __kassert_profile_dump_path(__kassert_profile_json_path, KASSERT_PROFILE_FORMAT_JSON);
+}
+
+static void __kassert_profile_start(void)
+{
+    if (__atomic_exchange_n(&__kassert_profile_started, true, __ATOMIC_ACQ_REL))
+        return;
+
+    __kassert_profile_calibrate();
+
+    __kassert_profile_out_path = getenv("KASSERT_PROFILE_OUT");
+    __kassert_profile_csv_path = getenv("KASSERT_PROFILE_CSV");
+    __kassert_profile_json_path = getenv("KASSERT_PROFILE_JSON");
+
+    const char* signo = getenv("KASSERT_PROFILE_SIGNAL");
+    if (signo != NULL)
+    {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = __kassert_profile_signal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+
+        (void)sigaction(atoi(signo), &sa, NULL);
+    }
+
+    (void)pthread_atfork(NULL, NULL, __kassert_profile_atfork_child);
+    (void)atexit(__kassert_profile_atexit);
+
+    __atomic_store_n(&__kassert_profile_enabled, true, __ATOMIC_RELEASE);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_profile_init(void)
+{
+    __atomic_store_n(&__kassert_profile_init_done, true, __ATOMIC_RELEASE);
+
+    /* Program without KASSERT_PROFILE sites does not pay for the profiler (and does not print empty report) */
+    bool profiled = false;
+    const size_t count = kassert_sites_count();
+    for (size_t id = 0; id < count && !profiled; ++id)
+        profiled = kassert_site_get(id)->profiled;
+
+    if (profiled)
+        __kassert_profile_start();
+}
+
+void __kassert_profile_site_registered(const kassert_site_t* site)
+{
+    if (site->profiled && __atomic_load_n(&__kassert_profile_init_done, __ATOMIC_ACQUIRE))
+        __kassert_profile_start();
+}
+
+void __kassert_profile_record(const kassert_site_t* site, unsigned long long time, bool failed)
+{
+    kassert_profile_block_t* block = __kassert_profile_tls_block;
+    if (__builtin_expect(block == NULL, 0))
+    {
+        block = __kassert_profile_block_get();
+        if (block == NULL)
+            return;
+    }
+
+    /* SIZE_MAX for sites out of the table */
+    const size_t id = __kassert_site_id(site);
+    if (id >= block->size)
+        return;
+
+    time = time > __kassert_profile_overhead ? time - __kassert_profile_overhead : 0;
+
+    /* Only owner writes, relaxed stores let dump read counters of live threads */
+    kassert_profile_counter_t* counter = &block->counters[id];
+    __atomic_store_n(&counter->evals, counter->evals + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&counter->fails, counter->fails + failed, __ATOMIC_RELAXED);
+    __atomic_store_n(&counter->time, counter->time + time, __ATOMIC_RELAXED);
+}
+
+unsigned long long __kassert_profile_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+void kassert_profile_dump(int fd, KASSERT_PROFILE_FORMAT format)
+{
+    const size_t count = kassert_sites_count();
+    if (count == 0 || !__atomic_load_n(&__kassert_profile_enabled, __ATOMIC_ACQUIRE))
+        return;
+
+    const size_t map_size = count * sizeof(kassert_profile_entry_t);
+    void* mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return;
+
+    /* Only sites compiled with KASSERT_PROFILE */
+    kassert_profile_entry_t* entries = mem;
+    size_t n = 0;
+    unsigned long long total = 0;
+
+    for (size_t id = 0; id < count; ++id)
+    {
+        if (!kassert_site_get(id)->profiled)
+            continue;
+
+        kassert_profile_entry_t* entry = &entries[n++];
+        entry->id = id;
+
+        for (kassert_profile_block_t* block = __atomic_load_n(&__kassert_profile_blocks, __ATOMIC_ACQUIRE); block != NULL; block = block->next)
+            __kassert_profile_counters_add(&entry->sum, &block->counters[id]);
+
+        total += entry->sum.time;
+    }
+
+    __kassert_profile_sort(entries, n);
+
+    kassert_report_t report;
+    __kassert_report_init(&report, fd);
+
+    switch (format)
+    {
+        case KASSERT_PROFILE_FORMAT_CSV:
+            __kassert_profile_dump_csv(&report, entries, n, total);
+            break;
+        case KASSERT_PROFILE_FORMAT_JSON:
+            __kassert_profile_dump_json(&report, entries, n, total);
+            break;
+        case KASSERT_PROFILE_FORMAT_TEXT:
+        default:
+            __kassert_profile_dump_text(&report, entries, n, total);
+            break;
+    }
+
+    __kassert_report_flush(&report);
+    munmap(mem, map_size);
+}
+
+void kassert_profile_reset(void)
+{
+    pthread_mutex_lock(&__kassert_profile_mutex);
+
+    const size_t count = kassert_sites_count();
+    for (kassert_profile_block_t* block = __atomic_load_n(&__kassert_profile_blocks, __ATOMIC_ACQUIRE); block != NULL; block = block->next)
+        for (size_t i = 0; i < count && i < block->size; ++i)
+        {
+            __atomic_store_n(&block->counters[i].evals, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&block->counters[i].fails, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&block->counters[i].time, 0, __ATOMIC_RELAXED);
+        }
+
+    pthread_mutex_unlock(&__kassert_profile_mutex);
+}
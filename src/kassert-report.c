@@ -0,0 +1,426 @@
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "kassert-report.h"
+
+/* printf("%f") prints 6 digits after the dot */
+#define FLOAT_PRECISION      6
+#define FLOAT_PRECISION_MUL  1000000ULL
+
+/* Bigger values do not fit into unsigned long long, so print them in exponent form (like %e) */
+#define FLOAT_EXP_THRESHOLD  1e18L
+
+/* Flush waits so many yields for flush of another thread, then it writes anyway (i.e. it interrupted the holder) */
+#define WRITE_LOCK_SPINS     1000
+
+/* Preallocated per-thread buffer, never from heap to not deadlock on malloc locks */
+static __thread char __kassert_report_tls_buf[KASSERT_REPORT_BUF_SIZE];
+
+/* Flushes are serialized, write to pipe is atomic only up to PIPE_BUF, so longer reports could interleave */
+static bool __kassert_report_write_lock;
+
+static bool __kassert_report_write_trylock(void);
+static void __kassert_report_write_all(int fd, const char* buf, size_t len);
+static bool __kassert_report_grow(kassert_report_t* report);
+/* Moves report to the mmaped buffer 4x bigger, returns false when it cannot grow */
+static bool __kassert_report_grow(kassert_report_t* report)
+{
+    if (report->size >= KASSERT_REPORT_MAP_SIZE_MAX)
+        return false;
+
+    const size_t size = report->size * 4;
+    char* const buf = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED)
+        return false;
+
+    memcpy(buf, report->buf, report->len);
+
+    if (report->buf != __kassert_report_tls_buf)
+        munmap(report->buf, report->size);
+
+    report->buf = buf;
+    report->size = size;
+
+    return true;
+}
+
+static void __kassert_report_digits(kassert_report_t* report, unsigned long long val, unsigned base, unsigned min_digits);
+
+static bool __kassert_report_write_trylock(void)
+{
+    for (unsigned i = 0; i < WRITE_LOCK_SPINS; ++i)
+    {
+        if (!__atomic_exchange_n(&__kassert_report_write_lock, true, __ATOMIC_ACQUIRE))
+            return true;
+
+        sched_yield();
+    }
+
+    return false;
+}
+
+static void __kassert_report_write_all(int fd, const char* buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t ret = write(fd, buf, len);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return;
+        }
+
+        buf += ret;
+        len -= (size_t)ret;
+    }
+}
+
+static void __kassert_report_digits(kassert_report_t* report, unsigned long long val, unsigned base, unsigned min_digits)
+{
+    /* 64 bits in base 2 is the worst case */
+    char digits[64];
+    unsigned n = 0;
+
+    do {
+        digits[n++] = "0123456789abcdef"[val % base];
+        val /= base;
+    } while (val != 0);
+
+    while (n < min_digits)
+        digits[n++] = '0';
+
+    while (n > 0)
+        __kassert_report_char(report, digits[--n]);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_report_init(kassert_report_t* report, int fd)
+{
+    report->buf = __kassert_report_tls_buf;
+    report->len = 0;
+    report->size = KASSERT_REPORT_BUF_SIZE;
+    report->fd = fd;
+}
+
+void __kassert_report_flush(kassert_report_t* report)
+{
+    const bool locked = __kassert_report_write_trylock();
+    __kassert_report_write_all(report->fd, report->buf, report->len);
+    if (locked)
+        __atomic_store_n(&__kassert_report_write_lock, false, __ATOMIC_RELEASE);
+
+    report->len = 0;
+
+    if (report->buf != __kassert_report_tls_buf)
+    {
+        munmap(report->buf, report->size);
+        report->buf = __kassert_report_tls_buf;
+        report->size = KASSERT_REPORT_BUF_SIZE;
+    }
+}
+
+void __kassert_report_char(kassert_report_t* report, char c)
+{
+    if (report->len == report->size && !__kassert_report_grow(report))
+        __kassert_report_flush(report);
+
+    report->buf[report->len++] = c;
+}
+
+void __kassert_report_str(kassert_report_t* report, const char* str)
+{
+    if (str == NULL)
+        str = "(null)";
+
+    while (*str != '\0')
+        __kassert_report_char(report, *str++);
+}
+
+void __kassert_report_uint(kassert_report_t* report, unsigned long long val)
+{
+    __kassert_report_digits(report, val, 10, 1);
+}
+
+void __kassert_report_uint_pad(kassert_report_t* report, unsigned long long val, unsigned width)
+{
+    unsigned digits = 1;
+    for (unsigned long long i = val; i >= 10; i /= 10)
+        ++digits;
+
+    for (; digits < width; ++digits)
+        __kassert_report_char(report, ' ');
+
+    __kassert_report_uint(report, val);
+}
+
+void __kassert_report_int(kassert_report_t* report, long long val)
+{
+    if (val < 0)
+    {
+        __kassert_report_char(report, '-');
+        /* -LLONG_MIN does not fit into long long, negate in unsigned arithmetic */
+        __kassert_report_uint(report, 0ULL - (unsigned long long)val);
+    }
+    else
+    {
+        __kassert_report_uint(report, (unsigned long long)val);
+    }
+}
+
+void __kassert_report_hex(kassert_report_t* report, unsigned long long val)
+{
+    __kassert_report_str(report, "0x");
+    __kassert_report_digits(report, val, 16, 1);
+}
+
+void __kassert_report_hex_pad(kassert_report_t* report, unsigned long long val, unsigned digits)
+{
+    __kassert_report_digits(report, val, 16, digits);
+}
+
+void __kassert_report_ptr(kassert_report_t* report, const void* ptr)
+{
+    /* The same as glibc %p */
+    if (ptr == NULL)
+        __kassert_report_str(report, "(nil)");
+    else
+        __kassert_report_hex(report, (unsigned long long)(uintptr_t)ptr);
+}
+
+void __kassert_report_float(kassert_report_t* report, long double val)
+{
+    if (__builtin_signbit(val))
+    {
+        __kassert_report_char(report, '-');
+        val = -val;
+    }
+
+    if (__builtin_isnan(val))
+    {
+        __kassert_report_str(report, "nan");
+        return;
+    }
+
+    if (__builtin_isinf(val))
+    {
+        __kassert_report_str(report, "inf");
+        return;
+    }
+
+    unsigned exp10 = 0;
+    if (val >= FLOAT_EXP_THRESHOLD)
+        while (val >= 10.0L)
+        {
+            val /= 10.0L;
+            ++exp10;
+        }
+
+    unsigned long long int_part = (unsigned long long)val;
+    unsigned long long frac_part = (unsigned long long)((val - (long double)int_part) * (long double)FLOAT_PRECISION_MUL + 0.5L);
+
+    /* Rounding can carry to integer part (0.9999999 -> 1.000000) */
+    if (frac_part >= FLOAT_PRECISION_MUL)
+    {
+        ++int_part;
+        frac_part -= FLOAT_PRECISION_MUL;
+    }
+
+    /* and then also to exponent (9.9999999e+20 -> 1.000000e+21) */
+    if (exp10 > 0 && int_part >= 10)
+    {
+        int_part /= 10;
+        ++exp10;
+    }
+
+    __kassert_report_uint(report, int_part);
+    __kassert_report_char(report, '.');
+    __kassert_report_digits(report, frac_part, 10, FLOAT_PRECISION);
+
+    if (exp10 > 0)
+    {
+        __kassert_report_str(report, "e+");
+        __kassert_report_digits(report, exp10, 10, 2);
+    }
+}
+
+void __kassert_report_value(kassert_report_t* report, KASSERT_PRIMITIVES type, const kassert_value_t* val)
+{
+    switch (type)
+    {
+        case KASSERT_PRIMITIVES_BOOL:
+            __kassert_report_uint(report, val->u);
+            break;
+        case KASSERT_PRIMITIVES_CHAR:
+        case KASSERT_PRIMITIVES_SIGNED_CHAR:
+        case KASSERT_PRIMITIVES_UNSIGNED_CHAR:
+            __kassert_report_char(report, (char)val->s);
+            break;
+        case KASSERT_PRIMITIVES_SHORT:
+        case KASSERT_PRIMITIVES_INT:
+        case KASSERT_PRIMITIVES_LONG:
+        case KASSERT_PRIMITIVES_LONG_LONG:
+            __kassert_report_int(report, val->s);
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_SHORT:
+        case KASSERT_PRIMITIVES_UNSIGNED_INT:
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG:
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG:
+            __kassert_report_uint(report, val->u);
+            break;
+        case KASSERT_PRIMITIVES_FLOAT:
+        case KASSERT_PRIMITIVES_DOUBLE:
+            __kassert_report_float(report, val->d);
+            break;
+        case KASSERT_PRIMITIVES_LONG_DOUBLE:
+            __kassert_report_float(report, val->ld);
+            break;
+        case KASSERT_PRIMITIVES_NON_PRIMITIVE:
+        default:
+            __kassert_report_ptr(report, val->ptr);
+            break;
+    }
+}
+
+void __kassert_value_fetch(KASSERT_PRIMITIVES type, va_list* args, kassert_value_t* val)
+{
+    /* Clear also padding of long double, values can be compared by memcmp */
+    memset(val, 0, sizeof(*val));
+
+    /* bool, chars and shorts are promoted to int, float to double */
+    switch (type)
+    {
+        case KASSERT_PRIMITIVES_BOOL:
+        case KASSERT_PRIMITIVES_CHAR:
+        case KASSERT_PRIMITIVES_SIGNED_CHAR:
+        case KASSERT_PRIMITIVES_UNSIGNED_CHAR:
+        case KASSERT_PRIMITIVES_SHORT:
+        case KASSERT_PRIMITIVES_UNSIGNED_SHORT:
+        case KASSERT_PRIMITIVES_INT:
+            val->s = va_arg(*args, int);
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_INT:
+            val->u = va_arg(*args, unsigned int);
+            break;
+        case KASSERT_PRIMITIVES_LONG:
+            val->s = va_arg(*args, long);
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG:
+            val->u = va_arg(*args, unsigned long);
+            break;
+        case KASSERT_PRIMITIVES_LONG_LONG:
+            val->s = va_arg(*args, long long);
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG:
+            val->u = va_arg(*args, unsigned long long);
+            break;
+        case KASSERT_PRIMITIVES_FLOAT:
+        case KASSERT_PRIMITIVES_DOUBLE:
+            val->d = va_arg(*args, double);
+            break;
+        case KASSERT_PRIMITIVES_LONG_DOUBLE:
+            val->ld = va_arg(*args, long double);
+            break;
+        case KASSERT_PRIMITIVES_NON_PRIMITIVE:
+        default:
+            val->ptr = va_arg(*args, void*);
+            break;
+    }
+}
+
+size_t __kassert_value_size(KASSERT_PRIMITIVES type)
+{
+    switch (type)
+    {
+        case KASSERT_PRIMITIVES_BOOL:
+            return sizeof(bool);
+        case KASSERT_PRIMITIVES_CHAR:
+        case KASSERT_PRIMITIVES_SIGNED_CHAR:
+        case KASSERT_PRIMITIVES_UNSIGNED_CHAR:
+            return sizeof(char);
+        case KASSERT_PRIMITIVES_SHORT:
+        case KASSERT_PRIMITIVES_UNSIGNED_SHORT:
+            return sizeof(short);
+        case KASSERT_PRIMITIVES_INT:
+        case KASSERT_PRIMITIVES_UNSIGNED_INT:
+            return sizeof(int);
+        case KASSERT_PRIMITIVES_LONG:
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG:
+            return sizeof(long);
+        case KASSERT_PRIMITIVES_LONG_LONG:
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG:
+            return sizeof(long long);
+        case KASSERT_PRIMITIVES_FLOAT:
+            return sizeof(float);
+        case KASSERT_PRIMITIVES_DOUBLE:
+            return sizeof(double);
+        case KASSERT_PRIMITIVES_LONG_DOUBLE:
+            return sizeof(long double);
+        case KASSERT_PRIMITIVES_NON_PRIMITIVE:
+        default:
+            return sizeof(void*);
+    }
+}
+
+void __kassert_value_load(KASSERT_PRIMITIVES type, const void* ptr, kassert_value_t* val)
+{
+    memset(val, 0, sizeof(*val));
+
+    switch (type)
+    {
+        case KASSERT_PRIMITIVES_BOOL:
+            val->s = *(const bool *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_CHAR:
+            val->s = *(const char *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_SIGNED_CHAR:
+            val->s = *(const signed char *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_CHAR:
+            val->s = *(const unsigned char *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_SHORT:
+            val->s = *(const short *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_SHORT:
+            val->s = *(const unsigned short *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_INT:
+            val->s = *(const int *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_INT:
+            val->u = *(const unsigned int *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_LONG:
+            val->s = *(const long *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG:
+            val->u = *(const unsigned long *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_LONG_LONG:
+            val->s = *(const long long *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_UNSIGNED_LONG_LONG:
+            val->u = *(const unsigned long long *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_FLOAT:
+            val->d = *(const float *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_DOUBLE:
+            val->d = *(const double *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_LONG_DOUBLE:
+            val->ld = *(const long double *)ptr;
+            break;
+        case KASSERT_PRIMITIVES_NON_PRIMITIVE:
+        default:
+            val->ptr = *(const void* const *)ptr;
+            break;
+    }
+}
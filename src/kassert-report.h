@@ -0,0 +1,77 @@
+#ifndef KASSERT_REPORT_H
+#define KASSERT_REPORT_H
+
+/*
+    This is the private header for the KAssert library sources.
+    Report engine: renders text into preallocated per-thread buffer without heap and stdio.
+    All functions are async-signal-safe, so they can be used in the failure path.
+
+    Report is written by one write(2) at flush and flushes of all threads are serialized, so lines of other
+    reports (i.e. soft records drained by another thread) cannot be in the middle of it. Longer report moves to anonymous mmap
+    (taken when the per-thread buffer is full, so only by long reports), it is unmapped by flush.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stddef.h>
+#include <stdarg.h>
+
+#include <kassert/kassert.h>
+
+/* Size of the per-thread buffer */
+#define KASSERT_REPORT_BUF_SIZE 4096
+
+/* Limit of the mmaped buffer, when report is longer (or mmap fails) buffer is flushed in the middle */
+#define KASSERT_REPORT_MAP_SIZE_MAX (16UL << 20)
+
+/* Raw value of the primitive, which variant is valid depends on KASSERT_PRIMITIVES tag */
+typedef union kassert_value
+{
+    long long          s;
+    unsigned long long u;
+    double             d;
+    long double        ld;
+    const void*        ptr;
+} kassert_value_t;
+
+typedef struct kassert_report
+{
+    char*  buf;
+    size_t len;
+    size_t size;
+    int    fd;
+} kassert_report_t;
+
+/* Starts new report written to fd. Report uses buffer of the calling thread */
+void __kassert_report_init(kassert_report_t* report, int fd);
+
+/* Writes buffered text using one write(2) (more only when write is partial) */
+void __kassert_report_flush(kassert_report_t* report);
+
+void __kassert_report_str(kassert_report_t* report, const char* str);
+void __kassert_report_char(kassert_report_t* report, char c);
+void __kassert_report_int(kassert_report_t* report, long long val);
+void __kassert_report_uint(kassert_report_t* report, unsigned long long val);
+/* Right-aligned in the field of width chars (padded by spaces) */
+void __kassert_report_uint_pad(kassert_report_t* report, unsigned long long val, unsigned width);
+void __kassert_report_hex(kassert_report_t* report, unsigned long long val);
+/* Hex without 0x prefix, padded by zeros to digits (hexdumps) */
+void __kassert_report_hex_pad(kassert_report_t* report, unsigned long long val, unsigned digits);
+void __kassert_report_float(kassert_report_t* report, long double val);
+void __kassert_report_ptr(kassert_report_t* report, const void* ptr);
+
+/* Renders value like printf with format from KASSERT_PRIMTIVE_GET_FMT would do */
+void __kassert_report_value(kassert_report_t* report, KASSERT_PRIMITIVES type, const kassert_value_t* val);
+
+/* Fetches value passed by variadic arguments (after default promotions) */
+void __kassert_value_fetch(KASSERT_PRIMITIVES type, va_list* args, kassert_value_t* val);
+
+/* Size of the primitive in memory (sizeof(void*) for NON_PRIMITIVE) */
+size_t __kassert_value_size(KASSERT_PRIMITIVES type);
+
+/* Loads value of the primitive from memory, i.e. array element */
+void __kassert_value_load(KASSERT_PRIMITIVES type, const void* ptr, kassert_value_t* val);
+
+#endif
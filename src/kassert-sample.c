@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include <limits.h>
+
+#include <kassert/kassert.h>
+
+/* Per-thread state of xorshift32, 0 means not seeded */
+static __thread uint32_t __kassert_sample_seed;
+
+static uint32_t __kassert_sample_random(void);
+
+static uint32_t __kassert_sample_random(void)
+{
+    uint32_t x = __kassert_sample_seed;
+
+    /* Address of TLS variable is different in each thread, good enough as a seed */
+    if (x == 0)
+        x = ((uint32_t)(uintptr_t)&__kassert_sample_seed ^ 0x9E3779B9U) | 1U;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    __kassert_sample_seed = x;
+
+    return x;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+bool __kassert_sample_reset(unsigned int* countdown, const unsigned int* rate)
+{
+    const unsigned int r = __atomic_load_n(rate, __ATOMIC_RELAXED);
+
+    if (r <= 1)
+    {
+        *countdown = 0;
+        return true;
+    }
+
+    /* Uniform countdown in [0, 2 * rate - 2], so on average site is evaluated once per rate executions */
+    const unsigned int range = r > UINT_MAX / 2 ? UINT_MAX : 2 * r - 1;
+    *countdown = __kassert_sample_random() % range;
+
+    return true;
+}
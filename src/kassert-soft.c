@@ -0,0 +1,578 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-report.h"
+#include "kassert-symbolize.h"
+
+/* Both have to be power of 2 */
+#define RING_SIZE               256
+#define SITE_STATS_SIZE         4096
+
+#define CACHELINE_SIZE          64
+#define BURST_DEFAULT           5
+#define WINDOW_MS_DEFAULT       1000
+
+#define NSEC_PER_SEC            1000000000ULL
+#define NSEC_PER_MSEC           1000000ULL
+
+/* Drain looks for rings of dead threads at most once per this period (syscall per ring) */
+#define REAP_INTERVAL_NS        NSEC_PER_SEC
+
+typedef struct kassert_soft_record
+{
+    const kassert_site_t* site;
+    kassert_value_t       val1;
+    kassert_value_t       val2;
+    unsigned long long    timestamp_ns;
+    unsigned int          frames_count;
+    void*                 frames[KASSERT_SOFT_STACK_MAX];
+} kassert_soft_record_t;
+
+/*
+    Single producer (owner thread) single consumer (drainer under mutex) ring.
+    Producer and consumer indexes are in separate cache lines.
+    Owner is ThreadID of the producer, 0 when ring is free. There is no TSD destructor
+    (pthread_key_create / pthread_setspecific allocate), drain frees empty rings of dead threads
+    and a new thread takes the free ring by compare-and-swap of the owner.
+*/
+typedef struct kassert_soft_ring
+{
+    /* Written only by producer */
+    unsigned long      head __attribute__(( aligned(CACHELINE_SIZE) ));
+    unsigned long long recorded;
+    unsigned long long dropped;
+    unsigned long long reentered;
+
+    /* Written only by consumer */
+    unsigned long      tail __attribute__(( aligned(CACHELINE_SIZE) ));
+    unsigned long long dropped_reported;
+    unsigned long long reentered_reported;
+
+    /* Rarely changed */
+    struct kassert_soft_ring* next __attribute__(( aligned(CACHELINE_SIZE) ));
+    pid_t                     owner;
+
+    kassert_soft_record_t records[RING_SIZE];
+} kassert_soft_ring_t;
+
+/* Drainer side statistics of the site, used for deduplication and rate limiting */
+typedef struct kassert_soft_site_stats
+{
+    const kassert_site_t* site;
+    unsigned long long    total;
+    unsigned long long    window_start_ns;
+    unsigned long long    suppressed;
+    unsigned long long    repeated;
+    unsigned int          window_printed;
+    bool                  has_last;
+    kassert_value_t       last_val1;
+    kassert_value_t       last_val2;
+} kassert_soft_site_stats_t;
+
+/* Lock-free list of all rings, rings are never freed */
+static kassert_soft_ring_t* __kassert_soft_rings;
+
+static __thread kassert_soft_ring_t* __kassert_soft_tls_ring __attribute__(( tls_model("initial-exec") ));
+
+/* Set while the thread is in __kassert_soft_record, soft failure in signal handler which interrupted it is only counted */
+static __thread bool __kassert_soft_in_record __attribute__(( tls_model("initial-exec") ));
+
+static unsigned int __kassert_soft_stack_depth;
+
+/* Drainer side, protected by drain mutex */
+static pthread_mutex_t           __kassert_soft_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static kassert_soft_site_stats_t __kassert_soft_stats[SITE_STATS_SIZE];
+static unsigned int              __kassert_soft_burst = BURST_DEFAULT;
+static unsigned long long        __kassert_soft_window_ns = WINDOW_MS_DEFAULT * NSEC_PER_MSEC;
+
+static unsigned long long        __kassert_soft_reap_ns;
+
+static bool         __kassert_soft_drainer_started;
+static unsigned int __kassert_soft_drainer_interval_ms;
+
+static void __kassert_soft_atfork_child(void);
+static kassert_soft_ring_t* __kassert_soft_ring_get(void);
+static void __kassert_soft_ring_push(kassert_soft_ring_t* ring, const kassert_site_t* site, const void* caller, va_list* args);
+static bool __kassert_soft_thread_dead(pid_t tid);
+static unsigned long long __kassert_soft_now_ns(void);
+static kassert_soft_site_stats_t* __kassert_soft_stats_get(const kassert_site_t* site);
+static void __kassert_soft_print_site(kassert_report_t* report, const kassert_site_t* site);
+static void __kassert_soft_print_record(kassert_report_t* report, const kassert_soft_record_t* record, pid_t tid);
+static void __kassert_soft_print_repeated(kassert_report_t* report, kassert_soft_site_stats_t* stats);
+static void __kassert_soft_print_suppressed(kassert_report_t* report, kassert_soft_site_stats_t* stats);
+static void __kassert_soft_emit(kassert_report_t* report, const kassert_soft_record_t* record, pid_t tid);
+static void __kassert_soft_drain_locked(bool force);
+static void* __kassert_soft_drainer(void* arg);
+static void __kassert_soft_atexit(void);
+static unsigned int __kassert_soft_getenv(const char* name, unsigned int def);
+static void __attribute__ (( constructor )) __kassert_soft_init(void);
+
+/* Forking thread keeps its ring in the child, other rings belong to threads which do not exist there */
+static void __kassert_soft_atfork_child(void)
+{
+    kassert_soft_ring_t* ring = __kassert_soft_tls_ring;
+    if (ring != NULL)
+        __atomic_store_n(&ring->owner, (pid_t)syscall(__NR_gettid), __ATOMIC_RELEASE);
+}
+
+/* Only syscalls and atomics, so it can be called by allocator hooks and signal handlers */
+static kassert_soft_ring_t* __kassert_soft_ring_get(void)
+{
+    kassert_soft_ring_t* ring = __kassert_soft_tls_ring;
+    if (__builtin_expect(ring != NULL, 1))
+        return ring;
+
+    const pid_t tid = kassert_gettid();
+
+    /* Reuse ring of the dead thread if there is one */
+    for (ring = __atomic_load_n(&__kassert_soft_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+    {
+        pid_t expected = 0;
+        if (__atomic_compare_exchange_n(&ring->owner, &expected, tid, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (ring == NULL)
+    {
+        /* mmap instead of malloc, allocator is not entered */
+        void* mem = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+            return NULL;
+
+        ring = mem;
+        ring->owner = tid;
+
+        ring->next = __atomic_load_n(&__kassert_soft_rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&__kassert_soft_rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+
+    __kassert_soft_tls_ring = ring;
+
+    return ring;
+}
+
+static void __kassert_soft_ring_push(kassert_soft_ring_t* ring, const kassert_site_t* site, const void* caller, va_list* args)
+{
+    __atomic_store_n(&ring->recorded, ring->recorded + 1, __ATOMIC_RELAXED);
+
+    const unsigned long head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= RING_SIZE)
+    {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    kassert_soft_record_t* record = &ring->records[head & (RING_SIZE - 1)];
+    record->site = site;
+
+    if (site->op_str != NULL)
+    {
+        __kassert_value_fetch(site->val1_type, args, &record->val1);
+        __kassert_value_fetch(site->val2_type, args, &record->val2);
+    }
+    else
+    {
+        memset(&record->val1, 0, sizeof(record->val1));
+        memset(&record->val2, 0, sizeof(record->val2));
+    }
+
+    record->timestamp_ns = __kassert_soft_now_ns();
+
+    const unsigned int depth = __atomic_load_n(&__kassert_soft_stack_depth, __ATOMIC_RELAXED);
+    record->frames_count = depth == 0 ? 0 : (unsigned int)__kassert_backtrace_from(caller, record->frames, depth);
+
+    /* Publish record to the drainer */
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static bool __kassert_soft_thread_dead(pid_t tid)
+{
+    return syscall(SYS_tgkill, getpid(), tid, 0) != 0 && errno == ESRCH;
+}
+
+static unsigned long long __kassert_soft_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (unsigned long long)ts.tv_sec * NSEC_PER_SEC + (unsigned long long)ts.tv_nsec;
+}
+
+static kassert_soft_site_stats_t* __kassert_soft_stats_get(const kassert_site_t* site)
+{
+    const size_t hash = (size_t)(((uintptr_t)site >> 3) * 0x9E3779B97F4A7C15ULL);
+
+    for (size_t i = 0; i < SITE_STATS_SIZE; ++i)
+    {
+        kassert_soft_site_stats_t* stats = &__kassert_soft_stats[(hash + i) & (SITE_STATS_SIZE - 1)];
+        if (stats->site == site)
+            return stats;
+
+        if (stats->site == NULL)
+        {
+            stats->site = site;
+            return stats;
+        }
+    }
+
+    /* Table is full, no deduplication for this site */
+    return NULL;
+}
+
+static void __kassert_soft_print_site(kassert_report_t* report, const kassert_site_t* site)
+{
+    __kassert_report_str(report, site->file);
+    __kassert_report_char(report, ':');
+    __kassert_report_int(report, site->line);
+    __kassert_report_str(report, ": ");
+    __kassert_report_str(report, site->func);
+    __kassert_report_str(report, ": Soft assertion \'");
+    __kassert_report_str(report, site->expr);
+    __kassert_report_char(report, '\'');
+}
+
+static void __kassert_soft_print_record(kassert_report_t* report, const kassert_soft_record_t* record, pid_t tid)
+{
+    const kassert_site_t* site = record->site;
+
+    __kassert_soft_print_site(report, site);
+    __kassert_report_str(report, " failed.");
+
+    if (site->op_str != NULL)
+    {
+        __kassert_report_str(report, " (");
+        __kassert_report_value(report, site->val1_type, &record->val1);
+        __kassert_report_char(report, ' ');
+        __kassert_report_str(report, site->op_str);
+        __kassert_report_char(report, ' ');
+        __kassert_report_value(report, site->val2_type, &record->val2);
+        __kassert_report_char(report, ')');
+    }
+
+    __kassert_report_str(report, " ThreadID: ");
+    __kassert_report_int(report, tid);
+    __kassert_report_str(report, " Time: ");
+    __kassert_report_uint(report, record->timestamp_ns / NSEC_PER_SEC);
+    __kassert_report_char(report, '.');
+
+    /* Nanoseconds with leading zeros */
+    for (unsigned long long div = NSEC_PER_SEC / 10; div > 0; div /= 10)
+        __kassert_report_char(report, (char)('0' + (record->timestamp_ns / div) % 10));
+
+    __kassert_report_char(report, '\n');
+
+    if (record->frames_count > 0)
+    {
+        __kassert_report_str(report, "Stacktrace:\n");
+        __kassert_symbolize_frames(report, record->frames, record->frames_count);
+    }
+}
+
+static void __kassert_soft_print_repeated(kassert_report_t* report, kassert_soft_site_stats_t* stats)
+{
+    if (stats->repeated == 0)
+        return;
+
+    __kassert_soft_print_site(report, stats->site);
+    __kassert_report_str(report, " repeated ");
+    __kassert_report_uint(report, stats->repeated);
+    __kassert_report_str(report, " times\n");
+
+    stats->repeated = 0;
+}
+
+static void __kassert_soft_print_suppressed(kassert_report_t* report, kassert_soft_site_stats_t* stats)
+{
+    if (stats->suppressed == 0)
+        return;
+
+    __kassert_soft_print_site(report, stats->site);
+    __kassert_report_str(report, " suppressed ");
+    __kassert_report_uint(report, stats->suppressed);
+    __kassert_report_str(report, " records (total ");
+    __kassert_report_uint(report, stats->total);
+    __kassert_report_str(report, ")\n");
+
+    stats->suppressed = 0;
+}
+
+static void __kassert_soft_emit(kassert_report_t* report, const kassert_soft_record_t* record, pid_t tid)
+{
+    kassert_soft_site_stats_t* stats = __kassert_soft_stats_get(record->site);
+    if (stats == NULL)
+    {
+        __kassert_soft_print_record(report, record, tid);
+        return;
+    }
+
+    ++stats->total;
+
+    /* The same values like in the last printed record, just count it */
+    if (stats->has_last &&
+        memcmp(&stats->last_val1, &record->val1, sizeof(record->val1)) == 0 &&
+        memcmp(&stats->last_val2, &record->val2, sizeof(record->val2)) == 0)
+    {
+        ++stats->repeated;
+        return;
+    }
+
+    __kassert_soft_print_repeated(report, stats);
+
+    /* Rings are drained one by one, so timestamps can go back in time, they stay in the current window */
+    if (record->timestamp_ns >= stats->window_start_ns + __kassert_soft_window_ns)
+    {
+        __kassert_soft_print_suppressed(report, stats);
+        stats->window_start_ns = record->timestamp_ns;
+        stats->window_printed = 0;
+    }
+
+    if (stats->window_printed < __kassert_soft_burst)
+    {
+        __kassert_soft_print_record(report, record, tid);
+        ++stats->window_printed;
+
+        stats->has_last = true;
+        stats->last_val1 = record->val1;
+        stats->last_val2 = record->val2;
+    }
+    else
+    {
+        ++stats->suppressed;
+    }
+}
+
+static void __kassert_soft_drain_locked(bool force)
+{
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
+
+    const unsigned long long now = __kassert_soft_now_ns();
+    const bool reap = now >= __kassert_soft_reap_ns + REAP_INTERVAL_NS;
+    if (reap)
+        __kassert_soft_reap_ns = now;
+
+    for (kassert_soft_ring_t* ring = __atomic_load_n(&__kassert_soft_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+    {
+        pid_t owner = __atomic_load_n(&ring->owner, __ATOMIC_ACQUIRE);
+        if (owner == 0)
+            continue;
+
+        const unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        for (unsigned long i = ring->tail; i != head; ++i)
+            __kassert_soft_emit(&report, &ring->records[i & (RING_SIZE - 1)], owner);
+
+        __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+        const unsigned long long dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->dropped_reported)
+        {
+            __kassert_report_str(&report, "KAssert: ThreadID: ");
+            __kassert_report_int(&report, owner);
+            __kassert_report_str(&report, " dropped ");
+            __kassert_report_uint(&report, dropped - ring->dropped_reported);
+            __kassert_report_str(&report, " soft records (ring is full)\n");
+
+            ring->dropped_reported = dropped;
+        }
+
+        const unsigned long long reentered = __atomic_load_n(&ring->reentered, __ATOMIC_RELAXED);
+        if (reentered != ring->reentered_reported)
+        {
+            __kassert_report_str(&report, "KAssert: ThreadID: ");
+            __kassert_report_int(&report, owner);
+            __kassert_report_str(&report, " dropped ");
+            __kassert_report_uint(&report, reentered - ring->reentered_reported);
+            __kassert_report_str(&report, " soft records (signal handler interrupted other record)\n");
+
+            ring->reentered_reported = reentered;
+        }
+
+        /*
+            Owner is dead and ring is empty, so it can be reused. Owner is changed only when it is still the dead thread,
+            ThreadID reused by a new thread keeps the ring until that thread exits.
+        */
+        if (reap && __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == head && __kassert_soft_thread_dead(owner))
+            (void)__atomic_compare_exchange_n(&ring->owner, &owner, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+
+    /* Summaries of closed windows (or all of them when forced) */
+    for (size_t i = 0; i < SITE_STATS_SIZE; ++i)
+    {
+        kassert_soft_site_stats_t* stats = &__kassert_soft_stats[i];
+        if (stats->site == NULL)
+            continue;
+
+        __kassert_soft_print_repeated(&report, stats);
+
+        if (force || now >= stats->window_start_ns + __kassert_soft_window_ns)
+            __kassert_soft_print_suppressed(&report, stats);
+    }
+
+    __kassert_report_flush(&report);
+}
+
+static void* __kassert_soft_drainer(void* arg)
+{
+    (void)arg;
+
+    const struct timespec interval =
+    {
+        .tv_sec = __kassert_soft_drainer_interval_ms / 1000,
+        .tv_nsec = (long)(__kassert_soft_drainer_interval_ms % 1000) * 1000000L
+    };
+
+    for (;;)
+    {
+        nanosleep(&interval, NULL);
+        kassert_drain();
+    }
+
+    return NULL;
+}
+
+static void __kassert_soft_atexit(void)
+{
+    pthread_mutex_lock(&__kassert_soft_drain_mutex);
+    __kassert_soft_drain_locked(true);
+    pthread_mutex_unlock(&__kassert_soft_drain_mutex);
+}
+
+static unsigned int __kassert_soft_getenv(const char* name, unsigned int def)
+{
+    const char* str = getenv(name);
+    if (str == NULL)
+        return def;
+
+    const unsigned long val = strtoul(str, NULL, 10);
+
+    return (unsigned int)val;
+}
+
+static void __attribute__ (( constructor )) __kassert_soft_init(void)
+{
+    kassert_soft_set_stack_depth(__kassert_soft_getenv("KASSERT_SOFT_STACK", 0));
+    kassert_soft_set_rate_limit(__kassert_soft_getenv("KASSERT_SOFT_BURST", BURST_DEFAULT),
+                                __kassert_soft_getenv("KASSERT_SOFT_WINDOW_MS", WINDOW_MS_DEFAULT));
+
+    const unsigned int interval_ms = __kassert_soft_getenv("KASSERT_SOFT_DRAIN_MS", 0);
+    if (interval_ms > 0)
+        (void)kassert_soft_start_drainer(interval_ms);
+
+    (void)atexit(__kassert_soft_atexit);
+    (void)pthread_atfork(NULL, NULL, __kassert_soft_atfork_child);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __attribute__ ((cold)) __kassert_soft_record(const kassert_site_t* site, ...)
+{
+    /* Signal handler interrupted record of this thread, ring is in the middle of the push */
+    if (__kassert_soft_in_record)
+    {
+        kassert_soft_ring_t* ring = __kassert_soft_tls_ring;
+        if (ring != NULL)
+            (void)__atomic_add_fetch(&ring->reentered, 1, __ATOMIC_RELAXED);
+
+        return;
+    }
+
+    __kassert_soft_in_record = true;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    kassert_soft_ring_t* ring = __kassert_soft_ring_get();
+    if (ring != NULL)
+    {
+        va_list args;
+        va_start(args, site);
+
+        __kassert_soft_ring_push(ring, site, __builtin_return_address(0), &args);
+
+        va_end(args);
+    }
+
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    __kassert_soft_in_record = false;
+}
+
+void kassert_drain(void)
+{
+    pthread_mutex_lock(&__kassert_soft_drain_mutex);
+    __kassert_soft_drain_locked(false);
+    pthread_mutex_unlock(&__kassert_soft_drain_mutex);
+}
+
+bool kassert_soft_start_drainer(unsigned int interval_ms)
+{
+    pthread_mutex_lock(&__kassert_soft_drain_mutex);
+
+    if (__kassert_soft_drainer_started || interval_ms == 0)
+    {
+        pthread_mutex_unlock(&__kassert_soft_drain_mutex);
+        return false;
+    }
+
+    __kassert_soft_drainer_interval_ms = interval_ms;
+
+    /* Thread should not steal signals from the program */
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    pthread_t thread;
+    const int ret = pthread_create(&thread, NULL, __kassert_soft_drainer, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (ret == 0)
+    {
+        pthread_detach(thread);
+        __kassert_soft_drainer_started = true;
+    }
+
+    pthread_mutex_unlock(&__kassert_soft_drain_mutex);
+
+    return ret == 0;
+}
+
+void kassert_soft_set_stack_depth(unsigned int depth)
+{
+    if (depth > KASSERT_SOFT_STACK_MAX)
+        depth = KASSERT_SOFT_STACK_MAX;
+
+    __atomic_store_n(&__kassert_soft_stack_depth, depth, __ATOMIC_RELAXED);
+}
+
+void kassert_soft_set_rate_limit(unsigned int burst, unsigned int window_ms)
+{
+    pthread_mutex_lock(&__kassert_soft_drain_mutex);
+
+    __kassert_soft_burst = burst;
+    __kassert_soft_window_ns = window_ms * NSEC_PER_MSEC;
+
+    pthread_mutex_unlock(&__kassert_soft_drain_mutex);
+}
+
+unsigned long long kassert_soft_failures(void)
+{
+    unsigned long long total = 0;
+
+    for (kassert_soft_ring_t* ring = __atomic_load_n(&__kassert_soft_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+        total += __atomic_load_n(&ring->recorded, __ATOMIC_RELAXED) + __atomic_load_n(&ring->reentered, __ATOMIC_RELAXED);
+
+    return total;
+}
@@ -0,0 +1,366 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <execinfo.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+
+#define FRAMES_MAX      256
+
+/* Frames of the library above the caller, which __kassert_backtrace_from looks through */
+#define CALLER_FRAMES_MAX 8
+#define MAPS_BUF_SIZE   4096
+
+/* Executable mappings known to frame-pointer walker */
+#define EXEC_MAPS_MAX   1024
+
+/* Return address outside of known code re-reads /proc/self/maps (dlopen), at most once per this period */
+#define EXEC_REFRESH_NS 100000000ULL
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define FRAME_POINTER_SUPPORTED 1
+#else
+#define FRAME_POINTER_SUPPORTED 0
+#endif
+
+/* Frame record, pushed by prologue of function with frame pointer */
+typedef struct kassert_frame
+{
+    const struct kassert_frame* next;
+    void*                       ret;
+} kassert_frame_t;
+
+/* [lo, hi) of the mapping, empty when it is not known yet */
+typedef struct kassert_range
+{
+    uintptr_t lo;
+    uintptr_t hi;
+} kassert_range_t;
+
+/*
+    r-x mappings sorted by address (order of /proc/self/maps). Shared by threads,
+    seq is odd while the table is rewritten, so walker in another thread (or signal handler) does not trust it.
+*/
+typedef struct kassert_exec_maps
+{
+    unsigned int    seq;
+    bool            writing;
+    size_t          count;
+    kassert_range_t ranges[EXEC_MAPS_MAX];
+} kassert_exec_maps_t;
+
+static KASSERT_UNWINDER __kassert_unwinder = KASSERT_UNWINDER_BACKTRACE;
+
+static __thread kassert_range_t __kassert_stack_bounds __attribute__(( tls_model("initial-exec") ));
+
+static kassert_exec_maps_t __kassert_exec_maps;
+static unsigned long long  __kassert_exec_maps_time;
+
+static int __kassert_stack_hex(char c);
+static bool __kassert_stack_maps_read(uintptr_t sp, kassert_range_t* bounds, kassert_exec_maps_t* exec);
+static bool __kassert_stack_exec_refresh(void);
+static bool __kassert_stack_exec_find(uintptr_t addr, size_t* hint);
+static size_t __kassert_stack_backtrace(void** frames, size_t max);
+
+/* Value of hex digit, -1 for other characters */
+static int __kassert_stack_hex(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+/*
+    One pass over /proc/self/maps, only start-end and permissions of every line are parsed, so lines are not buffered.
+    bounds (when not NULL) gets the mapping with sp, exec (when not NULL) gets r-x mappings.
+    Returns true when the mapping with sp is found (or bounds is NULL).
+*/
+static bool __kassert_stack_maps_read(uintptr_t sp, kassert_range_t* bounds, kassert_exec_maps_t* exec)
+{
+    const int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    char buf[MAPS_BUF_SIZE];
+    uintptr_t start = 0;
+    uintptr_t end = 0;
+    unsigned int field = 0; /* 0 - start, 1 - end, 2 - permissions, 3 - rest of the line */
+    unsigned int perm = 0;
+    bool found = bounds == NULL;
+    bool done = false;
+
+    if (exec != NULL)
+        exec->count = 0;
+
+    ssize_t ret;
+    while (!done && (ret = read(fd, buf, sizeof(buf))) > 0)
+        for (ssize_t i = 0; i < ret && !done; ++i)
+        {
+            const char c = buf[i];
+            if (c == '\n')
+            {
+                start = 0;
+                end = 0;
+                field = 0;
+                perm = 0;
+            }
+            else if (field == 0)
+            {
+                if (c == '-')
+                    field = 1;
+                else
+                    start = (start << 4) | (uintptr_t)__kassert_stack_hex(c);
+            }
+            else if (field == 1)
+            {
+                if (c == ' ')
+                {
+                    field = 2;
+                    if (!found && start <= sp && sp < end)
+                    {
+                        bounds->lo = start;
+                        bounds->hi = end;
+                        found = true;
+                    }
+                }
+                else
+                    end = (end << 4) | (uintptr_t)__kassert_stack_hex(c);
+            }
+            else if (field == 2)
+            {
+                if (c == ' ')
+                    field = 3;
+                else if (perm++ == 2 && c == 'x' && exec != NULL && exec->count < EXEC_MAPS_MAX)
+                {
+                    exec->ranges[exec->count].lo = start;
+                    exec->ranges[exec->count].hi = end;
+                    ++exec->count;
+                }
+            }
+
+            /* Without exec the file is read only up to the stack */
+            done = found && exec == NULL;
+        }
+
+    close(fd);
+
+    return found;
+}
+
+/* Re-reads executable mappings, returns false when it is done by other thread or it was done recently */
+static bool __kassert_stack_exec_refresh(void)
+{
+    const unsigned long long now = __kassert_profile_now();
+    if (now - __atomic_load_n(&__kassert_exec_maps_time, __ATOMIC_RELAXED) < EXEC_REFRESH_NS)
+        return false;
+
+    if (__atomic_exchange_n(&__kassert_exec_maps.writing, true, __ATOMIC_ACQUIRE))
+        return false;
+
+    __atomic_store_n(&__kassert_exec_maps_time, now, __ATOMIC_RELAXED);
+
+    __atomic_add_fetch(&__kassert_exec_maps.seq, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    (void)__kassert_stack_maps_read(0, NULL, &__kassert_exec_maps);
+
+    __atomic_add_fetch(&__kassert_exec_maps.seq, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&__kassert_exec_maps.writing, false, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/*
+    True when addr is in r-x mapping. Caller checks seq of the table around the walk.
+    hint is index of the last found mapping, frames of the same binary are usually next to each other.
+*/
+static bool __kassert_stack_exec_find(uintptr_t addr, size_t* hint)
+{
+    size_t count = __atomic_load_n(&__kassert_exec_maps.count, __ATOMIC_RELAXED);
+    if (count > EXEC_MAPS_MAX)
+        count = EXEC_MAPS_MAX;
+
+    if (*hint < count && __kassert_exec_maps.ranges[*hint].lo <= addr && addr < __kassert_exec_maps.ranges[*hint].hi)
+        return true;
+
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        const kassert_range_t* range = &__kassert_exec_maps.ranges[mid];
+
+        if (addr < range->lo)
+            hi = mid;
+        else if (addr >= range->hi)
+            lo = mid + 1;
+        else
+        {
+            *hint = mid;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* glibc backtrace, frame of this function is dropped */
+static size_t __kassert_stack_backtrace(void** frames, size_t max)
+{
+    void* buf[FRAMES_MAX + 1];
+    const int count = backtrace(buf, (int)(max < FRAMES_MAX ? max : FRAMES_MAX) + 1);
+    if (count <= 1)
+        return 0;
+
+    memcpy(frames, buf + 1, (size_t)(count - 1) * sizeof(*frames));
+
+    return (size_t)(count - 1);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+size_t __kassert_backtrace_from(const void* caller, void** frames, size_t max)
+{
+    void* buf[FRAMES_MAX + CALLER_FRAMES_MAX];
+    if (max > FRAMES_MAX)
+        max = FRAMES_MAX;
+
+    const size_t count = kassert_backtrace(buf, max + CALLER_FRAMES_MAX);
+
+    size_t first = 0;
+    while (first < count && first < CALLER_FRAMES_MAX && buf[first] != caller)
+        ++first;
+
+    /* Caller is lost (unwinder stopped early), better the whole stack than nothing */
+    if (first == count || buf[first] != caller)
+        first = 0;
+
+    const size_t n = count - first < max ? count - first : max;
+    memcpy(frames, buf + first, n * sizeof(*frames));
+
+    return n;
+}
+
+void __kassert_stack_init(void)
+{
+    const char* name = getenv("KASSERT_UNWINDER");
+    if (name != NULL && strcmp(name, "fp") == 0)
+        (void)kassert_unwinder_set(KASSERT_UNWINDER_FRAME_POINTER);
+
+    /*
+        First call of backtrace loads libgcc_s (dlopen + malloc).
+        Do it during startup, to not do it in the failure path.
+        Bounds of the stack of the main thread and executable mappings are read too (one pass).
+    */
+    void* frames[1];
+    (void)__kassert_stack_backtrace(frames, 1);
+
+    const void* sp = __builtin_frame_address(0);
+    __atomic_store_n(&__kassert_exec_maps.writing, true, __ATOMIC_RELAXED);
+    __kassert_exec_maps.seq = 1;
+    (void)__kassert_stack_maps_read((uintptr_t)sp, &__kassert_stack_bounds, &__kassert_exec_maps);
+    __atomic_store_n(&__kassert_exec_maps.seq, 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&__kassert_exec_maps_time, __kassert_profile_now(), __ATOMIC_RELAXED);
+    __atomic_store_n(&__kassert_exec_maps.writing, false, __ATOMIC_RELEASE);
+}
+
+bool kassert_unwinder_set(KASSERT_UNWINDER unwinder)
+{
+    if ((unsigned)unwinder >= KASSERT_UNWINDER_COUNT)
+        return false;
+
+    if (unwinder == KASSERT_UNWINDER_FRAME_POINTER && !FRAME_POINTER_SUPPORTED)
+        return false;
+
+    __atomic_store_n(&__kassert_unwinder, unwinder, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+KASSERT_UNWINDER kassert_unwinder_get(void)
+{
+    return __atomic_load_n(&__kassert_unwinder, __ATOMIC_RELAXED);
+}
+
+size_t __attribute__ (( noinline )) kassert_backtrace(void** frames, size_t max)
+{
+    if (max == 0)
+        return 0;
+
+    if (__atomic_load_n(&__kassert_unwinder, __ATOMIC_RELAXED) != KASSERT_UNWINDER_FRAME_POINTER)
+        return __kassert_stack_backtrace(frames, max);
+
+    /* __builtin_frame_address forces frame pointer of this function, its record points to the caller */
+    const kassert_frame_t* frame = __builtin_frame_address(0);
+    const uintptr_t sp = (uintptr_t)frame;
+
+    kassert_range_t* bounds = &__kassert_stack_bounds;
+    if (sp < bounds->lo || sp >= bounds->hi)
+        if (!__kassert_stack_maps_read(sp, bounds, NULL))
+            return __kassert_stack_backtrace(frames, max);
+
+    size_t count = 0;
+    size_t hint = 0;
+    bool refreshed = false;
+    const uintptr_t hi = bounds->hi;
+
+    /* Table is rewritten by other thread, pre-warmed backtrace does not need it */
+    unsigned int seq = __atomic_load_n(&__kassert_exec_maps.seq, __ATOMIC_ACQUIRE);
+    if ((seq & 1) != 0)
+        return __kassert_stack_backtrace(frames, max);
+
+    /* The first record is checked against sp, every next one has to be above the previous one */
+    if ((uintptr_t)frame < sp)
+        return 0;
+
+    while (count < max)
+    {
+        const uintptr_t addr = (uintptr_t)frame;
+
+        /* Record has to be aligned and inside the stack */
+        if (addr > hi - sizeof(*frame) || (addr & (sizeof(void*) - 1)) != 0)
+            break;
+
+        /*
+            Caller without frame pointer leaves stale value in the frame pointer register,
+            so the record is garbage. Return address has to point into r-x mapping,
+            the walk ends at the first one which does not (the table is refreshed once, for dlopen).
+        */
+        const uintptr_t ret = (uintptr_t)frame->ret;
+        bool exec = __kassert_stack_exec_find(ret, &hint);
+        if (!exec && !refreshed)
+        {
+            refreshed = true;
+            if (__kassert_stack_exec_refresh())
+            {
+                seq = __atomic_load_n(&__kassert_exec_maps.seq, __ATOMIC_ACQUIRE);
+                exec = (seq & 1) == 0 && __kassert_stack_exec_find(ret, &hint);
+            }
+        }
+
+        if (!exec)
+            break;
+
+        frames[count++] = frame->ret;
+
+        const kassert_frame_t* next = frame->next;
+        if ((uintptr_t)next <= addr)
+            break;
+
+        frame = next;
+    }
+
+    /* Table was rewritten during the walk, lookups could see torn entries */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&__kassert_exec_maps.seq, __ATOMIC_RELAXED) != seq)
+        return __kassert_stack_backtrace(frames, max);
+
+    return count;
+}
@@ -0,0 +1,387 @@
+/* dl_iterate_phdr */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <link.h>
+
+#include "kassert-elf.h"
+#include "kassert-symbolize.h"
+
+#define MODULES_MAX         64
+#define MODULE_PATH_MAX     512
+#define RANGES_MAX          256
+
+/* Line of /proc/self/maps with path has to fit, longer lines are skipped */
+#define MAPS_BUF_SIZE       4096
+
+/* Failure in another thread is symbolizing, wait a bit then fall back to raw frames */
+#define LOCK_SPINS          1000
+
+typedef struct kassert_symbolize_module
+{
+    char          path[MODULE_PATH_MAX];
+    uintptr_t     base;     /* address where file offset 0 is mapped */
+    bool          opened;
+    bool          failed;
+    kassert_elf_t elf;
+} kassert_symbolize_module_t;
+
+/* Executable mapping */
+typedef struct kassert_symbolize_range
+{
+    uintptr_t start;
+    uintptr_t end;
+    size_t    module;
+} kassert_symbolize_range_t;
+
+static kassert_symbolize_module_t __kassert_symbolize_modules[MODULES_MAX];
+static size_t                     __kassert_symbolize_modules_count;
+
+static kassert_symbolize_range_t  __kassert_symbolize_ranges[RANGES_MAX];
+static size_t                     __kassert_symbolize_ranges_count;
+
+static bool __kassert_symbolize_lock;
+static bool __kassert_symbolize_disabled;
+
+static bool __kassert_symbolize_trylock(void);
+static void __kassert_symbolize_unlock(void);
+static uintptr_t __kassert_symbolize_parse_hex(const char** str, const char* end);
+static size_t __kassert_symbolize_module_get(const char* path, size_t len);
+static void __kassert_symbolize_maps_line(const char* line, const char* end);
+static void __kassert_symbolize_maps_read(void);
+static const kassert_symbolize_range_t* __kassert_symbolize_range_find(uintptr_t addr);
+static void __kassert_symbolize_frame(kassert_report_t* report, size_t n, uintptr_t addr, bool* maps_read);
+static int __kassert_symbolize_raw_module(struct dl_phdr_info* info, size_t size, void* data);
+static void __kassert_symbolize_raw_frame(kassert_report_t* report, size_t n, uintptr_t addr);
+static void __attribute__ (( constructor )) __kassert_symbolize_init(void);
+
+static bool __kassert_symbolize_trylock(void)
+{
+    for (unsigned i = 0; i < LOCK_SPINS; ++i)
+    {
+        if (!__atomic_exchange_n(&__kassert_symbolize_lock, true, __ATOMIC_ACQUIRE))
+            return true;
+
+        sched_yield();
+    }
+
+    return false;
+}
+
+static void __kassert_symbolize_unlock(void)
+{
+    __atomic_store_n(&__kassert_symbolize_lock, false, __ATOMIC_RELEASE);
+}
+
+static uintptr_t __kassert_symbolize_parse_hex(const char** str, const char* end)
+{
+    uintptr_t val = 0;
+    const char* s = *str;
+
+    for (; s < end; ++s)
+    {
+        unsigned digit;
+        if (*s >= '0' && *s <= '9')
+            digit = (unsigned)(*s - '0');
+        else if (*s >= 'a' && *s <= 'f')
+            digit = (unsigned)(*s - 'a' + 10);
+        else
+            break;
+
+        val = (val << 4) | digit;
+    }
+
+    *str = s;
+
+    return val;
+}
+
+/* Index of the module with path, new module is added when there is a place. MODULES_MAX when table is full */
+static size_t __kassert_symbolize_module_get(const char* path, size_t len)
+{
+    for (size_t i = 0; i < __kassert_symbolize_modules_count; ++i)
+        if (strncmp(__kassert_symbolize_modules[i].path, path, len) == 0 && __kassert_symbolize_modules[i].path[len] == '\0')
+            return i;
+
+    if (__kassert_symbolize_modules_count == MODULES_MAX)
+        return MODULES_MAX;
+
+    kassert_symbolize_module_t* module = &__kassert_symbolize_modules[__kassert_symbolize_modules_count];
+    memcpy(module->path, path, len);
+    module->path[len] = '\0';
+    module->base = UINTPTR_MAX;
+
+    return __kassert_symbolize_modules_count++;
+}
+
+/* start-end perms offset dev inode path */
+static void __kassert_symbolize_maps_line(const char* line, const char* end)
+{
+    const char* s = line;
+
+    const uintptr_t start = __kassert_symbolize_parse_hex(&s, end);
+    if (s == end || *s++ != '-')
+        return;
+
+    const uintptr_t stop = __kassert_symbolize_parse_hex(&s, end);
+    if (end - s < 6 || *s++ != ' ')
+        return;
+
+    const bool exec = s[2] == 'x';
+    s += 5;
+
+    const uintptr_t offset = __kassert_symbolize_parse_hex(&s, end);
+
+    /* Skip dev and inode */
+    for (unsigned fields = 0; fields < 2; ++fields)
+    {
+        while (s < end && *s == ' ')
+            ++s;
+        while (s < end && *s != ' ')
+            ++s;
+    }
+
+    while (s < end && *s == ' ')
+        ++s;
+
+    /* Anonymous mappings, [vdso], [stack] and removed files */
+    static const char deleted[] = " (deleted)";
+    const size_t len = (size_t)(end - s);
+    if (len == 0 || *s != '/' || len >= MODULE_PATH_MAX ||
+        (len >= sizeof(deleted) - 1 && memcmp(end - (sizeof(deleted) - 1), deleted, sizeof(deleted) - 1) == 0))
+        return;
+
+    const size_t module = __kassert_symbolize_module_get(s, len);
+    if (module == MODULES_MAX)
+        return;
+
+    /* Mapping with the lowest offset is the first PT_LOAD, maps are sorted so it comes first */
+    if (offset == 0 || __kassert_symbolize_modules[module].base == UINTPTR_MAX)
+        __kassert_symbolize_modules[module].base = start - offset;
+
+    if (exec && __kassert_symbolize_ranges_count < RANGES_MAX)
+        __kassert_symbolize_ranges[__kassert_symbolize_ranges_count++] = (kassert_symbolize_range_t)
+        {
+            .start = start,
+            .end = stop,
+            .module = module
+        };
+}
+
+/* Streams /proc/self/maps by read(2), fopen would allocate */
+static void __kassert_symbolize_maps_read(void)
+{
+    const int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    __kassert_symbolize_ranges_count = 0;
+
+    char buf[MAPS_BUF_SIZE];
+    size_t len = 0;
+    bool skip = false;
+
+    for (;;)
+    {
+        const ssize_t ret = read(fd, buf + len, sizeof(buf) - len);
+        if (ret <= 0)
+            break;
+
+        len += (size_t)ret;
+
+        const char* line = buf;
+        const char* end = buf + len;
+        const char* nl;
+        while ((nl = memchr(line, '\n', (size_t)(end - line))) != NULL)
+        {
+            if (!skip)
+                __kassert_symbolize_maps_line(line, nl);
+
+            skip = false;
+            line = nl + 1;
+        }
+
+        /* Keep the unfinished line, line longer than the buffer is dropped */
+        len = (size_t)(end - line);
+        if (len == sizeof(buf))
+        {
+            len = 0;
+            skip = true;
+        }
+        else
+            memmove(buf, line, len);
+    }
+
+    close(fd);
+}
+
+static const kassert_symbolize_range_t* __kassert_symbolize_range_find(uintptr_t addr)
+{
+    for (size_t i = 0; i < __kassert_symbolize_ranges_count; ++i)
+        if (addr >= __kassert_symbolize_ranges[i].start && addr < __kassert_symbolize_ranges[i].end)
+            return &__kassert_symbolize_ranges[i];
+
+    return NULL;
+}
+
+static void __kassert_symbolize_frame(kassert_report_t* report, size_t n, uintptr_t addr, bool* maps_read)
+{
+    __kassert_report_char(report, '#');
+    __kassert_report_uint(report, n);
+    __kassert_report_char(report, ' ');
+    __kassert_report_hex(report, addr);
+
+    /* Return address points after the call, it can be the first instruction of the next line or function */
+    const uintptr_t pc = addr - 1;
+
+    const kassert_symbolize_range_t* range = __kassert_symbolize_range_find(pc);
+    if (range == NULL && !*maps_read)
+    {
+        /* Library can be loaded after the last read */
+        __kassert_symbolize_maps_read();
+        *maps_read = true;
+        range = __kassert_symbolize_range_find(pc);
+    }
+
+    if (range == NULL)
+    {
+        __kassert_report_str(report, " in ??\n");
+        return;
+    }
+
+    kassert_symbolize_module_t* module = &__kassert_symbolize_modules[range->module];
+    if (!module->opened && !module->failed)
+    {
+        module->opened = __kassert_elf_open(&module->elf, module->path);
+        module->failed = !module->opened;
+    }
+
+    kassert_elf_symbol_t sym = { 0 };
+    if (module->opened)
+        (void)__kassert_elf_lookup(&module->elf, pc - (module->base - module->elf.load_vaddr), &sym);
+
+    __kassert_report_str(report, " in ");
+    if (sym.func != NULL)
+    {
+        __kassert_report_str(report, sym.func);
+        __kassert_report_char(report, '+');
+        __kassert_report_hex(report, sym.func_offset + 1);
+    }
+    else
+        __kassert_report_str(report, "??");
+
+    if (sym.line != 0 && sym.file != NULL)
+    {
+        __kassert_report_str(report, " at ");
+        if (sym.dir != NULL && sym.file[0] != '/')
+        {
+            __kassert_report_str(report, sym.dir);
+            __kassert_report_char(report, '/');
+        }
+
+        __kassert_report_str(report, sym.file);
+        __kassert_report_char(report, ':');
+        __kassert_report_uint(report, sym.line);
+    }
+
+    __kassert_report_str(report, " (");
+    __kassert_report_str(report, module->path);
+    __kassert_report_str(report, ")\n");
+}
+
+/* Raw frame of dl_iterate_phdr, module is found by the executable segment */
+typedef struct kassert_symbolize_raw
+{
+    uintptr_t   pc;
+    uintptr_t   bias;
+    const char* path;
+    bool        found;
+} kassert_symbolize_raw_t;
+
+static int __kassert_symbolize_raw_module(struct dl_phdr_info* info, size_t size, void* data)
+{
+    (void)size;
+
+    kassert_symbolize_raw_t* raw = data;
+
+    for (size_t i = 0; i < info->dlpi_phnum; ++i)
+    {
+        const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type != PT_LOAD || (phdr->p_flags & PF_X) == 0)
+            continue;
+
+        const uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+        if (raw->pc >= start && raw->pc < start + phdr->p_memsz)
+        {
+            raw->bias = info->dlpi_addr;
+            raw->path = info->dlpi_name;
+            raw->found = true;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Without own tables: module and its virtual address (addr2line -e module), the executable has empty name */
+static void __kassert_symbolize_raw_frame(kassert_report_t* report, size_t n, uintptr_t addr)
+{
+    __kassert_report_char(report, '#');
+    __kassert_report_uint(report, n);
+    __kassert_report_char(report, ' ');
+    __kassert_report_hex(report, addr);
+
+    kassert_symbolize_raw_t raw = { .pc = addr - 1, .bias = 0, .path = NULL, .found = false };
+    (void)dl_iterate_phdr(__kassert_symbolize_raw_module, &raw);
+
+    if (!raw.found)
+    {
+        __kassert_report_str(report, " in ??\n");
+        return;
+    }
+
+    char exe[MODULE_PATH_MAX];
+    if (raw.path == NULL || raw.path[0] == '\0')
+    {
+        const ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        exe[len > 0 ? len : 0] = '\0';
+        raw.path = exe;
+    }
+
+    __kassert_report_str(report, " in ?? (");
+    __kassert_report_str(report, raw.path);
+    __kassert_report_char(report, '+');
+    __kassert_report_hex(report, addr - raw.bias);
+    __kassert_report_str(report, ")\n");
+}
+
+static void __attribute__ (( constructor )) __kassert_symbolize_init(void)
+{
+    const char* env = getenv("KASSERT_SYMBOLIZE");
+    __kassert_symbolize_disabled = env != NULL && strcmp(env, "0") == 0;
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_symbolize_frames(kassert_report_t* report, void* const* frames, size_t count)
+{
+    if (__kassert_symbolize_disabled || !__kassert_symbolize_trylock())
+    {
+        for (size_t i = 0; i < count; ++i)
+            __kassert_symbolize_raw_frame(report, i, (uintptr_t)frames[i]);
+
+        return;
+    }
+
+    bool maps_read = false;
+    for (size_t i = 0; i < count; ++i)
+        __kassert_symbolize_frame(report, i, (uintptr_t)frames[i], &maps_read);
+
+    __kassert_symbolize_unlock();
+}
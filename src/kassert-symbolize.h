@@ -0,0 +1,34 @@
+#ifndef KASSERT_SYMBOLIZE_H
+#define KASSERT_SYMBOLIZE_H
+
+/*
+    This is the private header for the KAssert library sources.
+    In-process symbolizer of stack traces, so neither -rdynamic nor addr2line is needed.
+
+    Executable ranges come from /proc/self/maps (read again when address is not found, i.e. after dlopen).
+    Modules (the executable and shared objects) are mmaped on the first frame inside them
+    and resolved by kassert-elf.h: function+offset from .symtab, file:line from .debug_line (-g).
+
+    Tables of modules are static, so there is no heap growth per frame. Async-signal-safe.
+    When symbolizer is busy (i.e. failure in signal handler during symbolization)
+    or KASSERT_SYMBOLIZE=0 is set, frames are raw: module and virtual address of the frame (for addr2line).
+    Frames go to the report buffer, they are written by the flush of the caller.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stddef.h>
+
+#include "kassert-report.h"
+
+/*
+    Prints frames one per line:
+    #N 0xADDR in func+0xOFF at dir/file:line (module)
+    #N 0xADDR in ?? (module+0xVADDR) for raw frames
+    Unknown parts are printed as ?? or skipped.
+*/
+void __kassert_symbolize_frames(kassert_report_t* report, void* const* frames, size_t count);
+
+#endif
@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-internal.h"
+#include "kassert-report.h"
+#include "kassert-symbolize.h"
+
+#define THREADS_MAX             256
+#define FRAMES_MAX              64
+#define TIMEOUT_MS_DEFAULT      100
+#define SIGNAL_RTMIN_OFFSET     4
+
+/* Winner checks slots with this period */
+#define POLL_NS                 100000L
+
+#define DENTS_BUF_SIZE          4096
+#define COMM_SIZE               32
+#define PATH_SIZE               64
+
+#define NSEC_PER_SEC            1000000000ULL
+#define NSEC_PER_MSEC           1000000ULL
+
+typedef enum KASSERT_SLOT_STATE
+{
+    KASSERT_SLOT_PENDING,   /* signal is sent, waiting for the handler */
+    KASSERT_SLOT_DONE,      /* frames are stored */
+    KASSERT_SLOT_GONE       /* thread exited before signal */
+} KASSERT_SLOT_STATE;
+
+/* Stack of one thread, filled by signal handler of this thread */
+typedef struct kassert_thread_slot
+{
+    pid_t              tid;
+    KASSERT_SLOT_STATE state;
+    unsigned int       frames_count;
+    void*              frames[FRAMES_MAX];
+} kassert_thread_slot_t;
+
+/* linux_dirent64, glibc does not declare it */
+typedef struct kassert_dirent64
+{
+    unsigned long long d_ino;
+    long long          d_off;
+    unsigned short     d_reclen;
+    unsigned char      d_type;
+    char               d_name[];
+} kassert_dirent64_t;
+
+/* Thread which reports the failure, 0 when there is no failure */
+static pid_t __kassert_failure_owner;
+
+static bool         __kassert_threads_enabled;
+static int          __kassert_threads_signo;
+static unsigned int __kassert_threads_timeout_ms = TIMEOUT_MS_DEFAULT;
+
+/* Handler stores frames only when capture is in progress */
+static bool                  __kassert_threads_capturing;
+static kassert_thread_slot_t __kassert_threads_slots[THREADS_MAX];
+static size_t                __kassert_threads_slots_count;
+static size_t                __kassert_threads_skipped;
+
+static void __kassert_threads_signal(int signo);
+static void __kassert_threads_enumerate(pid_t self);
+static unsigned long long __kassert_threads_now_ns(void);
+static void __kassert_threads_wait(void);
+static void __kassert_threads_print_name(kassert_report_t* report, pid_t tid);
+
+static void __kassert_threads_signal(int signo)
+{
+    (void)signo;
+
+    if (!__atomic_load_n(&__kassert_threads_capturing, __ATOMIC_ACQUIRE))
+        return;
+
+    const int saved_errno = errno;
+    const pid_t tid = kassert_gettid();
+
+    for (size_t i = 0; i < __kassert_threads_slots_count; ++i)
+    {
+        kassert_thread_slot_t* slot = &__kassert_threads_slots[i];
+        if (slot->tid != tid || __atomic_load_n(&slot->state, __ATOMIC_RELAXED) != KASSERT_SLOT_PENDING)
+            continue;
+
+        slot->frames_count = (unsigned int)kassert_backtrace(slot->frames, FRAMES_MAX);
+        __atomic_store_n(&slot->state, KASSERT_SLOT_DONE, __ATOMIC_RELEASE);
+        break;
+    }
+
+    errno = saved_errno;
+}
+
+/* Reads /proc/self/task by getdents64, opendir would allocate */
+static void __kassert_threads_enumerate(pid_t self)
+{
+    __kassert_threads_slots_count = 0;
+    __kassert_threads_skipped = 0;
+
+    const int fd = open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    char buf[DENTS_BUF_SIZE] __attribute__(( aligned(8) ));
+    for (;;)
+    {
+        const long len = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        if (len <= 0)
+            break;
+
+        for (long pos = 0; pos < len;)
+        {
+            const kassert_dirent64_t* dent = (const kassert_dirent64_t *)(void *)(buf + pos);
+            pos += dent->d_reclen;
+
+            pid_t tid = 0;
+            const char* c = dent->d_name;
+            for (; *c >= '0' && *c <= '9'; ++c)
+                tid = tid * 10 + (*c - '0');
+
+            /* . and .. */
+            if (*c != '\0' || tid == 0 || tid == self)
+                continue;
+
+            if (__kassert_threads_slots_count == THREADS_MAX)
+            {
+                ++__kassert_threads_skipped;
+                continue;
+            }
+
+            kassert_thread_slot_t* slot = &__kassert_threads_slots[__kassert_threads_slots_count++];
+            slot->tid = tid;
+            slot->state = KASSERT_SLOT_PENDING;
+            slot->frames_count = 0;
+        }
+    }
+
+    close(fd);
+}
+
+static unsigned long long __kassert_threads_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * NSEC_PER_SEC + (unsigned long long)ts.tv_nsec;
+}
+
+/* Waits until every thread stored its frames or timeout expired */
+static void __kassert_threads_wait(void)
+{
+    const unsigned long long deadline = __kassert_threads_now_ns() + __kassert_threads_timeout_ms * NSEC_PER_MSEC;
+    const struct timespec poll = { .tv_sec = 0, .tv_nsec = POLL_NS };
+
+    do {
+        bool pending = false;
+        for (size_t i = 0; i < __kassert_threads_slots_count; ++i)
+            if (__atomic_load_n(&__kassert_threads_slots[i].state, __ATOMIC_ACQUIRE) == KASSERT_SLOT_PENDING)
+            {
+                pending = true;
+                break;
+            }
+
+        if (!pending)
+            return;
+
+        nanosleep(&poll, NULL);
+    } while (__kassert_threads_now_ns() < deadline);
+}
+
+/* Name from /proc/self/task/<tid>/comm */
+static void __kassert_threads_print_name(kassert_report_t* report, pid_t tid)
+{
+    char path[PATH_SIZE] = "/proc/self/task/";
+    size_t len = strlen(path);
+
+    char digits[16];
+    size_t digits_count = 0;
+    for (pid_t t = tid; t > 0 && digits_count < sizeof(digits); t /= 10)
+        digits[digits_count++] = (char)('0' + t % 10);
+
+    while (digits_count > 0)
+        path[len++] = digits[--digits_count];
+
+    memcpy(path + len, "/comm", sizeof("/comm"));
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    char comm[COMM_SIZE];
+    const ssize_t ret = read(fd, comm, sizeof(comm) - 1);
+    close(fd);
+
+    if (ret <= 0)
+        return;
+
+    size_t comm_len = (size_t)ret;
+    if (comm[comm_len - 1] == '\n')
+        --comm_len;
+
+    comm[comm_len] = '\0';
+
+    __kassert_report_str(report, " (");
+    __kassert_report_str(report, comm);
+    __kassert_report_char(report, ')');
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void __kassert_threads_init(void)
+{
+    const char* timeout = getenv("KASSERT_ALL_THREADS_TIMEOUT_MS");
+    if (timeout != NULL)
+        __kassert_threads_timeout_ms = (unsigned int)strtoul(timeout, NULL, 10);
+
+    const char* enable = getenv("KASSERT_ALL_THREADS");
+    if (enable == NULL || strcmp(enable, "1") != 0)
+        return;
+
+    const char* signo = getenv("KASSERT_ALL_THREADS_SIGNAL");
+    (void)kassert_all_threads_enable(true, signo == NULL ? 0 : atoi(signo));
+}
+
+void __kassert_failure_elect(void)
+{
+    const pid_t self = kassert_gettid();
+
+    pid_t owner = 0;
+    if (__atomic_compare_exchange_n(&__kassert_failure_owner, &owner, self, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return;
+
+    /* Failure during the report of this thread (i.e. in signal handler), let it report */
+    if (owner == self)
+        return;
+
+    /* Winner terminates the process, signals still run so stack of this thread can be captured */
+    for (;;)
+        pause();
+}
+
+void __kassert_threads_dump(kassert_report_t* report)
+{
+    if (!__atomic_load_n(&__kassert_threads_enabled, __ATOMIC_ACQUIRE))
+        return;
+
+    /* The second failure in this thread (during capture) does not capture again */
+    if (__atomic_load_n(&__kassert_threads_capturing, __ATOMIC_ACQUIRE))
+        return;
+
+    const pid_t self = kassert_gettid();
+    const pid_t pid = getpid();
+
+    __kassert_threads_enumerate(self);
+    __atomic_store_n(&__kassert_threads_capturing, true, __ATOMIC_RELEASE);
+
+    for (size_t i = 0; i < __kassert_threads_slots_count; ++i)
+        if (syscall(SYS_tgkill, pid, __kassert_threads_slots[i].tid, __kassert_threads_signo) != 0)
+            __atomic_store_n(&__kassert_threads_slots[i].state, KASSERT_SLOT_GONE, __ATOMIC_RELEASE);
+
+    __kassert_threads_wait();
+
+    __kassert_report_str(report, "Other threads: ");
+    __kassert_report_uint(report, __kassert_threads_slots_count + __kassert_threads_skipped);
+    __kassert_report_char(report, '\n');
+
+    for (size_t i = 0; i < __kassert_threads_slots_count; ++i)
+    {
+        const kassert_thread_slot_t* slot = &__kassert_threads_slots[i];
+        const KASSERT_SLOT_STATE state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+        if (state == KASSERT_SLOT_GONE)
+            continue;
+
+        __kassert_report_str(report, "ThreadID: ");
+        __kassert_report_int(report, slot->tid);
+        __kassert_threads_print_name(report, slot->tid);
+        __kassert_report_char(report, '\n');
+
+        if (state != KASSERT_SLOT_DONE)
+        {
+            __kassert_report_str(report, "Stacktrace: not captured (signal is blocked or thread did not answer in time)\n");
+            continue;
+        }
+
+        /* The first frame is the signal handler */
+        __kassert_report_str(report, "Stacktrace:\n");
+        if (slot->frames_count > 1)
+            __kassert_symbolize_frames(report, slot->frames + 1, slot->frames_count - 1);
+    }
+
+    if (__kassert_threads_skipped > 0)
+    {
+        __kassert_report_uint(report, __kassert_threads_skipped);
+        __kassert_report_str(report, " threads are not captured (too many threads)\n");
+    }
+}
+
+bool kassert_all_threads_enable(bool enable, int signo)
+{
+    if (!enable)
+    {
+        __atomic_store_n(&__kassert_threads_enabled, false, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    if (signo == 0)
+        signo = SIGRTMIN + SIGNAL_RTMIN_OFFSET;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = __kassert_threads_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(signo, &sa, NULL) != 0)
+        return false;
+
+    __kassert_threads_signo = signo;
+    __atomic_store_n(&__kassert_threads_enabled, true, __ATOMIC_RELEASE);
+
+    return true;
+}
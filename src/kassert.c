@@ -1,94 +1,299 @@
-#include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
-#include <execinfo.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <sys/syscall.h>
-#include <stdint.h>
 
 #include <kassert/kassert.h>
 
-#define EXIT()             exit(1)
+#include "kassert-internal.h"
+#include "kassert-report.h"
+#include "kassert-symbolize.h"
+
 #define CALLSTACK_SIZE_MAX 256
 
-static void __kassert_print_backtrace(void);
-static void __kassert_print_threadid(void);
+/* Hexdump of KASSERT_MEM_* failure, rows before and after the row with difference */
+#define MEM_DUMP_ROW       16
+#define MEM_DUMP_CONTEXT   2
+
+static void __kassert_print_backtrace(kassert_report_t* report);
+static void __kassert_print_threadid(kassert_report_t* report);
+static void __kassert_print_assertion(kassert_report_t* report, const kassert_site_t* site);
+static void __attribute__ (( noreturn )) __kassert_exit(kassert_report_t* report);
+static void __kassert_print_mem_bytes(kassert_report_t* report,
+                                      const unsigned char* ptr1,
+                                      const unsigned char* ptr2,
+                                      unsigned char byte,
+                                      size_t row,
+                                      size_t len,
+                                      bool expected);
+static void __attribute__ (( constructor )) __kassert_init(void);
 
-static void __kassert_print_backtrace(void)
+/* Library initialization, everything what allocates or loads libraries is done here, not in the failure path */
+static void __attribute__ (( constructor )) __kassert_init(void)
+{
+    __kassert_stack_init();
+    __kassert_clock_init();
+    __kassert_profile_init();
+    __kassert_control_init();
+    __kassert_crash_init();
+    __kassert_threads_init();
+    __kassert_policy_init();
+    __kassert_owner_init();
+}
+
+/* Frames are resolved in process (see kassert-symbolize.h), backtrace_symbols would malloc the result */
+static void __kassert_print_backtrace(kassert_report_t* report)
 {
     void* callstack[CALLSTACK_SIZE_MAX];
-    int frames = backtrace(callstack, CALLSTACK_SIZE_MAX);
-    if (frames < 0)
-        return;
+    const size_t frames = kassert_backtrace(callstack, CALLSTACK_SIZE_MAX);
 
-    char** strs = backtrace_symbols(callstack, frames);
-    if (strs == NULL)
-        return;
+    __kassert_report_str(report, "Stacktrace:\n");
+    __kassert_symbolize_frames(report, callstack, frames);
+}
 
-    fprintf(stderr, "Stacktrace:\n");
-    for (int i = 0; i < frames; ++i)
-        fprintf(stderr, "%s\n", strs[i]);
+static void __kassert_print_threadid(kassert_report_t* report)
+{
+    const pid_t id = kassert_gettid();
 
-    free(strs);
+    __kassert_report_str(report, "ThreadID: ");
+    __kassert_report_int(report, id);
+    __kassert_report_char(report, '\n');
 }
 
-static void __kassert_print_threadid(void)
+/* Prints location and expression of the site, without the new line */
+static void __kassert_print_assertion(kassert_report_t* report, const kassert_site_t* site)
 {
-    pid_t id = (pid_t)syscall(__NR_gettid);
+    __kassert_report_str(report, site->file);
+    __kassert_report_char(report, ':');
+    __kassert_report_int(report, site->line);
+    __kassert_report_str(report, ": ");
+    __kassert_report_str(report, site->func);
+    __kassert_report_str(report, ": Assertion \'");
+    __kassert_report_str(report, site->expr);
+    __kassert_report_str(report, "\' failed.");
+}
+
+/* Prints ThreadID and stacktrace after the assertion line and terminates the program */
+static void __attribute__ (( noreturn )) __kassert_exit(kassert_report_t* report)
+{
+    /* Interposed malloc does not fail again when exit handlers or the policy allocate */
+    __kassert_noalloc_disable();
+
+    /* PRINT ThreadID */
+    __kassert_print_threadid(report);
+
+    /* PRINT context breadcrumbs of this thread */
+    __kassert_context_dump(report);
 
-    fprintf(stderr, "ThreadID: %d\n", id);
+    /* FORK_ABORT policy, parent exits here and child (without other threads) finishes the report */
+    const bool forked = __kassert_policy_fork(report);
+
+    /* PRINT backtrace */
+    __kassert_print_backtrace(report);
+
+    /* PRINT stacks of other threads (all-threads mode) */
+    if (!forked)
+        __kassert_threads_dump(report);
+
+    /* Whole report is one write (FORK_ABORT: the part before the fork is written by the parent), complete before any policy */
+    __kassert_report_flush(report);
+
+    __kassert_policy_terminate();
+}
+
+/* One row of hexdump, differing bytes are marked by > */
+static void __kassert_print_mem_bytes(kassert_report_t* report,
+                                      const unsigned char* ptr1,
+                                      const unsigned char* ptr2,
+                                      unsigned char byte,
+                                      size_t row,
+                                      size_t len,
+                                      bool expected)
+{
+    for (size_t i = row; i < row + MEM_DUMP_ROW; ++i)
+    {
+        if (i >= len)
+        {
+            __kassert_report_str(report, "   ");
+            continue;
+        }
+
+        const unsigned char expected_byte = ptr2 != NULL ? ptr2[i] : byte;
+        __kassert_report_char(report, ptr1[i] != expected_byte ? '>' : ' ');
+        __kassert_report_hex_pad(report, expected ? expected_byte : ptr1[i], 2);
+    }
 }
 
 /***** GLOBAL FUNCTIONS *****/
-void __attribute__(( format(printf, 2, 3) )) __attribute__ ((noreturn))
-__kassert_print_and_exit(bool need_free, const char* fmt, ...)
+void __attribute__ ((cold, noreturn)) __kassert_print_and_exit(const kassert_site_t* site, ...)
 {
+    /* Failure path cannot use heap and stdio, we can be in signal handler or in malloc */
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
+
+    const KASSERT_PRIMITIVES types[2] = { site->val1_type, site->val2_type };
+    kassert_value_t vals[2];
+    size_t vals_count = 0;
+
+    if (site->op_str != NULL)
+    {
+        va_list args;
+        va_start(args, site);
+
+        __kassert_value_fetch(site->val1_type, &args, &vals[0]);
+        __kassert_value_fetch(site->val2_type, &args, &vals[1]);
+        vals_count = 2;
+
+        va_end(args);
+    }
+
+    /* Record goes first, stderr can be lost */
+    __kassert_crash_record(site, __builtin_return_address(0), KASSERT_CRASH_KIND_ASSERT, 0, types, vals, vals_count);
+
+    /* Only the first failing thread reports, so reports do not interleave */
+    __kassert_failure_elect();
+
     /* PRINT assertion */
-    va_list args;
-    va_start(args, fmt);
+    __kassert_print_assertion(&report, site);
 
-    vfprintf(stderr, fmt, args);
-    va_end(args);
+    if (vals_count != 0)
+    {
+        __kassert_report_str(&report, " (");
+        __kassert_report_value(&report, site->val1_type, &vals[0]);
+        __kassert_report_char(&report, ' ');
+        __kassert_report_str(&report, site->op_str);
+        __kassert_report_char(&report, ' ');
+        __kassert_report_value(&report, site->val2_type, &vals[1]);
+        __kassert_report_char(&report, ')');
+    }
+    __kassert_report_char(&report, '\n');
 
-    /* fmt is in heap not in rodata / text section */
-    if (need_free)
-        free((void *)(uintptr_t)fmt); /* bad cast, but I want to keep const char* fmt like in printf */
+    __kassert_exit(&report);
+}
 
-    /* PRINT ThreadID */
-    __kassert_print_threadid();
+void __attribute__ ((cold, noreturn)) __kassert_array_fail(const kassert_site_t* site,
+                                                           size_t index,
+                                                           const void* array,
+                                                           const void* bound1,
+                                                           const void* bound2)
+{
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
 
-    /* PRINT backtrace */
-    __kassert_print_backtrace();
+    const size_t size = __kassert_value_size(site->val1_type);
+    const KASSERT_PRIMITIVES types[3] = { site->val1_type, site->val1_type, site->val1_type };
+
+    /* Failed element, then bounds (or the next element for SORTED) */
+    kassert_value_t vals[3];
+    size_t vals_count = 2;
+
+    __kassert_value_load(site->val1_type, (const char *)array + index * size, &vals[0]);
+
+    switch (site->array_op)
+    {
+        case KASSERT_ARRAY_OP_IN_RANGE:
+            __kassert_value_load(site->val1_type, bound1, &vals[1]);
+            __kassert_value_load(site->val1_type, bound2, &vals[2]);
+            vals_count = 3;
+            break;
+        case KASSERT_ARRAY_OP_SORTED:
+            __kassert_value_load(site->val1_type, (const char *)array + (index + 1) * size, &vals[1]);
+            break;
+        case KASSERT_ARRAY_OP_FINITE:
+            vals_count = 1;
+            break;
+        case KASSERT_ARRAY_OP_NONE:
+        case KASSERT_ARRAY_OP_EQ:
+        case KASSERT_ARRAY_OP_NEQ:
+        case KASSERT_ARRAY_OP_LT:
+        case KASSERT_ARRAY_OP_LEQ:
+        case KASSERT_ARRAY_OP_GT:
+        case KASSERT_ARRAY_OP_GEQ:
+        default:
+            __kassert_value_load(site->val1_type, bound1, &vals[1]);
+            break;
+    }
+
+    __kassert_crash_record(site, __builtin_return_address(0), KASSERT_CRASH_KIND_ARRAY, index, types, vals, vals_count);
 
-    /* exit instead of abort to clean program properly */
-    EXIT();
+    /* Only the first failing thread reports, so reports do not interleave */
+    __kassert_failure_elect();
+
+    /* PRINT assertion and failed element */
+    __kassert_print_assertion(&report, site);
+
+    __kassert_report_str(&report, " (index ");
+    __kassert_report_uint(&report, index);
+    __kassert_report_str(&report, ": ");
+    __kassert_report_value(&report, site->val1_type, &vals[0]);
+
+    if (site->array_op == KASSERT_ARRAY_OP_IN_RANGE)
+    {
+        __kassert_report_str(&report, " not in [");
+        __kassert_report_value(&report, site->val1_type, &vals[1]);
+        __kassert_report_str(&report, ", ");
+        __kassert_report_value(&report, site->val1_type, &vals[2]);
+        __kassert_report_char(&report, ']');
+    }
+    else if (vals_count == 2)
+    {
+        __kassert_report_char(&report, ' ');
+        __kassert_report_str(&report, site->op_str);
+        __kassert_report_char(&report, ' ');
+        __kassert_report_value(&report, site->val1_type, &vals[1]);
+    }
+    __kassert_report_str(&report, ")\n");
+
+    __kassert_exit(&report);
 }
 
-/* We need to create printf fmt from "dynamic" partial format */
-const char* __kassert_create_print_fmt(const char* label,
-                                       const char* val1_fmt,
-                                       const char* op,
-                                       const char* val2_fmt)
+void __attribute__ ((cold, noreturn)) __kassert_mem_fail(const kassert_site_t* site,
+                                                         size_t offset,
+                                                         const void* ptr1,
+                                                         const void* ptr2,
+                                                         size_t len,
+                                                         unsigned char byte)
 {
-    /* Calculate how many chars we need to write as fmt */
-    size_t len = (size_t)snprintf(NULL,
-                                  0,
-                                  "%%s:%%d: %%s: Assertion \'%s\' failed. (%s %s %s)\\n",
-                                  label,
-                                  val1_fmt,
-                                  op,
-                                  val2_fmt);
-
-    /* Len calculated so alloc it, it will protect us against multithreading (static buffor is a bad idea) */
-    char* buf = malloc(len);
-    snprintf(buf,
-             len,
-             "%%s:%%d: %%s: Assertion \'%s\' failed. (%s %s %s)\n",
-             label,
-             val1_fmt,
-             op,
-             val2_fmt);
-
-    return buf;
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
+
+    const unsigned char* const actual = ptr1;
+    const unsigned char* const expected = ptr2;
+    const unsigned char expected_byte = expected != NULL ? expected[offset] : byte;
+
+    const KASSERT_PRIMITIVES types[2] = { KASSERT_PRIMITIVES_UNSIGNED_CHAR, KASSERT_PRIMITIVES_UNSIGNED_CHAR };
+    const kassert_value_t vals[2] = { { .u = actual[offset] }, { .u = expected_byte } };
+    __kassert_crash_record(site, __builtin_return_address(0), KASSERT_CRASH_KIND_MEM, offset, types, vals, 2);
+
+    /* Only the first failing thread reports, so reports do not interleave */
+    __kassert_failure_elect();
+
+    /* PRINT assertion and the first differing byte */
+    __kassert_print_assertion(&report, site);
+
+    __kassert_report_str(&report, " (offset ");
+    __kassert_report_uint(&report, offset);
+    __kassert_report_str(&report, ": 0x");
+    __kassert_report_hex_pad(&report, actual[offset], 2);
+    __kassert_report_str(&report, " != 0x");
+    __kassert_report_hex_pad(&report, expected_byte, 2);
+    __kassert_report_str(&report, ")\n");
+
+    /* PRINT hexdump of rows around the difference, columns are aligned with bytes */
+    const size_t row = offset - offset % MEM_DUMP_ROW;
+    const size_t first = row > MEM_DUMP_CONTEXT * MEM_DUMP_ROW ? row - MEM_DUMP_CONTEXT * MEM_DUMP_ROW : 0;
+    const size_t last = row + MEM_DUMP_CONTEXT * MEM_DUMP_ROW;
+
+    __kassert_report_str(&report, "    offset   actual                                            expected\n");
+    for (size_t r = first; r <= last && r < len; r += MEM_DUMP_ROW)
+    {
+        __kassert_report_str(&report, "    ");
+        __kassert_report_hex_pad(&report, r, 8);
+        __kassert_print_mem_bytes(&report, actual, expected, byte, r, len, false);
+        __kassert_report_str(&report, "  ");
+        __kassert_print_mem_bytes(&report, actual, expected, byte, r, len, true);
+        __kassert_report_char(&report, '\n');
+    }
+
+    __kassert_exit(&report);
 }
@@ -0,0 +1,109 @@
+/*
+    Interposer of the allocator for KASSERT_NO_ALLOC regions (libkassert-noalloc.a).
+    Every call is counted in thread-local counters and checked against depth of the region,
+    then it is forwarded to glibc by __libc_* entry points, so there is no dlsym and no recursion.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <malloc.h>
+
+#include <kassert/kassert.h>
+
+/* glibc entry points, they are not declared in headers */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void  __libc_free(void* ptr);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+/* Tells libkassert.a that the interposer is linked (weak reference there) */
+extern const bool __kassert_noalloc_interposer;
+const bool __kassert_noalloc_interposer = true;
+
+static inline void __kassert_noalloc_alloc(const char* fn, size_t size);
+
+/* Counts the allocation, fails when the calling thread is in the region */
+static inline void __kassert_noalloc_alloc(const char* fn, size_t size)
+{
+    ++__kassert_alloc_counters.allocs;
+    __kassert_alloc_counters.bytes += size;
+
+    if (__builtin_expect(__kassert_noalloc_depth != 0, 0))
+        __kassert_noalloc_fail(fn, size);
+}
+
+/***** GLOBAL FUNCTIONS *****/
+void* malloc(size_t size)
+{
+    __kassert_noalloc_alloc("malloc", size);
+
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    size_t bytes;
+    if (__builtin_mul_overflow(n, size, &bytes))
+        bytes = SIZE_MAX;
+
+    __kassert_noalloc_alloc("calloc", bytes);
+
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    __kassert_noalloc_alloc("realloc", size);
+
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    ++__kassert_alloc_counters.frees;
+
+    if (__builtin_expect(__kassert_noalloc_depth != 0, 0))
+        __kassert_noalloc_fail_free(ptr);
+
+    __libc_free(ptr);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    __kassert_noalloc_alloc("posix_memalign", size);
+
+    /* Power of 2 and multiple of sizeof(void *) */
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    void* mem = __libc_memalign(alignment, size);
+    if (mem == NULL)
+        return ENOMEM;
+
+    *ptr = mem;
+
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    __kassert_noalloc_alloc("aligned_alloc", size);
+
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    __kassert_noalloc_alloc("memalign", size);
+
+    return __libc_memalign(alignment, size);
+}
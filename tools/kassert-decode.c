@@ -0,0 +1,429 @@
+/*
+    kassert-decode - renders records of the crash-record file (see kassert-crash.h).
+
+    Usage: kassert-decode <crash file> [binary]
+
+    Objects from the file header are mmaped from their paths and used only when build-id matches.
+    Optional binary replaces path of the executable (i.e. copy with debug info on the developer machine).
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+    LICENCE: GPL3
+*/
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <kassert/kassert.h>
+
+#include "kassert-elf.h"
+#include "kassert-report.h"
+#include "kassert-crash-record.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+
+typedef struct kassert_decode_module
+{
+    const kassert_crash_module_t* info;
+    const char*                   path;
+    kassert_elf_t                 elf;
+    bool                          opened;
+} kassert_decode_module_t;
+
+static kassert_decode_module_t __kassert_decode_modules[KASSERT_CRASH_MODULES_MAX];
+static size_t                  __kassert_decode_modules_count;
+
+static void __kassert_decode_usage(const char* name);
+static void __kassert_decode_build_id(kassert_report_t* report, const unsigned char* id, size_t size);
+static void __kassert_decode_modules_open(const kassert_crash_header_t* header, const char* binary);
+static kassert_decode_module_t* __kassert_decode_module_find(uint64_t addr);
+static const char* __kassert_decode_site_str(const kassert_elf_t* elf, uintptr_t vaddr);
+static bool __kassert_decode_site(uint64_t addr, kassert_site_t* site);
+static void __kassert_decode_values(kassert_report_t* report, const kassert_crash_record_t* record, const kassert_site_t* site);
+static void __kassert_decode_frame(kassert_report_t* report, size_t n, uint64_t addr);
+static void __kassert_decode_record(kassert_report_t* report, const kassert_crash_record_t* record);
+static int __kassert_decode_record_cmp(const void* a, const void* b);
+
+static void __kassert_decode_usage(const char* name)
+{
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
+
+    __kassert_report_str(&report, "Usage: ");
+    __kassert_report_str(&report, name);
+    __kassert_report_str(&report, " <crash file> [binary]\n");
+    __kassert_report_flush(&report);
+}
+
+static void __kassert_decode_build_id(kassert_report_t* report, const unsigned char* id, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        __kassert_report_hex_pad(report, id[i], 2);
+}
+
+/* Module is used only when build-id of the file is the same like build-id of the loaded object */
+static void __kassert_decode_modules_open(const kassert_crash_header_t* header, const char* binary)
+{
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
+
+    const size_t count = header->modules_count < KASSERT_CRASH_MODULES_MAX ? header->modules_count : KASSERT_CRASH_MODULES_MAX;
+    for (size_t i = 0; i < count; ++i)
+    {
+        kassert_decode_module_t* module = &__kassert_decode_modules[i];
+        module->info = &header->modules[i];
+        module->path = i == 0 && binary != NULL ? binary : module->info->path;
+
+        /* Path is not NUL terminated when file is broken */
+        if (memchr(module->info->path, '\0', sizeof(module->info->path)) == NULL)
+            continue;
+
+        if (!__kassert_elf_open(&module->elf, module->path))
+        {
+            __kassert_report_str(&report, "kassert-decode: cannot open ");
+            __kassert_report_str(&report, module->path);
+            __kassert_report_str(&report, ", frames are not symbolized\n");
+            continue;
+        }
+
+        const unsigned char* id;
+        size_t id_size;
+        const size_t expected_size = module->info->build_id_size < KASSERT_CRASH_BUILD_ID_MAX ? module->info->build_id_size : KASSERT_CRASH_BUILD_ID_MAX;
+
+        if (expected_size != 0 &&
+            (!__kassert_elf_build_id(&module->elf, &id, &id_size) ||
+             (id_size < expected_size ? id_size : expected_size) != expected_size ||
+             memcmp(id, module->info->build_id, expected_size) != 0))
+        {
+            __kassert_report_str(&report, "kassert-decode: build-id of ");
+            __kassert_report_str(&report, module->path);
+            __kassert_report_str(&report, " does not match ");
+            __kassert_decode_build_id(&report, module->info->build_id, expected_size);
+            __kassert_report_str(&report, ", frames are not symbolized\n");
+
+            __kassert_elf_close(&module->elf);
+            continue;
+        }
+
+        module->opened = true;
+    }
+
+    __kassert_decode_modules_count = count;
+    __kassert_report_flush(&report);
+}
+
+static kassert_decode_module_t* __kassert_decode_module_find(uint64_t addr)
+{
+    for (size_t i = 0; i < __kassert_decode_modules_count; ++i)
+        if (addr >= __kassert_decode_modules[i].info->start && addr < __kassert_decode_modules[i].info->end)
+            return &__kassert_decode_modules[i];
+
+    return NULL;
+}
+
+/* String pointed by the pointer stored at vaddr */
+static const char* __kassert_decode_site_str(const kassert_elf_t* elf, uintptr_t vaddr)
+{
+    uintptr_t ptr;
+    if (!__kassert_elf_vaddr_ptr(elf, vaddr, &ptr) || ptr == 0)
+        return NULL;
+
+    return __kassert_elf_vaddr_str(elf, ptr);
+}
+
+/* Reads descriptor from the file, pointers are replaced by strings from the file (pointer fields not used here are NULL) */
+static bool __kassert_decode_site(uint64_t addr, kassert_site_t* site)
+{
+    kassert_decode_module_t* module = __kassert_decode_module_find(addr);
+    if (module == NULL || !module->opened)
+        return false;
+
+    const uintptr_t vaddr = (uintptr_t)(addr - module->info->bias);
+    const void* raw = __kassert_elf_vaddr(&module->elf, vaddr, sizeof(*site));
+    if (raw == NULL)
+        return false;
+
+    memcpy(site, raw, sizeof(*site));
+
+    site->file = __kassert_decode_site_str(&module->elf, vaddr + offsetof(kassert_site_t, file));
+    site->func = __kassert_decode_site_str(&module->elf, vaddr + offsetof(kassert_site_t, func));
+    site->expr = __kassert_decode_site_str(&module->elf, vaddr + offsetof(kassert_site_t, expr));
+    site->op_str = __kassert_decode_site_str(&module->elf, vaddr + offsetof(kassert_site_t, op_str));
+    site->state = NULL;
+    site->sample_rate = NULL;
+
+    return site->file != NULL && site->func != NULL && site->expr != NULL;
+}
+
+/* The same text like the library prints after the assertion */
+static void __kassert_decode_values(kassert_report_t* report, const kassert_crash_record_t* record, const kassert_site_t* site)
+{
+    kassert_value_t vals[KASSERT_CRASH_VALUES_MAX];
+    KASSERT_PRIMITIVES types[KASSERT_CRASH_VALUES_MAX];
+    const size_t count = record->values_count < KASSERT_CRASH_VALUES_MAX ? record->values_count : KASSERT_CRASH_VALUES_MAX;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        memset(&vals[i], 0, sizeof(vals[i]));
+        memcpy(&vals[i], record->values[i], sizeof(vals[i]) < KASSERT_CRASH_VALUE_SIZE ? sizeof(vals[i]) : KASSERT_CRASH_VALUE_SIZE);
+        types[i] = record->types[i] <= KASSERT_PRIMITIVES_NON_PRIMITIVE ? (KASSERT_PRIMITIVES)record->types[i] : KASSERT_PRIMITIVES_NON_PRIMITIVE;
+    }
+
+    const char* op = site != NULL && site->op_str != NULL ? site->op_str : "?";
+
+    switch ((KASSERT_CRASH_KIND)record->kind)
+    {
+        case KASSERT_CRASH_KIND_ASSERT:
+            if (count < 2)
+                return;
+
+            __kassert_report_str(report, " (");
+            __kassert_report_value(report, types[0], &vals[0]);
+            __kassert_report_char(report, ' ');
+            __kassert_report_str(report, op);
+            __kassert_report_char(report, ' ');
+            __kassert_report_value(report, types[1], &vals[1]);
+            __kassert_report_char(report, ')');
+            break;
+        case KASSERT_CRASH_KIND_ARRAY:
+            __kassert_report_str(report, " (index ");
+            __kassert_report_uint(report, record->aux);
+            __kassert_report_str(report, ": ");
+            if (count > 0)
+                __kassert_report_value(report, types[0], &vals[0]);
+
+            if (count == 3)
+            {
+                __kassert_report_str(report, " not in [");
+                __kassert_report_value(report, types[1], &vals[1]);
+                __kassert_report_str(report, ", ");
+                __kassert_report_value(report, types[2], &vals[2]);
+                __kassert_report_char(report, ']');
+            }
+            else if (count == 2)
+            {
+                __kassert_report_char(report, ' ');
+                __kassert_report_str(report, op);
+                __kassert_report_char(report, ' ');
+                __kassert_report_value(report, types[1], &vals[1]);
+            }
+            __kassert_report_char(report, ')');
+            break;
+        case KASSERT_CRASH_KIND_MEM:
+            if (count < 2)
+                return;
+
+            __kassert_report_str(report, " (offset ");
+            __kassert_report_uint(report, record->aux);
+            __kassert_report_str(report, ": 0x");
+            __kassert_report_hex_pad(report, vals[0].u, 2);
+            __kassert_report_str(report, " != 0x");
+            __kassert_report_hex_pad(report, vals[1].u, 2);
+            __kassert_report_char(report, ')');
+            break;
+        default:
+            break;
+    }
+}
+
+/* The same format like the in-process symbolizer */
+static void __kassert_decode_frame(kassert_report_t* report, size_t n, uint64_t addr)
+{
+    __kassert_report_char(report, '#');
+    __kassert_report_uint(report, n);
+    __kassert_report_char(report, ' ');
+    __kassert_report_hex(report, addr);
+
+    kassert_decode_module_t* module = __kassert_decode_module_find(addr - 1);
+    if (module == NULL)
+    {
+        __kassert_report_str(report, " in ??\n");
+        return;
+    }
+
+    kassert_elf_symbol_t sym = { 0 };
+    if (module->opened)
+        (void)__kassert_elf_lookup(&module->elf, (uintptr_t)(addr - 1 - module->info->bias), &sym);
+
+    __kassert_report_str(report, " in ");
+    if (sym.func != NULL)
+    {
+        __kassert_report_str(report, sym.func);
+        __kassert_report_char(report, '+');
+        __kassert_report_hex(report, sym.func_offset + 1);
+    }
+    else
+        __kassert_report_str(report, "??");
+
+    if (sym.line != 0 && sym.file != NULL)
+    {
+        __kassert_report_str(report, " at ");
+        if (sym.dir != NULL && sym.file[0] != '/')
+        {
+            __kassert_report_str(report, sym.dir);
+            __kassert_report_char(report, '/');
+        }
+
+        __kassert_report_str(report, sym.file);
+        __kassert_report_char(report, ':');
+        __kassert_report_uint(report, sym.line);
+    }
+
+    __kassert_report_str(report, " (");
+    __kassert_report_str(report, module->path);
+    __kassert_report_str(report, ")\n");
+}
+
+static void __kassert_decode_record(kassert_report_t* report, const kassert_crash_record_t* record)
+{
+    kassert_site_t site;
+    const bool site_found = __kassert_decode_site(record->site, &site);
+
+    __kassert_report_str(report, "Record ");
+    __kassert_report_uint(report, record->seq);
+    __kassert_report_char(report, '\n');
+
+    if (site_found)
+    {
+        __kassert_report_str(report, site.file);
+        __kassert_report_char(report, ':');
+        __kassert_report_int(report, site.line);
+        __kassert_report_str(report, ": ");
+        __kassert_report_str(report, site.func);
+        __kassert_report_str(report, ": Assertion \'");
+        __kassert_report_str(report, site.expr);
+        __kassert_report_str(report, "\' failed.");
+    }
+    else
+    {
+        __kassert_report_str(report, "Site ");
+        __kassert_report_hex(report, record->site);
+        if (record->site_id != UINT64_MAX)
+        {
+            __kassert_report_str(report, " (id ");
+            __kassert_report_uint(report, record->site_id);
+            __kassert_report_char(report, ')');
+        }
+        __kassert_report_str(report, ": Assertion failed.");
+    }
+
+    __kassert_decode_values(report, record, site_found ? &site : NULL);
+    __kassert_report_char(report, '\n');
+
+    __kassert_report_str(report, "ThreadID: ");
+    __kassert_report_uint(report, record->tid);
+    __kassert_report_str(report, " Time: ");
+    __kassert_report_uint(report, record->timestamp_ns / NSEC_PER_SEC);
+    __kassert_report_char(report, '.');
+
+    /* Nanoseconds with leading zeros */
+    for (unsigned long long div = NSEC_PER_SEC / 10; div > 0; div /= 10)
+        __kassert_report_char(report, (char)('0' + (record->timestamp_ns / div) % 10));
+
+    __kassert_report_char(report, '\n');
+
+    const size_t frames = record->frames_count < KASSERT_CRASH_FRAMES_MAX ? record->frames_count : KASSERT_CRASH_FRAMES_MAX;
+    if (frames > 0)
+        __kassert_report_str(report, "Stacktrace:\n");
+
+    for (size_t i = 0; i < frames; ++i)
+        __kassert_decode_frame(report, i, record->frames[i]);
+
+    __kassert_report_char(report, '\n');
+}
+
+static int __kassert_decode_record_cmp(const void* a, const void* b)
+{
+    const kassert_crash_record_t* ra = *(const kassert_crash_record_t* const *)a;
+    const kassert_crash_record_t* rb = *(const kassert_crash_record_t* const *)b;
+
+    return (ra->seq > rb->seq) - (ra->seq < rb->seq);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        __kassert_decode_usage(argv[0]);
+        return 1;
+    }
+
+    kassert_report_t report;
+    __kassert_report_init(&report, STDERR_FILENO);
+
+    const int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(kassert_crash_header_t))
+    {
+        __kassert_report_str(&report, "kassert-decode: cannot read ");
+        __kassert_report_str(&report, argv[1]);
+        __kassert_report_char(&report, '\n');
+        __kassert_report_flush(&report);
+        return 1;
+    }
+
+    const size_t size = (size_t)st.st_size;
+    const void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    const kassert_crash_header_t* header = map;
+    if (map == MAP_FAILED ||
+        memcmp(header->magic, KASSERT_CRASH_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != KASSERT_CRASH_VERSION ||
+        header->header_size != sizeof(kassert_crash_header_t) ||
+        header->record_size != sizeof(kassert_crash_record_t) ||
+        (size - sizeof(*header)) / sizeof(kassert_crash_record_t) < header->records_max)
+    {
+        __kassert_report_str(&report, "kassert-decode: ");
+        __kassert_report_str(&report, argv[1]);
+        __kassert_report_str(&report, " is not a crash-record file of this architecture and version\n");
+        __kassert_report_flush(&report);
+        return 1;
+    }
+
+    __kassert_decode_modules_open(header, argc == 3 ? argv[2] : NULL);
+
+    /* Complete records from the oldest */
+    const kassert_crash_record_t* records = (const kassert_crash_record_t *)(header + 1);
+    const kassert_crash_record_t** sorted = calloc(header->records_max + 1U, sizeof(*sorted));
+    if (sorted == NULL)
+        return 1;
+
+    size_t count = 0;
+    for (size_t i = 0; i < header->records_max; ++i)
+        if (records[i].seq != 0)
+            sorted[count++] = &records[i];
+
+    qsort(sorted, count, sizeof(*sorted), __kassert_decode_record_cmp);
+
+    kassert_report_t out;
+    __kassert_report_init(&out, STDOUT_FILENO);
+
+    __kassert_report_str(&out, "PID: ");
+    __kassert_report_uint(&out, header->pid);
+    __kassert_report_str(&out, " Records: ");
+    __kassert_report_uint(&out, count);
+    __kassert_report_str(&out, " (failures: ");
+    __kassert_report_uint(&out, header->records_count);
+    __kassert_report_str(&out, ")\n\n");
+
+    for (size_t i = 0; i < count; ++i)
+        __kassert_decode_record(&out, sorted[i]);
+
+    __kassert_report_flush(&out);
+
+    free(sorted);
+
+    for (size_t i = 0; i < __kassert_decode_modules_count; ++i)
+        if (__kassert_decode_modules[i].opened)
+            __kassert_elf_close(&__kassert_decode_modules[i].elf);
+
+    munmap((void *)map, size);
+
+    return 0;
+}